@@ -78,8 +78,36 @@ uint16_t touchX, touchY;
 unsigned long lastTouch = 0;
 bool wifiConnected = false;
 bool backendReachable = false;
-unsigned long lastBackendCheck = 0;
+// Backend health follows real requests; /health is only probed when idle or
+// when retrying after a failure (exponential backoff with jitter)
+#define BACKEND_IDLE_PROBE_MS 120000
+#define BACKEND_BACKOFF_BASE_MS 2000
+#define BACKEND_BACKOFF_MAX_MS 300000
+unsigned long nextBackendProbe = 0;
+unsigned long backendBackoff = BACKEND_BACKOFF_BASE_MS;
 String systemStatus = "Initializing...";
+// GPS upload governor, same policy as the ESP-IDF network_manager: upload when
+// the fix moved beyond max(15 m, 5x accuracy), turned by more than 30 degrees,
+// or 60 s passed; fixes implying more than 50 m/s are rejected as glitches
+#define GPS_UPLOAD_MIN_DISTANCE_M 15.0
+#define GPS_UPLOAD_ACCURACY_SCALE 5.0
+#define GPS_UPLOAD_HEADING_CHANGE_DEG 30.0
+#define GPS_UPLOAD_HEARTBEAT_MS 60000
+#define GPS_UPLOAD_MAX_SPEED_MPS 50.0
+#define GPS_UPLOAD_MAX_REJECTIONS 3
+struct GPSUploadState {
+  bool sent = false;
+  double sentLat = 0.0;
+  double sentLng = 0.0;
+  float sentHeading = -1.0;
+  unsigned long sentTime = 0;
+  bool plausible = false;
+  double plausibleLat = 0.0;
+  double plausibleLng = 0.0;
+  unsigned long plausibleTime = 0;
+  int rejections = 0;
+} gpsUpload;
+bool gpsUploadDue();
 #define COLOR_SAFE 0x07E0
 #define COLOR_WARNING 0xFFE0
 #define COLOR_DANGER 0xF800
@@ -89,6 +117,7 @@ String systemStatus = "Initializing...";
 #define COLOR_TEXT 0xFFFF
 void sendGPSToBackend();
 void testBackendConnectivity();
+void noteBackendResult(int httpCode);
 void updateCompass();
 void checkLocationSafety();
 void drawMainMenu();
@@ -143,8 +172,8 @@ class MyCallbacks: public BLECharacteristicCallbacks {
         
         Serial.println("GPS Updated");
         
-        // Send GPS data to backend immediately for tracking and safety analysis
-        if (wifiConnected && backendReachable) {
+        // Send GPS data to backend for tracking and safety analysis when it moved enough
+        if (wifiConnected && backendReachable && gpsUploadDue()) {
           sendGPSToBackend();
         }
       }
@@ -265,10 +294,9 @@ void loop() {
     if (currentState == STATE_MENU) drawMainMenu();
   }
   
-  // Backend check every 30s
-  if (wifiConnected && (currentTime - lastBackendCheck > 30000)) {
+  // Backend probe only when idle or when a retry is due
+  if (wifiConnected && (long)(currentTime - nextBackendProbe) >= 0) {
     testBackendConnectivity();
-    lastBackendCheck = currentTime;
   }
   
   // Handle touch input with debouncing
@@ -668,13 +696,79 @@ void testBackendConnectivity() {
   http.setTimeout(5000);
   
   int httpCode = http.GET();
-  backendReachable = (httpCode == 200);
+  noteBackendResult(httpCode);
   
   // Backend status logged only on change
   
   http.end();
 }
 
+void noteBackendResult(int httpCode) {
+  unsigned long now = millis();
+  
+  if (httpCode > 0 && httpCode < 500) {
+    backendReachable = true;
+    backendBackoff = BACKEND_BACKOFF_BASE_MS;
+    nextBackendProbe = now + BACKEND_IDLE_PROBE_MS;
+  } else {
+    backendReachable = false;
+    nextBackendProbe = now + backendBackoff / 2 + random(backendBackoff / 2 + 1);
+    backendBackoff = min(backendBackoff * 2, (unsigned long)BACKEND_BACKOFF_MAX_MS);
+  }
+}
+
+// Decides for the fix in currentGPS whether it is worth uploading
+bool gpsUploadDue() {
+  unsigned long now = currentGPS.lastUpdate;
+  
+  // A run of rejections means the reference fix was the outlier; start over
+  if (gpsUpload.plausible) {
+    unsigned long dt = now - gpsUpload.plausibleTime;
+    double jump = calculateDistance(gpsUpload.plausibleLat, gpsUpload.plausibleLng,
+                                    currentGPS.latitude, currentGPS.longitude) * 1000.0;
+    if (dt > 0 && jump * 1000.0 / dt > GPS_UPLOAD_MAX_SPEED_MPS &&
+        gpsUpload.rejections < GPS_UPLOAD_MAX_REJECTIONS) {
+      gpsUpload.rejections++;
+      Serial.println("GPS fix rejected: " + String(jump, 0) + " m jump");
+      return false;
+    }
+  }
+  gpsUpload.rejections = 0;
+  gpsUpload.plausible = true;
+  gpsUpload.plausibleLat = currentGPS.latitude;
+  gpsUpload.plausibleLng = currentGPS.longitude;
+  gpsUpload.plausibleTime = now;
+  
+  float heading = -1.0;
+  if (gpsUpload.sent) {
+    double moved = calculateDistance(gpsUpload.sentLat, gpsUpload.sentLng,
+                                     currentGPS.latitude, currentGPS.longitude) * 1000.0;
+    double threshold = max(GPS_UPLOAD_MIN_DISTANCE_M, currentGPS.accuracy * GPS_UPLOAD_ACCURACY_SCALE);
+    if (moved > GPS_UPLOAD_MIN_DISTANCE_M / 2) {
+      heading = calculateBearing(gpsUpload.sentLat, gpsUpload.sentLng,
+                                 currentGPS.latitude, currentGPS.longitude);
+    }
+    
+    float turn = 0.0;
+    if (heading >= 0 && gpsUpload.sentHeading >= 0) {
+      turn = fabs(heading - gpsUpload.sentHeading);
+      if (turn > 180.0) turn = 360.0 - turn;
+    }
+    
+    if (moved <= threshold && turn <= GPS_UPLOAD_HEADING_CHANGE_DEG &&
+        now - gpsUpload.sentTime < GPS_UPLOAD_HEARTBEAT_MS) {
+      return false;
+    }
+  }
+  
+  gpsUpload.sent = true;
+  gpsUpload.sentLat = currentGPS.latitude;
+  gpsUpload.sentLng = currentGPS.longitude;
+  gpsUpload.sentHeading = heading;
+  gpsUpload.sentTime = now;
+  return true;
+}
+
 void sendGPSToBackend() {
   if (!wifiConnected || !backendReachable || !currentGPS.valid) return;
   
@@ -696,6 +790,7 @@ void sendGPSToBackend() {
   serializeJson(doc, jsonString);
   
   int httpCode = http.POST(jsonString);
+  noteBackendResult(httpCode);
   
   // GPS send status omitted to save space
   
@@ -734,6 +829,7 @@ void saveCurrentLocation() {
   serializeJson(doc, jsonString);
   
   int httpCode = http.POST(jsonString);
+  noteBackendResult(httpCode);
   
   if (httpCode == 200 || httpCode == 201) {
     showMessage("Location saved!", COLOR_SAFE, 2000);
@@ -758,6 +854,7 @@ void selectTargetLocation() {
   http.setTimeout(10000);
   
   int httpCode = http.GET();
+  noteBackendResult(httpCode);
   
   if (httpCode == 200) {
     String payload = http.getString();
@@ -816,21 +913,13 @@ void generateSidequest() {
   showMessage("Generating adventure...", COLOR_SIDEQUEST, 2000);
   
   HTTPClient http;
-  String url = String(BACKEND_URL) + "/api/locations/sidequest";
+  String url = String(BACKEND_URL) + "/api/sidequest/start?lat=" + String(currentGPS.latitude, 6) +
+               "&lng=" + String(currentGPS.longitude, 6);
   http.begin(url);
-  http.addHeader("Content-Type", "application/json");
   http.setTimeout(15000);
   
-  StaticJsonDocument<300> doc;
-  doc["latitude"] = currentGPS.latitude;
-  doc["longitude"] = currentGPS.longitude;
-  doc["radius"] = 2000; // 2km radius
-  doc["difficulty"] = "moderate";
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  int httpCode = http.POST(jsonString);
+  int httpCode = http.POST("");
+  noteBackendResult(httpCode);
   
   if (httpCode == 200) {
     String payload = http.getString();
@@ -883,6 +972,7 @@ void checkLocationSafety() {
   http.setTimeout(15000);
   
   int httpCode = http.GET();
+  noteBackendResult(httpCode);
   
   if (httpCode == 200) {
     String payload = http.getString();
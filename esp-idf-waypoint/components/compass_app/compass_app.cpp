@@ -0,0 +1,48 @@
+#include "compass_app.h"
+
+// ESP32-WROOM-32 with a 2.8" ILI9341 module, from the datasheets; the
+// awake floor includes modem-sleep DTIM beacons while associated.
+// sleep_ma is sleep_manager's SLEEP_CURRENT_LIGHT_MA.
+const energy_model_t compass_app_energy_model = {
+    .board = "ESP32 + ILI9341",
+    .sleep_ma = 2.5f,
+    .rail_ma = {
+        24.0f,      // awake
+        15.0f,      // cpu0 busy
+        15.0f,      // cpu1 busy
+        75.0f,      // wifi rx / radio on
+        100.0f,     // wifi tx, over rx
+        80.0f,      // ble radio
+        8.0f,       // panel spi
+        60.0f,      // backlight at full
+    },
+};
+
+// Button rows as compass_display_draw_menu() and draw_sidequest() lay them out
+app_touch_action_t compass_app_touch_action(app_state_t state, int y, bool sidequest_active)
+{
+    switch (state) {
+        case STATE_MENU:
+            if (y < APP_MENU_TITLE_MAX_Y) return APP_TOUCH_TITLE;
+            if (y >= 150 && y <= 190) return APP_TOUCH_SAVE_LOCATION;
+            if (y >= 200 && y <= 240) return APP_TOUCH_NAVIGATE;
+            if (y >= 250 && y <= 290) return APP_TOUCH_SAFETY;
+            if (y >= 270 && y <= 310) return APP_TOUCH_SIDEQUEST;
+            return APP_TOUCH_NONE;
+        
+        case STATE_SIDEQUEST:
+            if (sidequest_active && y >= 400 && y <= 430) return APP_TOUCH_SIDEQUEST_GO;
+            if (!sidequest_active && y >= 250 && y <= 290) return APP_TOUCH_SIDEQUEST_RETRY;
+            return APP_TOUCH_BACK;
+        
+        default:
+            // Any touch outside the menu goes back to it
+            return APP_TOUCH_BACK;
+    }
+}
+
+bool compass_app_touch_needs_backend(app_touch_action_t action)
+{
+    return action == APP_TOUCH_SAVE_LOCATION || action == APP_TOUCH_NAVIGATE ||
+           action == APP_TOUCH_SAFETY || action == APP_TOUCH_SIDEQUEST;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include "energy_account.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+// What the firmware (main/) and the linux simulation (sim/) share about the
+// app: its screens, what a press on each one asks for, and the board's
+// energy model. Each caller acts on the answer with its own I/O.
+    
+// Application States. Saved in the deep-sleep snapshot, so only append.
+typedef enum {
+    STATE_MENU,
+    STATE_POINTING,
+    STATE_SAFETY_WARNING,
+    STATE_SIDEQUEST,
+    STATE_DIAGNOSTICS
+} app_state_t;
+    
+// A press, mapped through the layout compass_display draws for the screen
+typedef enum {
+    APP_TOUCH_NONE,
+    APP_TOUCH_TITLE,            // menu title, taps count towards diagnostics
+    APP_TOUCH_SAVE_LOCATION,
+    APP_TOUCH_NAVIGATE,
+    APP_TOUCH_SAFETY,
+    APP_TOUCH_SIDEQUEST,
+    APP_TOUCH_SIDEQUEST_GO,     // navigate to the shown sidequest
+    APP_TOUCH_SIDEQUEST_RETRY,  // no sidequest shown, ask again
+    APP_TOUCH_BACK              // back to the menu
+} app_touch_action_t;
+    
+// Menu title height for APP_TOUCH_TITLE
+#define APP_MENU_TITLE_MAX_Y 100
+    
+app_touch_action_t compass_app_touch_action(app_state_t state, int y, bool sidequest_active);
+    
+// True for the menu buttons that go to the backend
+bool compass_app_touch_needs_backend(app_touch_action_t action);
+    
+// ESP32-WROOM-32 with a 2.8" ILI9341 module
+extern const energy_model_t compass_app_energy_model;
+    
+#ifdef __cplusplus
+}
+#endif
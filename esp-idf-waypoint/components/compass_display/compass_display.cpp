@@ -1,9 +1,20 @@
 #include "compass_display.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#endif
 #include "esp_log.h"
+#include "trace.h"
+#include "heap_account.h"
+#include "energy_account.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#include <stdio.h>
 #include <string.h>
 #include <math.h>
 
@@ -18,19 +29,53 @@ static const char *TAG = "COMPASS_DISPLAY";
 #define TFT_RST     4
 #define TFT_BL      21
 
+#define TFT_SPI_CLOCK_HZ (26 * 1000 * 1000)
+
+#if !CONFIG_IDF_TARGET_LINUX
 // SPI configuration
 static spi_device_handle_t spi_handle;
+#endif
 
-// Display buffer
+// Display buffer. On the linux target there is no panel and this is the
+// screen: drawing lands here and compass_display_save_frame() dumps it.
 static uint16_t display_buffer[DISPLAY_WIDTH * DISPLAY_HEIGHT];
 
+// SPI traffic since the last compass_display_reset_metrics(). The linux
+// target counts what the panel path would have sent for the same drawing.
+// A column/row address window is 3 commands and 8 data bytes.
+#define ADDR_WINDOW_TRANSACTIONS 11
+#define ADDR_WINDOW_BYTES        11
+
+static display_metrics_t panel_metrics = {};
+static uint32_t draw_start_bytes = 0;  // panel_metrics.bytes when the draw began
+static uint32_t draw_start_transactions = 0;
+static int64_t draw_start_us = 0;
+
+// Drawing is bound by the SPI writes, so the chip charges the panel rail
+// with each draw's duration. The linux target estimates it from the bytes
+// at the SPI clock plus the driver's cost per transaction on the chip.
+#define SIM_SPI_TRANSACTION_US 20
+
+// Drawing never allocates; the panel path writes from fixed buffers
+static heap_account_region_t draw_region = HEAP_ACCOUNT_REGION("display_draw");
+static heap_account_tag_t draw_heap_tag = HEAP_ACCOUNT_OTHER;
+
+#if CONFIG_PM_ENABLE
+// Held for a whole screen: the SPI driver only locks the clocks per
+// transaction, and DFS would otherwise drop the CPU between the thousands
+// of transactions one screen takes
+static esp_pm_lock_handle_t draw_pm_lock = NULL;
+#endif
+
 // Internal functions
+#if !CONFIG_IDF_TARGET_LINUX
 static void tft_init_pins(void);
 static void tft_init_spi(void);
 static void tft_send_command(uint8_t cmd);
 static void tft_send_data(uint8_t data);
 static void tft_send_data16(uint16_t data);
 static void tft_set_addr_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+#endif
 static void tft_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
 static void tft_draw_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
 static void tft_draw_pixel(uint16_t x, uint16_t y, uint16_t color);
@@ -39,13 +84,23 @@ static void tft_draw_circle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
 static void tft_fill_circle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
 static void tft_print_text(uint16_t x, uint16_t y, const char *text, uint16_t color, uint8_t size);
 static void tft_clear_screen(uint16_t color);
+static void draw_begin(void);
+static void draw_end(void);
 
 void compass_display_init(void)
 {
+#if CONFIG_IDF_TARGET_LINUX
+    tft_clear_screen(COLOR_BACKGROUND);
+    energy_account_set_duty(ENERGY_RAIL_BACKLIGHT, 1000);
+    ESP_LOGI(TAG, "Simulated %dx%d display initialized", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+#else
     ESP_LOGI(TAG, "Initializing TFT display...");
     
     tft_init_pins();
     tft_init_spi();
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "display", &draw_pm_lock);
+#endif
     
     // Reset display
     gpio_set_level(TFT_RST, 0);
@@ -71,15 +126,18 @@ void compass_display_init(void)
     
     // Turn on backlight
     gpio_set_level(TFT_BL, 1);
+    energy_account_set_duty(ENERGY_RAIL_BACKLIGHT, 1000);
     
     // Clear screen
     tft_clear_screen(COLOR_BACKGROUND);
     
     ESP_LOGI(TAG, "TFT display initialized");
+#endif
 }
 
 void compass_display_show_startup(void)
 {
+    draw_begin();
     tft_clear_screen(COLOR_BACKGROUND);
     
     // Draw startup logo/text
@@ -93,10 +151,12 @@ void compass_display_show_startup(void)
     tft_draw_line(240, 195, 240, 245, COLOR_DANGER); // N-S line
     tft_draw_line(215, 220, 265, 220, COLOR_TEXT);   // E-W line
     tft_print_text(235, 185, "N", COLOR_DANGER, 2);
+    draw_end();
 }
 
 void compass_display_draw_menu(void)
 {
+    draw_begin();
     tft_clear_screen(COLOR_BACKGROUND);
     
     // Title
@@ -115,12 +175,14 @@ void compass_display_draw_menu(void)
     
     tft_draw_rect(50, 270, 380, 40, COLOR_SIDEQUEST);
     tft_print_text(70, 285, "Generate Sidequest", COLOR_TEXT, 2);
+    draw_end();
 }
 
 void compass_display_draw_compass(const compass_data_t *compass, const target_data_t *target)
 {
     if (!compass || !target) return;
     
+    draw_begin();
     tft_clear_screen(COLOR_BACKGROUND);
     
     // Title
@@ -164,12 +226,14 @@ void compass_display_draw_compass(const compass_data_t *compass, const target_da
     
     // Instructions
     tft_print_text(160, 280, "Touch to return to menu", COLOR_TEXT, 1);
+    draw_end();
 }
 
 void compass_display_draw_safety(const safety_data_t *safety)
 {
     if (!safety) return;
     
+    draw_begin();
     tft_clear_screen(COLOR_BACKGROUND);
     
     // Title
@@ -209,12 +273,14 @@ void compass_display_draw_safety(const safety_data_t *safety)
     
     // Instructions
     tft_print_text(160, 280, "Touch to return to menu", COLOR_TEXT, 1);
+    draw_end();
 }
 
 void compass_display_draw_sidequest(const sidequest_data_t *sidequest)
 {
     if (!sidequest) return;
     
+    draw_begin();
     tft_clear_screen(COLOR_BACKGROUND);
     
     // Title
@@ -262,32 +328,162 @@ void compass_display_draw_sidequest(const sidequest_data_t *sidequest)
     
     // Instructions
     tft_print_text(160, 280, "Touch to return to menu", COLOR_TEXT, 1);
+    draw_end();
 }
 
-void compass_display_show_message(const char *message, uint16_t color, int duration_ms)
+void compass_display_show_message(const char *message, uint16_t color)
 {
     if (!message) return;
     
-    // Save area behind message
-    // (In a full implementation, you'd save the screen area)
-    
-    // Draw message box
+    draw_begin();
     tft_fill_rect(50, 200, 380, 80, COLOR_BACKGROUND);
     tft_draw_rect(50, 200, 380, 80, color);
     tft_print_text(70, 230, message, color, 2);
+    draw_end();
+}
+
+void compass_display_draw_diagnostics(const char *const *lines, int count)
+{
+    if (!lines) return;
     
-    // Wait for duration
-    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    draw_begin();
+    tft_clear_screen(COLOR_BACKGROUND);
+    tft_print_text(160, 10, "DIAGNOSTICS", COLOR_WARNING, 2);
+    
+    // 8 px text on a 12 px pitch, 60 characters to a line
+    int y = 40;
+    for (int i = 0; i < count && y <= DISPLAY_HEIGHT - 40; i++, y += 12) {
+        char line[61];
+        strncpy(line, lines[i], sizeof(line) - 1);
+        line[sizeof(line) - 1] = '\0';
+        tft_print_text(0, y, line, COLOR_TEXT, 1);
+    }
     
-    // Clear message area
-    tft_fill_rect(50, 200, 380, 80, COLOR_BACKGROUND);
+    tft_print_text(160, DISPLAY_HEIGHT - 20, "Touch to return to menu", COLOR_TEXT, 1);
+    draw_end();
+}
+
+void compass_display_set_sleep(bool sleep)
+{
+    energy_account_set_duty(ENERGY_RAIL_BACKLIGHT, sleep ? 0 : 1000);
+#if CONFIG_IDF_TARGET_LINUX
+    ESP_LOGI(TAG, "Simulated panel %s", sleep ? "asleep" : "awake");
+#else
+    if (sleep) {
+        // Held so the backlight stays off through deep sleep too
+        gpio_set_level(TFT_BL, 0);
+        gpio_hold_en(TFT_BL);
+        tft_send_command(0x28); // Display off
+        tft_send_command(0x10); // Sleep in
+        vTaskDelay(pdMS_TO_TICKS(5));
+    } else {
+        tft_send_command(0x11); // Sleep out
+        vTaskDelay(pdMS_TO_TICKS(120));
+        tft_send_command(0x29); // Display on
+        gpio_hold_dis(TFT_BL);
+        gpio_set_level(TFT_BL, 1);
+    }
+#endif
+}
+
+bool compass_display_save_frame(const char *path)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot write frame to %s", path);
+        return false;
+    }
+    
+    // Binary PPM, RGB565 expanded to 8 bits per channel
+    fprintf(f, "P6\n%d %d\n255\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    for (int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++) {
+        uint16_t c = display_buffer[i];
+        uint8_t rgb[3] = {
+            (uint8_t)(((c >> 11) & 0x1F) * 255 / 31),
+            (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+            (uint8_t)((c & 0x1F) * 255 / 31)
+        };
+        fwrite(rgb, 1, sizeof(rgb), f);
+    }
+    
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+#else
+    // The panel holds the frame; nothing is kept on this side of the SPI bus
+    ESP_LOGW(TAG, "Frame capture is only available on the linux target");
+    return false;
+#endif
+}
+
+void compass_display_get_metrics(display_metrics_t *metrics)
+{
+    if (metrics) {
+        *metrics = panel_metrics;
+    }
+}
+
+void compass_display_reset_metrics(void)
+{
+    memset(&panel_metrics, 0, sizeof(panel_metrics));
+}
+
+uint32_t compass_display_frame_hash(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    // FNV-1a over the RGB565 pixels, low byte first
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++) {
+        hash = (hash ^ (display_buffer[i] & 0xFF)) * 16777619u;
+        hash = (hash ^ (display_buffer[i] >> 8)) * 16777619u;
+    }
+    return hash;
+#else
+    return 0;
+#endif
 }
 
 // Internal TFT functions
+#if CONFIG_IDF_TARGET_LINUX
+// Simulated panel: the two primitives everything else is built on write
+// straight into display_buffer
+static void tft_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+    if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
+    if (x + w > DISPLAY_WIDTH) w = DISPLAY_WIDTH - x;
+    if (y + h > DISPLAY_HEIGHT) h = DISPLAY_HEIGHT - y;
+    
+    // Address window, then one 2-byte transaction per pixel
+    uint32_t pixels = (uint32_t)w * h;
+    panel_metrics.transactions += ADDR_WINDOW_TRANSACTIONS + pixels;
+    panel_metrics.bytes += ADDR_WINDOW_BYTES + pixels * 2;
+    panel_metrics.pixels += pixels;
+    
+    for (uint16_t row = y; row < y + h; row++) {
+        for (uint16_t col = x; col < x + w; col++) {
+            display_buffer[row * DISPLAY_WIDTH + col] = color;
+        }
+    }
+}
+
+static void tft_draw_pixel(uint16_t x, uint16_t y, uint16_t color)
+{
+    if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
+    
+    panel_metrics.transactions += ADDR_WINDOW_TRANSACTIONS + 1;
+    panel_metrics.bytes += ADDR_WINDOW_BYTES + 2;
+    panel_metrics.pixels++;
+    display_buffer[y * DISPLAY_WIDTH + x] = color;
+}
+#else
 static void tft_init_pins(void)
 {
     gpio_config_t io_conf = {};
     
+    // The backlight pin is still held low after a deep-sleep wake
+    gpio_hold_dis(TFT_BL);
+    
     // Configure control pins
     io_conf.intr_type = GPIO_INTR_DISABLE;
     io_conf.mode = GPIO_MODE_OUTPUT;
@@ -314,7 +510,7 @@ static void tft_init_spi(void)
     };
     
     spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 26 * 1000 * 1000, // 26 MHz
+        .clock_speed_hz = TFT_SPI_CLOCK_HZ,
         .mode = 0,
         .spics_io_num = TFT_CS,
         .queue_size = 7,
@@ -334,6 +530,8 @@ static void tft_send_command(uint8_t cmd)
         .tx_buffer = &cmd,
     };
     spi_device_transmit(spi_handle, &trans);
+    panel_metrics.transactions++;
+    panel_metrics.bytes++;
 }
 
 static void tft_send_data(uint8_t data)
@@ -345,6 +543,8 @@ static void tft_send_data(uint8_t data)
         .tx_buffer = &data,
     };
     spi_device_transmit(spi_handle, &trans);
+    panel_metrics.transactions++;
+    panel_metrics.bytes++;
 }
 
 static void tft_send_data16(uint16_t data)
@@ -357,6 +557,8 @@ static void tft_send_data16(uint16_t data)
         .tx_buffer = data_bytes,
     };
     spi_device_transmit(spi_handle, &trans);
+    panel_metrics.transactions++;
+    panel_metrics.bytes += 2;
 }
 
 static void tft_set_addr_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
@@ -396,8 +598,21 @@ static void tft_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16
         };
         spi_device_transmit(spi_handle, &trans);
     }
+    panel_metrics.transactions += pixels;
+    panel_metrics.bytes += pixels * 2;
+    panel_metrics.pixels += pixels;
 }
 
+static void tft_draw_pixel(uint16_t x, uint16_t y, uint16_t color)
+{
+    if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
+    
+    tft_set_addr_window(x, y, x, y);
+    tft_send_data16(color);
+    panel_metrics.pixels++;
+}
+#endif
+
 static void tft_draw_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
     // Draw four lines to form rectangle
@@ -411,14 +626,6 @@ static void tft_draw_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16
     }
 }
 
-static void tft_draw_pixel(uint16_t x, uint16_t y, uint16_t color)
-{
-    if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
-    
-    tft_set_addr_window(x, y, x, y);
-    tft_send_data16(color);
-}
-
 static void tft_draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
 {
     // Bresenham's line algorithm
@@ -505,4 +712,35 @@ static void tft_print_text(uint16_t x, uint16_t y, const char *text, uint16_t co
 static void tft_clear_screen(uint16_t color)
 {
     tft_fill_rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, color);
-}
\ No newline at end of file
+}
+
+static void draw_begin(void)
+{
+#if CONFIG_PM_ENABLE
+    if (draw_pm_lock) esp_pm_lock_acquire(draw_pm_lock);
+#endif
+    draw_start_bytes = panel_metrics.bytes;
+    draw_start_transactions = panel_metrics.transactions;
+    draw_start_us = esp_timer_get_time();
+    draw_heap_tag = heap_account_enter(HEAP_ACCOUNT_DISPLAY);
+    heap_account_no_alloc_begin(&draw_region);
+    TRACE_BEGIN(TRACE_DISPLAY_DRAW, 0);
+}
+
+static void draw_end(void)
+{
+    TRACE_END(TRACE_DISPLAY_DRAW);
+    TRACE_COUNTER(TRACE_DISPLAY_BYTES, panel_metrics.bytes - draw_start_bytes);
+    heap_account_no_alloc_end();
+    heap_account_exit(draw_heap_tag);
+#if CONFIG_IDF_TARGET_LINUX
+    uint64_t bits = (uint64_t)(panel_metrics.bytes - draw_start_bytes) * 8;
+    energy_account_add_us(ENERGY_RAIL_PANEL, (uint32_t)(bits * 1000000 / TFT_SPI_CLOCK_HZ +
+                          (panel_metrics.transactions - draw_start_transactions) * SIM_SPI_TRANSACTION_US));
+#else
+    energy_account_add_us(ENERGY_RAIL_PANEL, (uint32_t)(esp_timer_get_time() - draw_start_us));
+#endif
+#if CONFIG_PM_ENABLE
+    if (draw_pm_lock) esp_pm_lock_release(draw_pm_lock);
+#endif
+}
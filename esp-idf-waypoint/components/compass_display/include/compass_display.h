@@ -28,6 +28,10 @@ typedef struct {
     float accuracy;
     bool valid;
     char device_id[32];
+    uint32_t timestamp;  // esp_log_timestamp() when the fix was parsed
+    uint32_t trace_flow; // trace flow from the BLE write to the upload, 0 if untraced
+    uint32_t received_us; // esp_timer when the BLE write arrived, 0 if synthesized
+    uint32_t parsed_us;   // esp_timer when the fix was parsed
 } gps_data_t;
 
 typedef struct {
@@ -63,6 +67,13 @@ typedef struct {
     bool active;
 } sidequest_data_t;
 
+// SPI panel traffic (transactions, bytes and pixels sent)
+typedef struct {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t pixels;
+} display_metrics_t;
+
 // Function declarations
 void compass_display_init(void);
 void compass_display_show_startup(void);
@@ -70,7 +81,26 @@ void compass_display_draw_menu(void);
 void compass_display_draw_compass(const compass_data_t *compass, const target_data_t *target);
 void compass_display_draw_safety(const safety_data_t *safety);
 void compass_display_draw_sidequest(const sidequest_data_t *sidequest);
-void compass_display_show_message(const char *message, uint16_t color, int duration_ms);
+
+// Message box over the current screen, left up until the next screen is
+// drawn; returns at once, the caller decides when to redraw
+void compass_display_show_message(const char *message, uint16_t color);
+
+// Hidden diagnostics page: one line of small text per entry, as many as fit
+void compass_display_draw_diagnostics(const char *const *lines, int count);
+
+// Backlight off and panel in sleep mode (GRAM kept), or back on
+void compass_display_set_sleep(bool sleep);
+
+// Writes the current screen to a binary PPM file (linux target only)
+bool compass_display_save_frame(const char *path);
+
+// Panel traffic counters, e.g. reset before a draw call and read after it
+void compass_display_get_metrics(display_metrics_t *metrics);
+void compass_display_reset_metrics(void);
+
+// FNV-1a hash of the current screen for golden-image checks (linux target only, 0 otherwise)
+uint32_t compass_display_frame_hash(void);
 
 #ifdef __cplusplus
 }
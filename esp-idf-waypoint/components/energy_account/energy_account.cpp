@@ -0,0 +1,183 @@
+#include "energy_account.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "ENERGY";
+
+// Log names, in energy_rail_t order
+static const char *rail_names[ENERGY_RAIL_COUNT] = {
+    "awake",
+    "cpu0",
+    "cpu1",
+    "wifi_rx",
+    "wifi_tx",
+    "ble",
+    "panel",
+    "backlight",
+};
+
+// Reported from tasks on both cores; everything below is protected by
+// energy_lock
+static portMUX_TYPE energy_lock = portMUX_INITIALIZER_UNLOCKED;
+static const energy_model_t *model = NULL;
+static float time_scale = 1.0f;
+static int64_t start_us = 0;
+static energy_rail_stats_t rails[ENERGY_RAIL_COUNT];
+static uint16_t duty_permille[ENERGY_RAIL_COUNT];
+static int64_t duty_since_us[ENERGY_RAIL_COUNT];
+static uint64_t light_sleep_us = 0;
+
+static void integrate_duty(energy_rail_stats_t *rail, uint16_t permille, int64_t since_us, int64_t now_us);
+
+void energy_account_init(const energy_model_t *board_model)
+{
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&energy_lock);
+    model = board_model;
+    start_us = now_us;
+    for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+        duty_since_us[i] = now_us;
+    }
+    if (duty_permille[ENERGY_RAIL_AWAKE] == 0) {
+        duty_permille[ENERGY_RAIL_AWAKE] = 1000;
+        rails[ENERGY_RAIL_AWAKE].events++;
+    }
+    rails[ENERGY_RAIL_AWAKE].duty = true;
+    portEXIT_CRITICAL(&energy_lock);
+    
+    ESP_LOGI(TAG, "Energy model: %s", board_model->board);
+}
+
+void energy_account_set_time_scale(float scale)
+{
+    int64_t now_us = esp_timer_get_time();
+    
+    // Spans so far keep the scale they ran at
+    portENTER_CRITICAL(&energy_lock);
+    for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+        integrate_duty(&rails[i], duty_permille[i], duty_since_us[i], now_us);
+        duty_since_us[i] = now_us;
+    }
+    time_scale = scale > 0 ? scale : 1.0f;
+    portEXIT_CRITICAL(&energy_lock);
+}
+
+void energy_account_add_us(energy_rail_t rail, uint32_t active_us)
+{
+    if (rail < 0 || rail >= ENERGY_RAIL_COUNT) return;
+    
+    portENTER_CRITICAL(&energy_lock);
+    rails[rail].active_us += active_us;
+    rails[rail].on_us += active_us;
+    rails[rail].events++;
+    portEXIT_CRITICAL(&energy_lock);
+}
+
+void energy_account_set_duty(energy_rail_t rail, uint16_t permille)
+{
+    if (rail < 0 || rail >= ENERGY_RAIL_COUNT) return;
+    if (permille > 1000) permille = 1000;
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&energy_lock);
+    integrate_duty(&rails[rail], duty_permille[rail], duty_since_us[rail], now_us);
+    if (duty_permille[rail] == 0 && permille > 0) {
+        rails[rail].events++;
+    }
+    duty_permille[rail] = permille;
+    duty_since_us[rail] = now_us;
+    rails[rail].duty = true;
+    portEXIT_CRITICAL(&energy_lock);
+}
+
+void IRAM_ATTR energy_account_add_sleep_us(uint64_t slept_us)
+{
+    portENTER_CRITICAL(&energy_lock);
+    light_sleep_us += slept_us;
+    portEXIT_CRITICAL(&energy_lock);
+}
+
+const char *energy_account_rail_name(energy_rail_t rail)
+{
+    return rail >= 0 && rail < ENERGY_RAIL_COUNT ? rail_names[rail] : "?";
+}
+
+void energy_account_get_stats(energy_stats_t *stats)
+{
+    if (!stats) return;
+    int64_t now_us = esp_timer_get_time();
+    
+    memset(stats, 0, sizeof(*stats));
+    portENTER_CRITICAL(&energy_lock);
+    const energy_model_t *m = model;
+    if (m) {
+        stats->elapsed_us = (uint64_t)((now_us - start_us) * time_scale);
+        for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+            stats->rails[i] = rails[i];
+            integrate_duty(&stats->rails[i], duty_permille[i], duty_since_us[i], now_us);
+        }
+        // The awake rail stays on through light sleep; take the naps out
+        energy_rail_stats_t *awake = &stats->rails[ENERGY_RAIL_AWAKE];
+        uint64_t slept_us = light_sleep_us < awake->on_us ? light_sleep_us : awake->on_us;
+        awake->on_us -= slept_us;
+        awake->active_us -= slept_us < awake->active_us ? slept_us : awake->active_us;
+    }
+    portEXIT_CRITICAL(&energy_lock);
+    if (!m || stats->elapsed_us == 0) return;
+    
+    // Average current is charge over time, and mA over an hour is mAh
+    stats->board = m->board;
+    double elapsed = (double)stats->elapsed_us;
+    for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+        energy_rail_stats_t *r = &stats->rails[i];
+        r->ma = (float)(m->rail_ma[i] * r->active_us / elapsed);
+        stats->total_ma += r->ma;
+    }
+    uint64_t awake_us = stats->rails[ENERGY_RAIL_AWAKE].on_us;
+    stats->sleep_us = stats->elapsed_us > awake_us ? stats->elapsed_us - awake_us : 0;
+    stats->sleep_ma = (float)(m->sleep_ma * stats->sleep_us / elapsed);
+    stats->total_ma += stats->sleep_ma;
+}
+
+void energy_account_log(void)
+{
+    energy_stats_t stats;
+    energy_account_get_stats(&stats);
+    
+    if (!stats.board) {
+        ESP_LOGI(TAG, "Energy accounting not started");
+        return;
+    }
+    
+    double elapsed_s = stats.elapsed_us / 1e6;
+    ESP_LOGI(TAG, "Estimated energy on %s over %.0f s (average mA = mAh per hour):", stats.board, elapsed_s);
+    for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+        const energy_rail_stats_t *r = &stats.rails[i];
+        double active_s = r->active_us / 1e6;
+        if (!r->duty) {
+            ESP_LOGI(TAG, "  %-9s %8.1f s active (%5.1f%%), %6lu events, %6.2f mA", rail_names[i], active_s,
+                     active_s * 100.0 / elapsed_s, (unsigned long)r->events, r->ma);
+        } else {
+            // Duty rails: how long on, and the average level while on
+            ESP_LOGI(TAG, "  %-9s %8.1f s on (%5.1f%%) at %5.1f%%, %6lu times, %6.2f mA", rail_names[i],
+                     r->on_us / 1e6, r->on_us * 100.0 / stats.elapsed_us,
+                     r->on_us ? r->active_us * 100.0 / r->on_us : 0.0, (unsigned long)r->events, r->ma);
+        }
+    }
+    ESP_LOGI(TAG, "  %-9s %8.1f s, %6.2f mA", "sleep", stats.sleep_us / 1e6, stats.sleep_ma);
+    ESP_LOGI(TAG, "  total %.1f mA", stats.total_ma);
+}
+
+// Adds the span since since_us at the given level; caller holds energy_lock
+static void integrate_duty(energy_rail_stats_t *rail, uint16_t permille, int64_t since_us, int64_t now_us)
+{
+    if (permille == 0 || now_us <= since_us) return;
+    
+    uint64_t span_us = (uint64_t)((now_us - since_us) * time_scale);
+    rail->on_us += span_us;
+    rail->active_us += span_us * permille / 1000;
+}
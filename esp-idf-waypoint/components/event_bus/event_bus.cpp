@@ -0,0 +1,277 @@
+#include "event_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include <string.h>
+
+static const char *TAG = "EVENT_BUS";
+
+struct bus_subscriber {
+    const char *name;
+    uint32_t type_mask;
+    QueueHandle_t queue;  // bus_msg_t pointers
+    uint32_t received;
+    uint32_t dropped;
+    uint32_t max_latency_ms;
+};
+
+// Message pool and free list, protected by bus_lock
+static bus_msg_t msg_pool[EVENT_BUS_POOL_SIZE];
+static bus_msg_t *free_list[EVENT_BUS_POOL_SIZE];
+static int free_count = 0;
+
+static bus_subscriber_t subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+
+static esp_timer_handle_t bus_timers[EVENT_BUS_MAX_TIMERS];
+static uint32_t bus_timer_ids[EVENT_BUS_MAX_TIMERS];
+static int timer_count = 0;
+
+static portMUX_TYPE bus_lock = portMUX_INITIALIZER_UNLOCKED;
+static bus_stats_t bus_stats = {};
+static bool bus_initialized = false;
+
+static void bus_timer_callback(void *arg);
+static esp_timer_handle_t bus_timer_get(uint32_t timer_id);
+
+void event_bus_init(void)
+{
+    if (bus_initialized) {
+        return;
+    }
+    
+    for (int i = 0; i < EVENT_BUS_POOL_SIZE; i++) {
+        free_list[i] = &msg_pool[i];
+    }
+    free_count = EVENT_BUS_POOL_SIZE;
+    bus_stats.pool_min_free = EVENT_BUS_POOL_SIZE;
+    bus_initialized = true;
+    
+    ESP_LOGI(TAG, "Event bus initialized (%d x %d byte messages)", EVENT_BUS_POOL_SIZE, (int)sizeof(bus_msg_t));
+}
+
+bus_subscriber_t *event_bus_subscribe(const char *name, uint32_t type_mask, uint8_t queue_len)
+{
+    QueueHandle_t queue = xQueueCreate(queue_len, sizeof(bus_msg_t *));
+    if (!queue) {
+        ESP_LOGE(TAG, "No memory for %s queue", name);
+        return NULL;
+    }
+    
+    bus_subscriber_t *sub = NULL;
+    portENTER_CRITICAL(&bus_lock);
+    if (subscriber_count < EVENT_BUS_MAX_SUBSCRIBERS) {
+        sub = &subscribers[subscriber_count];
+        sub->name = name;
+        sub->type_mask = type_mask;
+        sub->queue = queue;
+        subscriber_count++;
+    }
+    portEXIT_CRITICAL(&bus_lock);
+    
+    if (!sub) {
+        ESP_LOGE(TAG, "Too many subscribers, %s not added", name);
+        vQueueDelete(queue);
+    }
+    return sub;
+}
+
+bus_msg_t *event_bus_alloc(bus_event_type_t type)
+{
+    bus_msg_t *msg = NULL;
+    
+    portENTER_CRITICAL(&bus_lock);
+    if (free_count > 0) {
+        msg = free_list[--free_count];
+        if ((uint32_t)free_count < bus_stats.pool_min_free) {
+            bus_stats.pool_min_free = free_count;
+        }
+    } else {
+        bus_stats.pool_exhausted++;
+    }
+    portEXIT_CRITICAL(&bus_lock);
+    
+    if (!msg) {
+        ESP_LOGW(TAG, "Message pool exhausted, event %d dropped", type);
+        return NULL;
+    }
+    
+    memset(msg, 0, sizeof(*msg));
+    msg->type = type;
+    msg->refs = 1;
+    return msg;
+}
+
+void event_bus_publish(bus_msg_t *msg)
+{
+    if (!msg) {
+        return;
+    }
+    msg->published_ms = esp_log_timestamp();
+    
+    // Take every subscriber's reference up front so an early receiver
+    // releasing its copy can't return the message to the pool mid-publish
+    uint32_t mask = BUS_EVENT_MASK(msg->type);
+    portENTER_CRITICAL(&bus_lock);
+    int count = subscriber_count;
+    bus_stats.published++;
+    for (int i = 0; i < count; i++) {
+        if (subscribers[i].type_mask & mask) {
+            msg->refs++;
+        }
+    }
+    portEXIT_CRITICAL(&bus_lock);
+    
+    for (int i = 0; i < count; i++) {
+        bus_subscriber_t *sub = &subscribers[i];
+        if (!(sub->type_mask & mask)) {
+            continue;
+        }
+        if (xQueueSend(sub->queue, &msg, 0) == pdTRUE) {
+            portENTER_CRITICAL(&bus_lock);
+            bus_stats.delivered++;
+            portEXIT_CRITICAL(&bus_lock);
+        } else {
+            portENTER_CRITICAL(&bus_lock);
+            bus_stats.queue_full++;
+            sub->dropped++;
+            portEXIT_CRITICAL(&bus_lock);
+            event_bus_release(msg);
+        }
+    }
+    
+    // Publisher's reference
+    event_bus_release(msg);
+}
+
+bus_msg_t *event_bus_receive(bus_subscriber_t *sub, TickType_t timeout)
+{
+    bus_msg_t *msg = NULL;
+    if (!sub || xQueueReceive(sub->queue, &msg, timeout) != pdTRUE) {
+        return NULL;
+    }
+    
+    uint32_t latency_ms = esp_log_timestamp() - msg->published_ms;
+    portENTER_CRITICAL(&bus_lock);
+    sub->received++;
+    if (latency_ms > sub->max_latency_ms) {
+        sub->max_latency_ms = latency_ms;
+    }
+    if (latency_ms > bus_stats.max_latency_ms) {
+        bus_stats.max_latency_ms = latency_ms;
+    }
+    portEXIT_CRITICAL(&bus_lock);
+    
+    return msg;
+}
+
+void event_bus_release(bus_msg_t *msg)
+{
+    if (!msg) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&bus_lock);
+    if (msg->refs > 0 && --msg->refs == 0) {
+        free_list[free_count++] = msg;
+    }
+    portEXIT_CRITICAL(&bus_lock);
+}
+
+bool event_bus_timer_start(uint32_t timer_id, uint32_t period_ms)
+{
+    esp_timer_handle_t timer = bus_timer_get(timer_id);
+    if (!timer || esp_timer_start_periodic(timer, (uint64_t)period_ms * 1000) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start bus timer %lu", (unsigned long)timer_id);
+        return false;
+    }
+    return true;
+}
+
+bool event_bus_timer_once(uint32_t timer_id, uint32_t delay_ms)
+{
+    esp_timer_handle_t timer = bus_timer_get(timer_id);
+    if (!timer) {
+        ESP_LOGE(TAG, "Failed to start bus timer %lu", (unsigned long)timer_id);
+        return false;
+    }
+    
+    // Re-arming restarts the delay
+    esp_timer_stop(timer);
+    return esp_timer_start_once(timer, (uint64_t)delay_ms * 1000) == ESP_OK;
+}
+
+void event_bus_timer_stop(uint32_t timer_id)
+{
+    for (int i = 0; i < timer_count; i++) {
+        if (bus_timer_ids[i] == timer_id) {
+            esp_timer_stop(bus_timers[i]);
+            return;
+        }
+    }
+}
+
+void event_bus_get_stats(bus_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    portENTER_CRITICAL(&bus_lock);
+    *stats = bus_stats;
+    portEXIT_CRITICAL(&bus_lock);
+}
+
+void event_bus_log_stats(void)
+{
+    bus_stats_t stats;
+    event_bus_get_stats(&stats);
+    
+    ESP_LOGI(TAG, "Bus: published %lu, delivered %lu, pool exhausted %lu, queue full %lu, "
+             "min free %lu/%d, max latency %lu ms",
+             (unsigned long)stats.published, (unsigned long)stats.delivered, (unsigned long)stats.pool_exhausted,
+             (unsigned long)stats.queue_full, (unsigned long)stats.pool_min_free, EVENT_BUS_POOL_SIZE,
+             (unsigned long)stats.max_latency_ms);
+    
+    for (int i = 0; i < subscriber_count; i++) {
+        const bus_subscriber_t *sub = &subscribers[i];
+        ESP_LOGI(TAG, "  %-14s received %lu, dropped %lu, max latency %lu ms, queued %d", sub->name,
+                 (unsigned long)sub->received, (unsigned long)sub->dropped, (unsigned long)sub->max_latency_ms,
+                 (int)uxQueueMessagesWaiting(sub->queue));
+    }
+}
+
+// The timer for timer_id, created on first use. Only app_main and then the
+// app task start timers, so the table needs no lock.
+static esp_timer_handle_t bus_timer_get(uint32_t timer_id)
+{
+    for (int i = 0; i < timer_count; i++) {
+        if (bus_timer_ids[i] == timer_id) {
+            return bus_timers[i];
+        }
+    }
+    
+    if (timer_count >= EVENT_BUS_MAX_TIMERS) {
+        ESP_LOGE(TAG, "Too many bus timers");
+        return NULL;
+    }
+    
+    bus_timer_ids[timer_count] = timer_id;
+    esp_timer_create_args_t args = {};
+    args.callback = bus_timer_callback;
+    args.arg = &bus_timer_ids[timer_count];
+    args.name = "bus_timer";
+    if (esp_timer_create(&args, &bus_timers[timer_count]) != ESP_OK) {
+        return NULL;
+    }
+    return bus_timers[timer_count++];
+}
+
+// Runs on the esp_timer task; a full pool just skips this tick
+static void bus_timer_callback(void *arg)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_TIMER);
+    if (msg) {
+        msg->data.timer_id = *(uint32_t *)arg;
+        event_bus_publish(msg);
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "compass_display.h" // For data structures
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Messages come from a fixed pool and are handed to subscribers by
+// reference: publishing never copies or blocks, and a message goes back to
+// the pool when the last subscriber releases it. When the pool is empty or a
+// subscriber's queue is full the event is dropped and counted instead.
+#define EVENT_BUS_POOL_SIZE        16
+#define EVENT_BUS_MAX_SUBSCRIBERS  6
+#define EVENT_BUS_MAX_TIMERS       4
+
+typedef enum {
+    BUS_EVENT_GPS_FIX,      // data.fix: a new GPS fix was parsed
+    BUS_EVENT_TOUCH,        // data.touch: screen touch or UI button
+    BUS_EVENT_NET_REQUEST,  // data.request: backend call for the network worker
+    BUS_EVENT_NET_RESULT,   // data.result: backend answer, requested or pushed
+    BUS_EVENT_LINK,         // data.link: WiFi or backend went up or down
+    BUS_EVENT_TIMER,        // data.timer_id: a bus timer fired
+    BUS_EVENT_TYPE_COUNT
+} bus_event_type_t;
+
+#define BUS_EVENT_MASK(type) (1u << (type))
+
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    bool pressed;
+    uint8_t button;  // UI button id, 0 for a raw touch at (x, y)
+} bus_touch_t;
+
+typedef enum {
+    BUS_NET_SAVE_LOCATION,
+    BUS_NET_TARGET,
+    BUS_NET_SAFETY,
+    BUS_NET_SIDEQUEST
+} bus_net_kind_t;
+
+typedef struct {
+    bus_net_kind_t kind;
+    gps_data_t fix;  // position the request is about
+} bus_net_request_t;
+
+typedef struct {
+    bus_net_kind_t kind;
+    bool ok;
+    bool pushed;  // arrived over the push channel rather than as a reply
+    union {
+        target_data_t target;
+        safety_data_t safety;
+        sidequest_data_t sidequest;
+    };
+} bus_net_result_t;
+
+typedef enum {
+    BUS_LINK_WIFI,
+    BUS_LINK_BACKEND
+} bus_link_kind_t;
+
+typedef struct {
+    bus_link_kind_t kind;
+    bool up;
+} bus_link_t;
+
+typedef struct {
+    bus_event_type_t type;
+    uint32_t published_ms;  // esp_log_timestamp() at publish
+    union {
+        gps_data_t fix;
+        bus_touch_t touch;
+        bus_net_request_t request;
+        bus_net_result_t result;
+        bus_link_t link;
+        uint32_t timer_id;
+    } data;
+    uint8_t refs;  // owned by the bus
+} bus_msg_t;
+
+typedef struct bus_subscriber bus_subscriber_t;
+
+typedef struct {
+    uint32_t published;
+    uint32_t delivered;
+    uint32_t pool_exhausted;  // events dropped because every message was in use
+    uint32_t queue_full;      // deliveries dropped because a subscriber fell behind
+    uint32_t pool_min_free;   // fewest free messages seen
+    uint32_t max_latency_ms;  // worst publish-to-receive delay over all subscribers
+} bus_stats_t;
+
+// Function declarations
+void event_bus_init(void);
+
+// Receives every event type in type_mask through its own queue
+bus_subscriber_t *event_bus_subscribe(const char *name, uint32_t type_mask, uint8_t queue_len);
+
+// Takes a message from the pool (NULL when exhausted), fill in data and publish
+bus_msg_t *event_bus_alloc(bus_event_type_t type);
+void event_bus_publish(bus_msg_t *msg);
+
+// Next message for this subscriber, NULL on timeout. The message stays valid
+// until event_bus_release().
+bus_msg_t *event_bus_receive(bus_subscriber_t *sub, TickType_t timeout);
+void event_bus_release(bus_msg_t *msg);
+
+// Publishes BUS_EVENT_TIMER with timer_id every period_ms
+bool event_bus_timer_start(uint32_t timer_id, uint32_t period_ms);
+
+// Publishes BUS_EVENT_TIMER with timer_id once, delay_ms from now. Arming
+// it again before it fires restarts the delay.
+bool event_bus_timer_once(uint32_t timer_id, uint32_t delay_ms);
+void event_bus_timer_stop(uint32_t timer_id);
+
+void event_bus_get_stats(bus_stats_t *stats);
+void event_bus_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
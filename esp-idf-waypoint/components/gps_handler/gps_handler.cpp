@@ -1,13 +1,25 @@
 #include "gps_handler.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "esp_bt.h"
 #include "esp_gap_ble_api.h"
 #include "esp_gatts_api.h"
 #include "esp_bt_main.h"
 #include "esp_gatt_common_api.h"
+#endif
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "trace.h"
+#include "binlog.h"
+#include "heap_account.h"
+#include "energy_account.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -18,22 +30,111 @@ static const char *TAG = "GPS_HANDLER";
 #define GPS_DEVICE_NAME     "WaypointCompass"
 #define GPS_SVC_INST_ID     0
 
+// NMEA allows 82 characters; longer sentences are cut, losing only trailing fields
+#define NMEA_SENTENCE_MAX   128
+
+// Radio time per BLE event for the energy estimate: a connection event
+// with a short packet each way, an advertising event on all three channels.
+// Phones pick a 30-50 ms connection interval until they ask for another.
+#define BLE_CONN_EVENT_US           400
+#define BLE_ADV_EVENT_US            1200
+#define BLE_DEFAULT_CONN_INTERVAL_US 30000
+
 // Global variables
 static gps_data_t current_gps_data = {0};
 static bool ble_connected = false;
 static SemaphoreHandle_t gps_data_mutex;
+static gps_fix_callback_t fix_callback = NULL;
+static heap_account_region_t parse_region = HEAP_ACCOUNT_REGION("gps_parse");
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static gps_handler_stats_t stats = {};
+
+// Function prototypes
+static void parse_gps_data(const char *data, size_t len, uint32_t received_us);
+static bool parse_nmea_sentence(const char *sentence);
+static uint32_t gps_now_ms(void);
+static void ble_energy_set_interval(uint32_t event_us, uint32_t interval_us);
+
+#if CONFIG_IDF_TARGET_LINUX
+// Linux target: fixes come from the replay file named by SIM_GPS_REPLAY, one
+// "<sim_ms> <NMEA sentence>" per line ('#' starts a comment), fed through the
+// same parser as BLE writes. SIM_TIME_SCALE speeds the replay up; fix
+// timestamps follow the accelerated clock so the upload governor, which
+// runs on fix timestamps, sees the hike at its recorded pace.
+static FILE *replay_file = NULL;
+
+static void gps_replay_task(void *pvParameters);
+
+void gps_handler_init(void)
+{
+    gps_data_mutex = xSemaphoreCreateMutex();
+    
+    const char *path = getenv("SIM_GPS_REPLAY");
+    replay_file = path ? fopen(path, "r") : NULL;
+    if (!replay_file) {
+        ESP_LOGE(TAG, "No GPS replay (set SIM_GPS_REPLAY to a replay file)");
+        return;
+    }
+    
+    xTaskCreate(gps_replay_task, "gps_replay", 4096, NULL, 5, NULL);
+    ESP_LOGI(TAG, "Replaying GPS from %s", path);
+}
+
+static uint32_t gps_now_ms(void)
+{
+    static float scale = 0;
+    if (scale == 0) {
+        const char *env = getenv("SIM_TIME_SCALE");
+        scale = env ? atof(env) : 1.0f;
+        if (scale <= 0) scale = 1.0f;
+    }
+    return (uint32_t)(esp_log_timestamp() * scale);
+}
+
+static void gps_replay_task(void *pvParameters)
+{
+    char line[256];
+    heap_account_enter(HEAP_ACCOUNT_GPS);
+    ble_connected = true;
+    ble_energy_set_interval(BLE_CONN_EVENT_US, BLE_DEFAULT_CONN_INTERVAL_US);
+    
+    while (fgets(line, sizeof(line), replay_file)) {
+        char *sentence = NULL;
+        unsigned long at_ms = strtoul(line, &sentence, 10);
+        if (line[0] == '#' || sentence == line) {
+            continue;
+        }
+        while (*sentence == ' ') sentence++;
+        
+        while (gps_now_ms() < at_ms) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        parse_gps_data(sentence, strlen(sentence), (uint32_t)esp_timer_get_time());
+    }
+    
+    ESP_LOGI(TAG, "GPS replay finished");
+    ble_connected = false;
+    ble_energy_set_interval(0, 0);
+    fclose(replay_file);
+    replay_file = NULL;
+    vTaskDelete(NULL);
+}
+#else
 static uint16_t gps_conn_id = 0;
 static uint16_t gps_gatts_if = 0;
 
+#if CONFIG_PM_ENABLE
+// Full speed while a write is parsed and handed on, so a fix isn't
+// delayed by DFS; between writes the controller keeps its own lock
+static esp_pm_lock_handle_t ble_pm_lock = NULL;
+#endif
+
 // BLE service and characteristic handles
 static uint16_t gps_service_handle = 0;
 static uint16_t gps_char_handle = 0;
 
-// Function prototypes
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
-static void parse_gps_data(const char *data, size_t len);
-static bool parse_nmea_sentence(const char *sentence);
 
 // Service UUID (128-bit UUID for Nordic UART Service)
 static uint8_t gps_service_uuid128[16] = {
@@ -53,6 +154,9 @@ void gps_handler_init(void)
     
     // Create mutex for GPS data protection
     gps_data_mutex = xSemaphoreCreateMutex();
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "ble_gps", &ble_pm_lock);
+#endif
     
     // Initialize BLE
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
@@ -71,6 +175,12 @@ void gps_handler_init(void)
     ESP_LOGI(TAG, "BLE GPS handler initialized");
 }
 
+static uint32_t gps_now_ms(void)
+{
+    return esp_log_timestamp();
+}
+#endif
+
 gps_data_t gps_handler_get_data(void)
 {
     gps_data_t data = {0};
@@ -83,11 +193,39 @@ gps_data_t gps_handler_get_data(void)
     return data;
 }
 
+void gps_handler_set_fix_callback(gps_fix_callback_t callback)
+{
+    fix_callback = callback;
+}
+
 bool gps_handler_is_connected(void)
 {
     return ble_connected;
 }
 
+void gps_handler_get_stats(gps_handler_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// One radio event of event_us every interval_us; 0 when the radio is idle
+static void ble_energy_set_interval(uint32_t event_us, uint32_t interval_us)
+{
+    uint32_t permille = interval_us ? event_us * 1000 / interval_us : 0;
+    energy_account_set_duty(ENERGY_RAIL_BLE, permille > 1000 ? 1000 : (uint16_t)permille);
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+void gps_handler_start_scan(void)
+{
+}
+
+void gps_handler_stop_scan(void)
+{
+}
+#else
 void gps_handler_start_scan(void)
 {
     ESP_LOGI(TAG, "Starting BLE scan for GPS devices...");
@@ -143,6 +281,9 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
                 ESP_LOGE(TAG, "Advertising start failed");
             } else {
                 ESP_LOGI(TAG, "Advertising started successfully");
+                // The controller advertises halfway between the bounds on average
+                ble_energy_set_interval(BLE_ADV_EVENT_US,
+                                        (gps_adv_params.adv_int_min + gps_adv_params.adv_int_max) * 625 / 2);
             }
             break;
             
@@ -151,6 +292,15 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
                 ESP_LOGE(TAG, "Advertising stop failed");
             } else {
                 ESP_LOGI(TAG, "Advertising stopped successfully");
+                if (!ble_connected) ble_energy_set_interval(0, 0);
+            }
+            break;
+            
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+            // Interval in 1.25 ms units
+            ESP_LOGI(TAG, "Connection interval %.2f ms", param->update_conn_params.conn_int * 1.25);
+            if (ble_connected) {
+                ble_energy_set_interval(BLE_CONN_EVENT_US, param->update_conn_params.conn_int * 1250);
             }
             break;
             
@@ -224,6 +374,12 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             ESP_LOGI(TAG, "BLE client connected, conn_id %d", param->connect.conn_id);
             gps_conn_id = param->connect.conn_id;
             ble_connected = true;
+            portENTER_CRITICAL(&stats_lock);
+            stats.connects++;
+            portEXIT_CRITICAL(&stats_lock);
+            // Advertising stops on connect
+            ble_energy_set_interval(BLE_CONN_EVENT_US, param->connect.conn_params.interval ?
+                                    param->connect.conn_params.interval * 1250 : BLE_DEFAULT_CONN_INTERVAL_US);
             break;
             
         case ESP_GATTS_DISCONNECT_EVT:
@@ -237,12 +393,24 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             
         case ESP_GATTS_WRITE_EVT:
             if (param->write.handle == gps_char_handle) {
-                ESP_LOGI(TAG, "Received GPS data: %.*s", param->write.len, param->write.value);
-                parse_gps_data((char*)param->write.value, param->write.len);
+                // Start of the fix's latency budget
+                uint32_t received_us = (uint32_t)esp_timer_get_time();
+                heap_account_tag_t heap_tag = heap_account_enter(HEAP_ACCOUNT_GPS);
+#if CONFIG_PM_ENABLE
+                if (ble_pm_lock) esp_pm_lock_acquire(ble_pm_lock);
+#endif
+                TRACE_BEGIN(TRACE_GPS_BLE_WRITE, param->write.len);
+                BINLOG_I(TAG, "Received GPS data: %u bytes", param->write.len);
+                parse_gps_data((char*)param->write.value, param->write.len, received_us);
                 
                 // Send response
                 esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
                                             ESP_GATT_OK, NULL);
+                TRACE_END(TRACE_GPS_BLE_WRITE);
+                heap_account_exit(heap_tag);
+#if CONFIG_PM_ENABLE
+                if (ble_pm_lock) esp_pm_lock_release(ble_pm_lock);
+#endif
             }
             break;
             
@@ -251,9 +419,13 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     }
 }
 
-static void parse_gps_data(const char *data, size_t len)
+#endif
+
+static void parse_gps_data(const char *data, size_t len, uint32_t received_us)
 {
     if (!data || len == 0) return;
+    TRACE_BEGIN(TRACE_GPS_PARSE, len);
+    heap_account_no_alloc_begin(&parse_region);
     
     // Create null-terminated string
     char gps_string[512];
@@ -261,17 +433,38 @@ static void parse_gps_data(const char *data, size_t len)
     memcpy(gps_string, data, copy_len);
     gps_string[copy_len] = '\0';
     
-    ESP_LOGI(TAG, "Parsing GPS data: %s", gps_string);
+    ESP_LOGD(TAG, "Parsing GPS data: %s", gps_string);
     
     // Split into NMEA sentences
-    char *sentence = strtok(gps_string, "\r\n");
+    uint32_t sentences = 0;
+    uint32_t fixes = 0;
+    char *sentence_save = NULL;
+    char *sentence = strtok_r(gps_string, "\r\n", &sentence_save);
     while (sentence != NULL) {
-        if (parse_nmea_sentence(sentence)) {
-            // Signal main task that new GPS data is available
-            // (You would set an event group bit here)
+        sentences++;
+        bool is_fix = parse_nmea_sentence(sentence);
+        fixes += is_fix;
+        if (is_fix && fix_callback) {
+            // Tell the application a new fix is available; the flow follows it to the
+            // upload and the stamps start its latency budget
+            gps_data_t fix = gps_handler_get_data();
+            fix.trace_flow = TRACE_NEW_FLOW();
+            fix.received_us = received_us;
+            fix.parsed_us = (uint32_t)esp_timer_get_time();
+            TRACE_FLOW_START(TRACE_GPS_FLOW, fix.trace_flow);
+            fix_callback(&fix);
         }
-        sentence = strtok(NULL, "\r\n");
+        sentence = strtok_r(NULL, "\r\n", &sentence_save);
     }
+    
+    portENTER_CRITICAL(&stats_lock);
+    stats.writes++;
+    stats.bytes += len;
+    stats.sentences += sentences;
+    stats.fixes += fixes;
+    portEXIT_CRITICAL(&stats_lock);
+    heap_account_no_alloc_end();
+    TRACE_END(TRACE_GPS_PARSE);
 }
 
 static bool parse_nmea_sentence(const char *sentence)
@@ -280,15 +473,18 @@ static bool parse_nmea_sentence(const char *sentence)
     
     // Parse GPGGA sentence (GPS fix data)
     if (strncmp(sentence, "$GPGGA", 6) == 0 || strncmp(sentence, "$GNGGA", 6) == 0) {
+        // A stack copy: the parse path must not allocate
+        char sentence_copy[NMEA_SENTENCE_MAX];
+        char *field_save = NULL;
         char *token;
-        char *sentence_copy = strdup(sentence);
         int field = 0;
         double lat_deg = 0, lon_deg = 0;
         char lat_dir = 'N', lon_dir = 'E';
         float altitude = 0, accuracy = 0;
         int fix_quality = 0;
         
-        token = strtok(sentence_copy, ",");
+        snprintf(sentence_copy, sizeof(sentence_copy), "%s", sentence);
+        token = strtok_r(sentence_copy, ",", &field_save);
         while (token != NULL && field < 15) {
             switch (field) {
                 case 2: // Latitude
@@ -321,12 +517,10 @@ static bool parse_nmea_sentence(const char *sentence)
                     }
                     break;
             }
-            token = strtok(NULL, ",");
+            token = strtok_r(NULL, ",", &field_save);
             field++;
         }
         
-        free(sentence_copy);
-        
         if (fix_quality > 0) {
             // Convert DDMM.MMMM to decimal degrees
             double lat_decimal = ((int)(lat_deg / 100)) + ((lat_deg - ((int)(lat_deg / 100)) * 100) / 60.0);
@@ -342,6 +536,7 @@ static bool parse_nmea_sentence(const char *sentence)
                 current_gps_data.altitude = altitude;
                 current_gps_data.accuracy = accuracy;
                 current_gps_data.valid = true;
+                current_gps_data.timestamp = gps_now_ms();
                 strcpy(current_gps_data.device_id, "ble_gps");
                 
                 xSemaphoreGive(gps_data_mutex);
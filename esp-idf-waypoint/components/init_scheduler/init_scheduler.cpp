@@ -0,0 +1,128 @@
+#include "init_scheduler.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+
+static const char *TAG = "INIT_SCHEDULER";
+
+typedef struct {
+    const init_step_t *step;
+    uint8_t index;
+    uint32_t start_ms;     // relative to boot_start_ms
+    uint32_t duration_ms;
+    esp_err_t result;
+} step_state_t;
+
+static step_state_t step_states[INIT_SCHEDULER_MAX_STEPS];
+static int step_count = 0;
+static EventGroupHandle_t done_group = NULL;
+static uint32_t boot_start_ms = 0;
+
+static void step_task(void *pvParameters)
+{
+    step_state_t *state = (step_state_t *)pvParameters;
+    const init_step_t *step = state->step;
+    
+    if (step->depends_on) {
+        xEventGroupWaitBits(done_group, step->depends_on, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    
+    uint32_t start_ms = esp_log_timestamp();
+    state->start_ms = start_ms - boot_start_ms;
+    state->result = step->run();
+    state->duration_ms = esp_log_timestamp() - start_ms;
+    
+    if (state->result != ESP_OK) {
+        ESP_LOGE(TAG, "Step %s failed: %s", step->name, esp_err_to_name(state->result));
+    }
+    
+    xEventGroupSetBits(done_group, INIT_STEP(state->index));
+    vTaskDelete(NULL);
+}
+
+bool init_scheduler_start(const init_step_t *steps, int count)
+{
+    if (count > INIT_SCHEDULER_MAX_STEPS) {
+        ESP_LOGE(TAG, "Too many boot steps (%d, max %d)", count, INIT_SCHEDULER_MAX_STEPS);
+        return false;
+    }
+    
+    // A step may only depend on earlier ones, which rules out cycles
+    for (int i = 0; i < count; i++) {
+        if (steps[i].depends_on & ~(INIT_STEP(i) - 1)) {
+            ESP_LOGE(TAG, "Step %s depends on itself or a later step", steps[i].name);
+            return false;
+        }
+    }
+    
+    done_group = xEventGroupCreate();
+    if (!done_group) {
+        return false;
+    }
+    
+    boot_start_ms = esp_log_timestamp();
+    step_count = count;
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    
+    for (int i = 0; i < count; i++) {
+        step_state_t *state = &step_states[i];
+        state->step = &steps[i];
+        state->index = i;
+        state->result = ESP_OK;
+        
+        uint32_t stack_size = steps[i].stack_size ? steps[i].stack_size : INIT_SCHEDULER_STACK_SIZE;
+        if (xTaskCreatePinnedToCore(step_task, steps[i].name, stack_size, state, priority, NULL,
+                                    steps[i].core) != pdPASS) {
+            // Run it inline rather than leave its dependents waiting
+            ESP_LOGW(TAG, "No task for step %s, running it inline", steps[i].name);
+            init_scheduler_wait(steps[i].depends_on, portMAX_DELAY);
+            state->start_ms = init_scheduler_elapsed_ms();
+            state->result = steps[i].run();
+            state->duration_ms = init_scheduler_elapsed_ms() - state->start_ms;
+            xEventGroupSetBits(done_group, INIT_STEP(i));
+        }
+    }
+    
+    return true;
+}
+
+bool init_scheduler_wait(uint32_t mask, uint32_t timeout_ms)
+{
+    if (!done_group) {
+        return false;
+    }
+    if (!mask) {
+        return true;
+    }
+    
+    TickType_t ticks = timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(done_group, mask, pdFALSE, pdTRUE, ticks);
+    return (bits & mask) == mask;
+}
+
+bool init_scheduler_is_done(uint32_t mask)
+{
+    return done_group && (xEventGroupGetBits(done_group) & mask) == mask;
+}
+
+uint32_t init_scheduler_elapsed_ms(void)
+{
+    return esp_log_timestamp() - boot_start_ms;
+}
+
+void init_scheduler_log(void)
+{
+    EventBits_t done = done_group ? xEventGroupGetBits(done_group) : 0;
+    
+    ESP_LOGI(TAG, "Boot steps (ms since start):");
+    for (int i = 0; i < step_count; i++) {
+        const step_state_t *state = &step_states[i];
+        if (done & INIT_STEP(i)) {
+            ESP_LOGI(TAG, "  %-12s start %5lu  took %5lu  %s", state->step->name, (unsigned long)state->start_ms,
+                     (unsigned long)state->duration_ms, esp_err_to_name(state->result));
+        } else {
+            ESP_LOGI(TAG, "  %-12s still running", state->step->name);
+        }
+    }
+}
@@ -0,0 +1,619 @@
+#include "metrics_server.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_http_server.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "task_plan.h"
+#include "telemetry.h"
+#include "heap_account.h"
+#include "network_manager.h"
+#include "radio_scheduler.h"
+#include "wifi_station.h"
+#include "sleep_manager.h"
+#include "power_profile.h"
+#include "event_bus.h"
+#include "gps_handler.h"
+#include "latency_budget.h"
+#include "energy_account.h"
+#include "binlog.h"
+
+static const char *TAG = "METRICS";
+
+#define LABELS_MAX      96
+#define JSON_RESERVE    3      // "}}" and the terminator always fit
+
+typedef enum {
+    FORMAT_PROM,
+    FORMAT_JSON,
+    FORMAT_COUNT
+} metrics_format_t;
+
+typedef struct {
+    char *data;
+    size_t cap;
+    size_t len;
+    bool overflow;     // stopped appending this refresh
+} metrics_buffer_t;
+
+struct metrics_writer {
+    metrics_buffer_t *prom;
+    metrics_buffer_t *json;
+    const char *family;
+    bool json_first;        // nothing in the root object yet
+    bool json_family_open;  // a labeled family's object is open
+};
+
+// Log names, in the component enums' order
+static const char *heap_names[TELEMETRY_HEAP_COUNT] = { "internal", "dma", "psram" };
+static const char *radio_mode_names[RADIO_MODE_COUNT] = { "immediate", "batched" };
+static const char *sleep_mode_names[SLEEP_MODE_COUNT] = { "active", "light", "deep" };
+static const char *profile_names[POWER_PROFILE_COUNT] = { "navigating", "menu", "idle" };
+static const char *format_names[FORMAT_COUNT] = { "prometheus", "json" };
+
+// The buffers belong to whoever holds buffer_mutex: the refresh task while
+// formatting, a handler while sending
+static SemaphoreHandle_t buffer_mutex = NULL;
+static metrics_buffer_t prom_buffer = {};
+static metrics_buffer_t json_buffer = {};
+static metrics_extra_fn_t extra_fn = NULL;
+static httpd_handle_t server = NULL;
+static TaskHandle_t refresh_task_handle = NULL;
+
+// Scrape bookkeeping, from the HTTP server task
+static portMUX_TYPE scrape_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t last_scrape_us = 0;
+static uint32_t scrapes[FORMAT_COUNT];
+
+// Refresh task only
+static uint32_t refreshes = 0;
+static uint32_t last_refresh_us = 0;
+static uint32_t overflows = 0;
+static telemetry_snapshot_t snapshot;
+
+static bool alloc_buffer(metrics_buffer_t *buffer, size_t cap);
+static void refresh_task(void *pvParameters);
+static void refresh(void);
+static esp_err_t prom_handler(httpd_req_t *req);
+static esp_err_t json_handler(httpd_req_t *req);
+static esp_err_t serve(httpd_req_t *req, metrics_format_t format);
+static bool append(metrics_buffer_t *buffer, size_t reserve, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+static void emit(metrics_writer_t *w, const char *suffix, double value, const char *labels);
+static void end_family(metrics_writer_t *w);
+static void write_system(metrics_writer_t *w);
+static void write_heap_account(metrics_writer_t *w);
+static void write_network(metrics_writer_t *w);
+static void write_gps(metrics_writer_t *w);
+static void write_render(metrics_writer_t *w);
+static void write_power(metrics_writer_t *w);
+static void write_runtime(metrics_writer_t *w);
+
+bool metrics_server_start(uint16_t port)
+{
+    if (server) {
+        return true;
+    }
+
+    buffer_mutex = xSemaphoreCreateMutex();
+    if (!buffer_mutex || !alloc_buffer(&prom_buffer, METRICS_PROM_BUFFER) ||
+        !alloc_buffer(&json_buffer, METRICS_JSON_BUFFER)) {
+        ESP_LOGE(TAG, "No memory for the metrics buffers");
+        return false;
+    }
+
+    // Scrapes are background work: protocol core, below everything else there
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    config.ctrl_port = port + 1;
+    config.task_priority = TASK_PRIO_METRICS;
+    config.core_id = TASK_CORE_PROTOCOL;
+    config.stack_size = METRICS_STACK_SIZE;
+    config.max_open_sockets = 2;
+    config.max_uri_handlers = 2;
+    config.lru_purge_enable = true;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the metrics server on port %u", port);
+        server = NULL;
+        return false;
+    }
+
+    static const httpd_uri_t prom_uri = { "/metrics", HTTP_GET, prom_handler, NULL };
+    static const httpd_uri_t json_uri = { "/metrics.json", HTTP_GET, json_handler, NULL };
+    httpd_register_uri_handler(server, &prom_uri);
+    httpd_register_uri_handler(server, &json_uri);
+
+    xTaskCreatePinnedToCore(refresh_task, "metrics", METRICS_STACK_SIZE, NULL, TASK_PRIO_METRICS,
+                            &refresh_task_handle, TASK_CORE_PROTOCOL);
+    ESP_LOGI(TAG, "Metrics on port %u: /metrics (Prometheus), /metrics.json", port);
+    return true;
+}
+
+void metrics_server_set_extra(metrics_extra_fn_t fn)
+{
+    extra_fn = fn;
+}
+
+void metrics_family(metrics_writer_t *w, const char *name, const char *type, const char *help)
+{
+    end_family(w);
+    w->family = name;
+    append(w->prom, 0, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_value(metrics_writer_t *w, double value)
+{
+    emit(w, "", value, NULL);
+}
+
+void metrics_sample(metrics_writer_t *w, double value, const char *labels_format, ...)
+{
+    char labels[LABELS_MAX];
+    va_list args;
+    va_start(args, labels_format);
+    vsnprintf(labels, sizeof(labels), labels_format, args);
+    va_end(args);
+    emit(w, "", value, labels);
+}
+
+static bool alloc_buffer(metrics_buffer_t *buffer, size_t cap)
+{
+    buffer->data = (char *)heap_caps_malloc(cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buffer->data) {
+        buffer->data = (char *)malloc(cap);
+    }
+    buffer->cap = cap;
+    buffer->len = 0;
+    return buffer->data != NULL;
+}
+
+static void refresh_task(void *pvParameters)
+{
+    while (1) {
+        refresh();
+
+        // Keep the figures fresh while someone scrapes; otherwise wait for a scrape
+        portENTER_CRITICAL(&scrape_lock);
+        bool active = last_scrape_us && esp_timer_get_time() - last_scrape_us < (int64_t)METRICS_IDLE_MS * 1000;
+        portEXIT_CRITICAL(&scrape_lock);
+        ulTaskNotifyTake(pdTRUE, active ? pdMS_TO_TICKS(METRICS_REFRESH_MS) : portMAX_DELAY);
+    }
+}
+
+static void refresh(void)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    xSemaphoreTake(buffer_mutex, portMAX_DELAY);
+    uint32_t prom_used = prom_buffer.len;
+    uint32_t json_used = json_buffer.len;
+    prom_buffer.len = 0;
+    prom_buffer.overflow = false;
+    json_buffer.len = 0;
+    json_buffer.overflow = false;
+
+    metrics_writer_t w = { &prom_buffer, &json_buffer, NULL, true, false };
+    append(w.json, JSON_RESERVE, "{");
+    write_system(&w);
+    write_heap_account(&w);
+    write_network(&w);
+    write_gps(&w);
+    write_render(&w);
+    write_power(&w);
+    write_runtime(&w);
+    if (extra_fn) {
+        extra_fn(&w);
+    }
+
+    // About the previous refresh, which this one replaces
+    uint32_t scrape_counts[FORMAT_COUNT];
+    portENTER_CRITICAL(&scrape_lock);
+    memcpy(scrape_counts, scrapes, sizeof(scrape_counts));
+    portEXIT_CRITICAL(&scrape_lock);
+    metrics_family(&w, "waypoint_metrics_scrapes_total", "counter", "Scrapes served");
+    for (int i = 0; i < FORMAT_COUNT; i++) {
+        metrics_sample(&w, scrape_counts[i], "format=\"%s\"", format_names[i]);
+    }
+    metrics_family(&w, "waypoint_metrics_buffer_bytes", "gauge", "Bytes used by the previous refresh");
+    metrics_sample(&w, prom_used, "format=\"prometheus\"");
+    metrics_sample(&w, json_used, "format=\"json\"");
+    metrics_family(&w, "waypoint_metrics_refresh_seconds", "gauge", "Time the previous refresh took");
+    metrics_value(&w, last_refresh_us / 1e6);
+    metrics_family(&w, "waypoint_metrics_overflows_total", "counter", "Refreshes cut short by a full buffer");
+    metrics_value(&w, overflows);
+    end_family(&w);
+    append(w.json, 0, "}");
+
+    bool overflow = prom_buffer.overflow || json_buffer.overflow;
+    xSemaphoreGive(buffer_mutex);
+
+    refreshes++;
+    last_refresh_us = (uint32_t)(esp_timer_get_time() - start_us);
+    if (overflow && overflows++ == 0) {
+        ESP_LOGW(TAG, "Metrics cut short, raise METRICS_PROM_BUFFER or METRICS_JSON_BUFFER");
+    }
+}
+
+static esp_err_t prom_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    return serve(req, FORMAT_PROM);
+}
+
+static esp_err_t json_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    return serve(req, FORMAT_JSON);
+}
+
+// Sends the last refresh as it is; nothing is formatted here
+static esp_err_t serve(httpd_req_t *req, metrics_format_t format)
+{
+    metrics_buffer_t *buffer = format == FORMAT_PROM ? &prom_buffer : &json_buffer;
+
+    xSemaphoreTake(buffer_mutex, portMAX_DELAY);
+    esp_err_t err = httpd_resp_send(req, buffer->data, buffer->len);
+    xSemaphoreGive(buffer_mutex);
+
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&scrape_lock);
+    bool idle = !last_scrape_us || now_us - last_scrape_us >= (int64_t)METRICS_IDLE_MS * 1000;
+    last_scrape_us = now_us;
+    scrapes[format]++;
+    portEXIT_CRITICAL(&scrape_lock);
+
+    if (idle && refresh_task_handle) {
+        xTaskNotifyGive(refresh_task_handle);
+    }
+    return err;
+}
+
+// Appends whole or not at all; after the first miss the buffer takes nothing
+// more this refresh, so the output stays well formed
+static bool append(metrics_buffer_t *buffer, size_t reserve, const char *format, ...)
+{
+    if (buffer->overflow) {
+        return false;
+    }
+
+    size_t room = buffer->cap - buffer->len;
+    room = room > reserve ? room - reserve : 0;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer->data + buffer->len, room, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= room) {
+        buffer->overflow = true;
+        buffer->data[buffer->len] = '\0';
+        return false;
+    }
+    buffer->len += n;
+    return true;
+}
+
+static void emit(metrics_writer_t *w, const char *suffix, double value, const char *labels)
+{
+    if (!w->family) {
+        return;
+    }
+    bool labeled = labels && labels[0];
+
+    if (labeled) {
+        append(w->prom, 0, "%s%s{%s} %.10g\n", w->family, suffix, labels, value);
+    } else {
+        append(w->prom, 0, "%s%s %.10g\n", w->family, suffix, value);
+    }
+
+    // JSON keys are the suffix and labels without quotes: "endpoint=gps,le=0.004"
+    char key[LABELS_MAX + 16];
+    size_t len = 0;
+    if (suffix[0]) {
+        len = snprintf(key, sizeof(key), "%s", suffix + 1);
+    }
+    if (labeled) {
+        if (len && len < sizeof(key) - 1) key[len++] = ',';
+        for (const char *c = labels; *c && len < sizeof(key) - 1; c++) {
+            if (*c != '"' && *c != '\\') key[len++] = *c;
+        }
+    }
+    key[len < sizeof(key) ? len : sizeof(key) - 1] = '\0';
+
+    const char *separator = w->json_first ? "" : ",";
+    if (!key[0]) {
+        if (append(w->json, JSON_RESERVE, "%s\"%s\":%.10g", separator, w->family, value)) {
+            w->json_first = false;
+        }
+    } else if (!w->json_family_open) {
+        if (append(w->json, JSON_RESERVE, "%s\"%s\":{\"%s\":%.10g", separator, w->family, key, value)) {
+            w->json_first = false;
+            w->json_family_open = true;
+        }
+    } else {
+        append(w->json, JSON_RESERVE, ",\"%s\":%.10g", key, value);
+    }
+}
+
+static void end_family(metrics_writer_t *w)
+{
+    if (w->json_family_open) {
+        // Always fits in the reserve
+        append(w->json, 0, "}");
+        w->json_family_open = false;
+    }
+    w->family = NULL;
+}
+
+// Uptime, CPU, tasks and heaps from the last telemetry sample
+static void write_system(metrics_writer_t *w)
+{
+    telemetry_get_snapshot(&snapshot);
+
+    metrics_family(w, "waypoint_uptime_seconds", "gauge", "Time since boot");
+    metrics_value(w, esp_timer_get_time() / 1e6);
+
+    if (snapshot.run_time_stats) {
+        metrics_family(w, "waypoint_cpu_load_ratio", "gauge", "Core load over the last telemetry sample");
+        for (int i = 0; i < snapshot.core_count; i++) {
+            metrics_sample(w, snapshot.cores[i].load / 1000.0, "core=\"%d\"", i);
+        }
+        metrics_family(w, "waypoint_task_cpu_ratio", "gauge", "Share of one core per task");
+        for (int i = 0; i < snapshot.task_count; i++) {
+            metrics_sample(w, snapshot.tasks[i].cpu.load / 1000.0, "task=\"%s\"", snapshot.tasks[i].name);
+        }
+    }
+    metrics_family(w, "waypoint_task_stack_free_bytes", "gauge", "Stack never used since the task started");
+    for (int i = 0; i < snapshot.task_count; i++) {
+        metrics_sample(w, snapshot.tasks[i].stack_free_min, "task=\"%s\"", snapshot.tasks[i].name);
+    }
+
+    metrics_family(w, "waypoint_heap_free_bytes", "gauge", "Free heap per capability");
+    for (int i = 0; i < TELEMETRY_HEAP_COUNT; i++) {
+        if (snapshot.heaps[i].total) metrics_sample(w, snapshot.heaps[i].free, "heap=\"%s\"", heap_names[i]);
+    }
+    metrics_family(w, "waypoint_heap_largest_free_bytes", "gauge", "Largest free block per capability");
+    for (int i = 0; i < TELEMETRY_HEAP_COUNT; i++) {
+        if (snapshot.heaps[i].total) metrics_sample(w, snapshot.heaps[i].largest, "heap=\"%s\"", heap_names[i]);
+    }
+    metrics_family(w, "waypoint_heap_low_water_bytes", "gauge", "Lowest free heap since boot");
+    for (int i = 0; i < TELEMETRY_HEAP_COUNT; i++) {
+        if (snapshot.heaps[i].total) metrics_sample(w, snapshot.heaps[i].low_water, "heap=\"%s\"", heap_names[i]);
+    }
+}
+
+static void write_heap_account(metrics_writer_t *w)
+{
+    heap_account_stats_t stats;
+    heap_account_get_stats(&stats);
+    if (!stats.hooks_enabled) return;
+
+    metrics_family(w, "waypoint_heap_allocs_total", "counter", "Allocations per subsystem");
+    for (int i = 0; i < HEAP_ACCOUNT_TAG_COUNT; i++) {
+        metrics_sample(w, stats.tags[i].allocs, "subsystem=\"%s\"", heap_account_tag_name((heap_account_tag_t)i));
+    }
+    metrics_family(w, "waypoint_heap_alloc_bytes_total", "counter", "Bytes allocated per subsystem");
+    for (int i = 0; i < HEAP_ACCOUNT_TAG_COUNT; i++) {
+        metrics_sample(w, stats.tags[i].bytes, "subsystem=\"%s\"", heap_account_tag_name((heap_account_tag_t)i));
+    }
+    metrics_family(w, "waypoint_heap_in_use_bytes", "gauge", "Tagged bytes still allocated");
+    for (int i = 1; i < HEAP_ACCOUNT_TAG_COUNT; i++) {
+        metrics_sample(w, stats.tags[i].in_use, "subsystem=\"%s\"", heap_account_tag_name((heap_account_tag_t)i));
+    }
+    metrics_family(w, "waypoint_heap_no_alloc_violations_total", "counter", "Allocations in no-alloc regions");
+    metrics_value(w, stats.no_alloc_violations);
+}
+
+// Per-endpoint HTTP counters and latency histograms, push channel, WiFi and radio
+static void write_network(metrics_writer_t *w)
+{
+    nm_endpoint_stats_t st[NM_ENDPOINT_COUNT];
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        network_manager_get_endpoint_stats((nm_endpoint_t)i, &st[i]);
+    }
+
+    metrics_family(w, "waypoint_http_requests_total", "counter", "Attempts per endpoint, retries included");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].requests, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_timeouts_total", "counter", "Attempts that timed out");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].timeouts, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_failures_total", "counter", "Calls that gave up");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].failures, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_skipped_total", "counter", "Calls refused before any I/O (circuit open)");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].skipped, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_responses_total", "counter", "Responses per status class");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        for (int c = 0; c < 5; c++) {
+            if (!st[i].status_classes[c]) continue;
+            metrics_sample(w, st[i].status_classes[c], "endpoint=\"%s\",class=\"%dxx\"",
+                           network_manager_endpoint_name((nm_endpoint_t)i), c + 1);
+        }
+        metrics_sample(w, st[i].transport_errors, "endpoint=\"%s\",class=\"none\"",
+                       network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_sent_bytes_total", "counter", "Request bodies as sent");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].bytes_sent, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_received_bytes_total", "counter", "Response bodies as received");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].bytes_received, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+    metrics_family(w, "waypoint_http_srtt_seconds", "gauge", "Smoothed round-trip time");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        metrics_sample(w, st[i].srtt_ms / 1000.0, "endpoint=\"%s\"", network_manager_endpoint_name((nm_endpoint_t)i));
+    }
+
+    // Log2 buckets: bucket b holds [2^b, 2^(b+1)) ms, the last one everything above
+    metrics_family(w, "waypoint_http_latency_seconds", "histogram", "Request latency per endpoint");
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        const char *name = network_manager_endpoint_name((nm_endpoint_t)i);
+        char labels[LABELS_MAX];
+        uint32_t cumulative = 0;
+        for (int b = 0; b < NM_LATENCY_BUCKETS; b++) {
+            cumulative += st[i].latency_hist[b];
+            if (b < NM_LATENCY_BUCKETS - 1) {
+                snprintf(labels, sizeof(labels), "endpoint=\"%s\",le=\"%g\"", name, (2u << b) / 1000.0);
+            } else {
+                snprintf(labels, sizeof(labels), "endpoint=\"%s\",le=\"+Inf\"", name);
+            }
+            emit(w, "_bucket", cumulative, labels);
+        }
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", name);
+        emit(w, "_sum", st[i].latency_sum_ms / 1000.0, labels);
+        emit(w, "_count", cumulative, labels);
+    }
+
+    nm_push_stats_t push;
+    network_manager_get_push_stats(&push);
+    metrics_family(w, "waypoint_push_connected", "gauge", "WebSocket push channel up");
+    metrics_value(w, network_manager_push_connected());
+    metrics_family(w, "waypoint_push_messages_total", "counter", "Push channel traffic");
+    metrics_sample(w, push.pushes, "kind=\"push\"");
+    metrics_sample(w, push.frames_in, "kind=\"frame_in\"");
+    metrics_sample(w, push.frames_out, "kind=\"frame_out\"");
+    metrics_sample(w, push.disconnects, "kind=\"disconnect\"");
+    metrics_family(w, "waypoint_backend_health", "gauge", "0 unknown, 1 up, 2 degraded, 3 down");
+    metrics_value(w, network_manager_get_backend_health());
+
+    wifi_station_stats_t wifi;
+    wifi_station_get_stats(&wifi);
+    metrics_family(w, "waypoint_wifi_connected", "gauge", "WiFi link up");
+    metrics_value(w, wifi_station_is_connected());
+    metrics_family(w, "waypoint_wifi_events_total", "counter", "WiFi connects and drops");
+    metrics_sample(w, wifi.connects, "event=\"connect\"");
+    metrics_sample(w, wifi.fast_connects, "event=\"fast_connect\"");
+    metrics_sample(w, wifi.disconnects, "event=\"disconnect\"");
+    metrics_sample(w, wifi.retries, "event=\"retry\"");
+    metrics_family(w, "waypoint_wifi_connect_seconds", "gauge", "Link lost to IP, latest connect");
+    metrics_value(w, wifi.last_connect_ms / 1000.0);
+
+    radio_mode_stats_t radio[RADIO_MODE_COUNT];
+    radio_scheduler_get_stats(radio);
+    metrics_family(w, "waypoint_radio_on_seconds_total", "counter", "Radio on beyond DTIM beacons");
+    for (int i = 0; i < RADIO_MODE_COUNT; i++) {
+        metrics_sample(w, radio[i].radio_on_ms / 1000.0, "mode=\"%s\"", radio_mode_names[i]);
+    }
+    metrics_family(w, "waypoint_radio_wakes_total", "counter", "Separate radio-on periods");
+    for (int i = 0; i < RADIO_MODE_COUNT; i++) {
+        metrics_sample(w, radio[i].wakes, "mode=\"%s\"", radio_mode_names[i]);
+    }
+}
+
+static void write_gps(metrics_writer_t *w)
+{
+    gps_handler_stats_t gps;
+    gps_handler_get_stats(&gps);
+    metrics_family(w, "waypoint_gps_connected", "gauge", "Phone connected over BLE");
+    metrics_value(w, gps_handler_is_connected());
+    metrics_family(w, "waypoint_gps_received_total", "counter", "GPS input from the phone");
+    metrics_sample(w, gps.writes, "kind=\"write\"");
+    metrics_sample(w, gps.bytes, "kind=\"byte\"");
+    metrics_sample(w, gps.sentences, "kind=\"sentence\"");
+    metrics_family(w, "waypoint_gps_fixes_total", "counter", "Position fixes parsed");
+    metrics_value(w, gps.fixes);
+
+    gps_upload_stats_t uploads;
+    network_manager_get_gps_upload_stats(&uploads);
+    metrics_family(w, "waypoint_gps_uploads_total", "counter", "Fixes through the upload governor");
+    metrics_sample(w, uploads.sent, "result=\"sent\"");
+    metrics_sample(w, uploads.suppressed, "result=\"suppressed\"");
+    metrics_sample(w, uploads.coalesced, "result=\"coalesced\"");
+    metrics_sample(w, uploads.rejected, "result=\"rejected\"");
+    metrics_sample(w, uploads.failed, "result=\"failed\"");
+    metrics_sample(w, uploads.skipped, "result=\"skipped\"");
+}
+
+// GPS-to-pixel stages, and input-to-frame latency per power profile
+static void write_render(metrics_writer_t *w)
+{
+    latency_budget_stats_t latency;
+    latency_budget_get_stats(&latency);
+
+    // Percentiles over the recent-fix window, not a cumulative summary, so the
+    // label is percentile rather than quantile
+    metrics_family(w, "waypoint_fix_latency_seconds", "gauge", "GPS-to-pixel latency percentile per stage, recent fixes");
+    for (int i = 0; i <= LATENCY_STAGE_COUNT; i++) {
+        const latency_stage_stats_t *s = i < LATENCY_STAGE_COUNT ? &latency.stages[i] : &latency.total;
+        const char *stage = i < LATENCY_STAGE_COUNT ? latency_budget_stage_name((latency_stage_t)i) : "total";
+        if (!s->count) continue;
+        metrics_sample(w, s->p50_us / 1e6, "stage=\"%s\",percentile=\"50\"", stage);
+        metrics_sample(w, s->p95_us / 1e6, "stage=\"%s\",percentile=\"95\"", stage);
+        metrics_sample(w, s->p99_us / 1e6, "stage=\"%s\",percentile=\"99\"", stage);
+        metrics_sample(w, s->max_us / 1e6, "stage=\"%s\",percentile=\"100\"", stage);
+    }
+    metrics_family(w, "waypoint_fix_latency_violations_total", "counter", "Fixes over a stage budget");
+    for (int i = 0; i <= LATENCY_STAGE_COUNT; i++) {
+        const latency_stage_stats_t *s = i < LATENCY_STAGE_COUNT ? &latency.stages[i] : &latency.total;
+        const char *stage = i < LATENCY_STAGE_COUNT ? latency_budget_stage_name((latency_stage_t)i) : "total";
+        metrics_sample(w, s->violations, "stage=\"%s\"", stage);
+    }
+
+    power_profile_stats_t profiles[POWER_PROFILE_COUNT];
+    power_profile_get_stats(profiles);
+    metrics_family(w, "waypoint_ui_events_total", "counter", "Inputs handled per power profile");
+    for (int i = 0; i < POWER_PROFILE_COUNT; i++) {
+        metrics_sample(w, profiles[i].ui_events, "profile=\"%s\"", profile_names[i]);
+    }
+    metrics_family(w, "waypoint_ui_latency_seconds_total", "counter", "Input-to-frame time per power profile");
+    for (int i = 0; i < POWER_PROFILE_COUNT; i++) {
+        metrics_sample(w, profiles[i].ui_latency_total_ms / 1000.0, "profile=\"%s\"", profile_names[i]);
+    }
+}
+
+// Sleep residency and the energy estimate
+static void write_power(metrics_writer_t *w)
+{
+    sleep_stats_t sleep;
+    sleep_manager_get_stats(&sleep);
+    metrics_family(w, "waypoint_sleep_seconds_total", "counter", "Residency per sleep mode");
+    for (int i = 0; i < SLEEP_MODE_COUNT; i++) {
+        metrics_sample(w, sleep.modes[i].residency_ms / 1000.0, "mode=\"%s\"", sleep_mode_names[i]);
+    }
+
+    energy_stats_t energy;
+    energy_account_get_stats(&energy);
+    if (!energy.board) return;
+    metrics_family(w, "waypoint_energy_active_seconds_total", "counter", "Level-weighted active time per rail");
+    for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+        metrics_sample(w, energy.rails[i].active_us / 1e6, "rail=\"%s\"", energy_account_rail_name((energy_rail_t)i));
+    }
+    metrics_family(w, "waypoint_energy_current_ma", "gauge", "Estimated average current since boot");
+    for (int i = 0; i < ENERGY_RAIL_COUNT; i++) {
+        metrics_sample(w, energy.rails[i].ma, "rail=\"%s\"", energy_account_rail_name((energy_rail_t)i));
+    }
+    metrics_sample(w, energy.sleep_ma, "rail=\"sleep\"");
+    metrics_family(w, "waypoint_energy_total_current_ma", "gauge", "Estimated average current, all rails");
+    metrics_value(w, energy.total_ma);
+}
+
+// Event bus and deferred logging
+static void write_runtime(metrics_writer_t *w)
+{
+    bus_stats_t bus;
+    event_bus_get_stats(&bus);
+    metrics_family(w, "waypoint_bus_messages_total", "counter", "Event bus traffic");
+    metrics_sample(w, bus.published, "kind=\"published\"");
+    metrics_sample(w, bus.delivered, "kind=\"delivered\"");
+    metrics_sample(w, bus.pool_exhausted, "kind=\"pool_exhausted\"");
+    metrics_sample(w, bus.queue_full, "kind=\"queue_full\"");
+    metrics_family(w, "waypoint_bus_max_latency_seconds", "gauge", "Worst publish-to-receive delay");
+    metrics_value(w, bus.max_latency_ms / 1000.0);
+
+    binlog_stats_t log;
+    binlog_get_stats(&log);
+    metrics_family(w, "waypoint_binlog_records_total", "counter", "Deferred log records");
+    metrics_sample(w, log.written, "kind=\"written\"");
+    metrics_sample(w, log.dropped, "kind=\"dropped\"");
+}
@@ -8,6 +8,89 @@
 extern "C" {
 #endif
 
+// Distance the user has to move away from the point a prefetched sidequest
+// was generated for before a new one is requested
+#define SIDEQUEST_PREFETCH_DEFAULT_DISTANCE_M 500.0f
+
+// GPS upload governor policy. A fix is uploaded when it moved further than
+// max(min_distance_m, accuracy * accuracy_scale) from the last uploaded fix,
+// when the direction of travel turned by more than heading_change_deg, or
+// when heartbeat_ms passed since the last upload. Fixes implying a speed
+// above max_speed_mps are rejected as GPS glitches.
+typedef struct {
+    float min_distance_m;
+    float accuracy_scale;
+    float heading_change_deg;
+    uint32_t heartbeat_ms;
+    float max_speed_mps;
+} gps_upload_policy_t;
+
+#define GPS_UPLOAD_POLICY_DEFAULT { \
+    .min_distance_m = 15.0f,        \
+    .accuracy_scale = 5.0f,         \
+    .heading_change_deg = 30.0f,    \
+    .heartbeat_ms = 60000,          \
+    .max_speed_mps = 50.0f,         \
+}
+
+typedef struct {
+    uint32_t sent;
+    uint32_t suppressed;
+    uint32_t coalesced;   // queued fixes replaced by a newer one before their radio window
+    uint32_t rejected;
+    uint32_t failed;
+    uint32_t skipped;     // not attempted, backend circuit open
+} gps_upload_stats_t;
+
+// Backend health as seen by real traffic and idle probes
+typedef enum {
+    BACKEND_HEALTH_UNKNOWN,   // nothing sent yet
+    BACKEND_HEALTH_UP,        // last request reached the backend
+    BACKEND_HEALTH_DEGRADED,  // recent failures, still trying
+    BACKEND_HEALTH_DOWN       // circuit open, requests fail fast
+} backend_health_t;
+
+// Log2 latency histogram buckets per endpoint: <2 ms up to >= 32 s
+#define NM_LATENCY_BUCKETS 16
+
+// Backend endpoints, each with its own RTT estimate and counters
+typedef enum {
+    NM_ENDPOINT_HEALTH,
+    NM_ENDPOINT_GPS,
+    NM_ENDPOINT_LOCATION_SAVE,
+    NM_ENDPOINT_LOCATION_LIST,
+    NM_ENDPOINT_SAFETY,
+    NM_ENDPOINT_SIDEQUEST,
+    NM_ENDPOINT_COUNT
+} nm_endpoint_t;
+
+typedef struct {
+    uint32_t srtt_ms;     // smoothed round-trip time, 0 until the first sample
+    uint32_t rttvar_ms;   // round-trip time variation
+    uint32_t timeout_ms;  // current per-attempt timeout
+    uint32_t requests;    // attempts, including retries
+    uint32_t timeouts;
+    uint32_t retries;
+    uint32_t failures;    // calls that gave up after at least one attempt
+    uint32_t skipped;     // calls refused before any I/O (circuit open)
+    uint32_t bytes_sent;      // request bodies as sent, after deflate
+    uint32_t bytes_sent_raw;  // request bodies before deflate
+    uint32_t bytes_received;  // response bodies as received, before inflate
+    uint32_t bytes_decoded;   // response bodies after inflate
+    // Smoothed phase timings (ms). connect covers TCP plus the TLS handshake,
+    // which esp_http_client reports as one step; ttfb and first_data are
+    // measured from the start of the request.
+    uint32_t dns_ms;
+    uint32_t connect_ms;
+    uint32_t ttfb_ms;
+    uint32_t first_data_ms;   // first decoded body byte
+    uint32_t total_ms;
+    uint32_t latency_hist[NM_LATENCY_BUCKETS];  // bucket i: total in [2^i, 2^(i+1)) ms, 0: < 2 ms
+    uint32_t latency_sum_ms;                    // of every total in the histogram
+    uint32_t status_classes[5];                 // 1xx..5xx responses
+    uint32_t transport_errors;                  // no HTTP status (DNS, connect, timeout)
+} nm_endpoint_stats_t;
+
 // Function declarations
 void network_manager_init(const char *backend_url);
 bool network_manager_test_connectivity(void);
@@ -17,6 +100,71 @@ bool network_manager_select_target_location(target_data_t *target);
 bool network_manager_check_location_safety(const gps_data_t *gps_data, safety_data_t *safety);
 bool network_manager_generate_sidequest(const gps_data_t *gps_data, sidequest_data_t *sidequest);
 
+// Same as above but giving up after deadline_ms in total, retries included
+bool network_manager_select_target_location_within(target_data_t *target, uint32_t deadline_ms);
+bool network_manager_check_location_safety_within(const gps_data_t *gps_data, safety_data_t *safety,
+                                                  uint32_t deadline_ms);
+
+// Timeout and retry statistics
+bool network_manager_get_endpoint_stats(nm_endpoint_t endpoint, nm_endpoint_stats_t *stats);
+const char *network_manager_endpoint_name(nm_endpoint_t endpoint);
+void network_manager_log_diagnostics(void);
+
+// Called with esp_timer_get_time() when each response's first header arrives,
+// on the requesting task
+typedef void (*nm_first_byte_callback_t)(int64_t at_us);
+void network_manager_set_first_byte_callback(nm_first_byte_callback_t callback);
+
+// gzip responses and deflated request bodies (CONFIG_SPIRAM builds only),
+// on by default. Turning it off
+// gives the uncompressed baseline for the byte and first-data counters.
+void network_manager_set_compression(bool enabled);
+
+// Passive backend health tracking. network_manager_health_poll() probes /health
+// only when there was no traffic for a while or a retry is due after an outage,
+// in the next radio window (radio_scheduler), and returns the number of
+// milliseconds until it should be called again.
+backend_health_t network_manager_get_backend_health(void);
+bool network_manager_backend_available(void);
+uint32_t network_manager_health_poll(bool link_up);
+
+// Rate-controlled GPS upload. Fixes that pass the governor are sent in the
+// next radio window (the latest one wins); returns true when one was queued.
+void network_manager_gps_upload_configure(const gps_upload_policy_t *policy);
+bool network_manager_submit_gps_fix(const gps_data_t *gps_data);
+void network_manager_get_gps_upload_stats(gps_upload_stats_t *stats);
+
+// Background sidequest prefetch: keeps one sidequest ready for the current area,
+// fetched in radio windows
+void network_manager_sidequest_prefetch_start(float regen_distance_m);
+void network_manager_sidequest_prefetch_update(const gps_data_t *gps_data);
+bool network_manager_sidequest_prefetch_take(const gps_data_t *gps_data, sidequest_data_t *sidequest);
+
+// Push channel (WebSocket to /ws/device). Handlers run on the WebSocket
+// task and must only copy the data and signal the application. While the
+// channel is up, governed GPS uploads go over it instead of HTTP.
+typedef struct {
+    void (*on_target)(const target_data_t *target);
+    void (*on_safety)(const safety_data_t *safety);
+    void (*on_sidequest)(const sidequest_data_t *sidequest);
+} nm_push_handlers_t;
+
+typedef struct {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t pushes;      // target/safety/sidequest messages received
+    uint32_t frames_in;
+    uint32_t frames_out;  // GPS frames sent
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+} nm_push_stats_t;
+
+bool network_manager_push_start(const char *device_id, const nm_push_handlers_t *handlers);
+void network_manager_push_stop(void);
+bool network_manager_push_connected(void);
+bool network_manager_push_send_gps(const gps_data_t *gps_data);
+void network_manager_get_push_stats(nm_push_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
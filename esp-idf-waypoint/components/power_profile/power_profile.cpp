@@ -0,0 +1,179 @@
+#include "power_profile.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "energy_account.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static const char *TAG = "POWER_PROFILE";
+
+typedef struct {
+    const char *name;
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep;
+    float current_ma;
+} profile_config_t;
+
+// Navigating keeps the idle task awake: the BLE link and a redraw every fix
+// leave too little idle time for light sleep to pay for its wake latency
+static const profile_config_t profile_configs[POWER_PROFILE_COUNT] = {
+    { "navigating", 240, 80, false, POWER_PROFILE_NAVIGATING_MA },
+    { "menu",       160, 40, true,  POWER_PROFILE_MENU_MA },
+    { "idle",       80,  40, true,  POWER_PROFILE_IDLE_MA },
+};
+
+static power_profile_t current_profile = POWER_PROFILE_MENU;
+static int64_t profile_start_us = 0;
+static bool initialized = false;
+
+static portMUX_TYPE profile_lock = portMUX_INITIALIZER_UNLOCKED;
+static power_profile_stats_t profile_stats[POWER_PROFILE_COUNT] = {};
+
+static void apply_profile(power_profile_t profile);
+static void account_current(int64_t now_us);
+static void count_light_sleep(void);
+
+void power_profile_init(power_profile_t initial)
+{
+    profile_start_us = esp_timer_get_time();
+    current_profile = initial;
+    profile_stats[initial].entries++;
+    initialized = true;
+    apply_profile(initial);
+    count_light_sleep();
+}
+
+void power_profile_set(power_profile_t profile)
+{
+    if (!initialized || profile == current_profile || profile >= POWER_PROFILE_COUNT) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&profile_lock);
+    account_current(esp_timer_get_time());
+    current_profile = profile;
+    profile_stats[profile].entries++;
+    portEXIT_CRITICAL(&profile_lock);
+    
+    apply_profile(profile);
+}
+
+power_profile_t power_profile_get(void)
+{
+    return current_profile;
+}
+
+void power_profile_record_ui_latency(uint32_t latency_ms)
+{
+    portENTER_CRITICAL(&profile_lock);
+    power_profile_stats_t *stats = &profile_stats[current_profile];
+    stats->ui_events++;
+    stats->ui_latency_total_ms += latency_ms;
+    if (latency_ms > stats->ui_latency_max_ms) {
+        stats->ui_latency_max_ms = latency_ms;
+    }
+    portEXIT_CRITICAL(&profile_lock);
+}
+
+void power_profile_get_stats(power_profile_stats_t stats[POWER_PROFILE_COUNT])
+{
+    portENTER_CRITICAL(&profile_lock);
+    if (initialized) {
+        account_current(esp_timer_get_time());
+    }
+    memcpy(stats, profile_stats, sizeof(profile_stats));
+    portEXIT_CRITICAL(&profile_lock);
+}
+
+void power_profile_log_stats(void)
+{
+    power_profile_stats_t stats[POWER_PROFILE_COUNT];
+    power_profile_get_stats(stats);
+    
+    uint64_t total_ms = 0;
+    float charge = 0;
+    for (int i = 0; i < POWER_PROFILE_COUNT; i++) {
+        total_ms += stats[i].residency_ms;
+        charge += stats[i].residency_ms * profile_configs[i].current_ma;
+    }
+    
+    ESP_LOGI(TAG, "Power profile %s, estimated average current %.1f mA", profile_configs[current_profile].name,
+             total_ms ? charge / total_ms : profile_configs[current_profile].current_ma);
+    for (int i = 0; i < POWER_PROFILE_COUNT; i++) {
+        const power_profile_stats_t *s = &stats[i];
+        ESP_LOGI(TAG, "  %-10s %5.1f%% of time, %lu entries, ~%.0f mA, UI latency avg %lu ms, max %lu ms (%lu inputs)",
+                 profile_configs[i].name, total_ms ? s->residency_ms * 100.0 / total_ms : 0.0,
+                 (unsigned long)s->entries, profile_configs[i].current_ma,
+                 (unsigned long)(s->ui_events ? s->ui_latency_total_ms / s->ui_events : 0),
+                 (unsigned long)s->ui_latency_max_ms, (unsigned long)s->ui_events);
+    }
+
+#if CONFIG_PM_PROFILING
+    // Time per CPU mode (including light sleep) and lock holders since boot
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+static void apply_profile(power_profile_t profile)
+{
+    const profile_config_t *cfg = &profile_configs[profile];
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {};
+    pm_config.max_freq_mhz = cfg->max_freq_mhz;
+    pm_config.min_freq_mhz = cfg->min_freq_mhz;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm_config.light_sleep_enable = cfg->light_sleep;
+#endif
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Power profile %s not applied: %s", cfg->name, esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Power profile %s: %d-%d MHz, light sleep %s", cfg->name, cfg->min_freq_mhz,
+             cfg->max_freq_mhz, pm_config.light_sleep_enable ? "on" : "off");
+#else
+    ESP_LOGI(TAG, "Power profile %s (CONFIG_PM_ENABLE off, accounting only)", cfg->name);
+#endif
+}
+
+#if CONFIG_PM_ENABLE && CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+// Called by esp_pm on the way out of each automatic light sleep
+static esp_err_t IRAM_ATTR on_light_sleep_exit(int64_t sleep_time_us, void *arg)
+{
+    energy_account_add_sleep_us(sleep_time_us);
+    return ESP_OK;
+}
+#endif
+
+// The menu and idle profiles nap between bursts; the energy estimate's
+// awake floor only sees those naps through the PM exit callback
+static void count_light_sleep(void)
+{
+#if CONFIG_PM_ENABLE && CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {};
+    cbs.exit_cb = on_light_sleep_exit;
+    esp_err_t err = esp_pm_light_sleep_register_cbs(&cbs);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep not counted in the energy estimate: %s", esp_err_to_name(err));
+    }
+#elif CONFIG_PM_ENABLE
+    ESP_LOGW(TAG, "Light sleep not counted in the energy estimate (CONFIG_PM_LIGHT_SLEEP_CALLBACKS off)");
+#endif
+}
+
+// Caller holds profile_lock. Whole milliseconds move to the current
+// profile and the remainder stays in profile_start_us.
+static void account_current(int64_t now_us)
+{
+    int64_t elapsed_ms = (now_us - profile_start_us) / 1000;
+    profile_stats[current_profile].residency_ms += elapsed_ms;
+    profile_start_us += elapsed_ms * 1000;
+}
@@ -0,0 +1,322 @@
+#include "radio_scheduler.h"
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "task_plan.h"
+#include "heap_account.h"
+#include "energy_account.h"
+
+static const char *TAG = "RADIO_SCHEDULER";
+
+// Window jobs are GPS uploads, health probes and sidequest prefetches: HTTPS
+// requests with the TLS handshake on this stack, so it matches the network
+// task's. The headroom left is logged with the stats.
+#define SCHEDULER_STACK_SIZE 8192
+
+#define DTIM_INTERVAL_US ((int64_t)RADIO_SCHEDULER_BEACON_US * RADIO_SCHEDULER_DTIM_PERIOD)
+#define WINDOW_PERIOD_US ((int64_t)RADIO_SCHEDULER_WINDOW_MS * 1000 / DTIM_INTERVAL_US * DTIM_INTERVAL_US)
+
+typedef struct {
+    const char *name;
+    radio_job_fn_t fn;
+    void *arg;
+    bool pending;
+    int64_t deadline_us;
+    uint32_t runs;
+} radio_job_t;
+
+static radio_job_t jobs[RADIO_SCHEDULER_MAX_JOBS];
+static int job_count = 0;
+static TaskHandle_t scheduler_task_handle = NULL;
+
+// Everything below is protected by radio_lock
+static portMUX_TYPE radio_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool link_up = false;
+static int64_t link_origin_us = 0;   // DTIM intervals are counted from here
+static bool batching = true;
+static bool in_window = false;
+static bool piggyback = false;       // traffic outside a window has the radio awake
+static int64_t radio_on_until_us = 0;
+static int64_t mode_start_us = 0;
+static int64_t radio_on_us[RADIO_MODE_COUNT] = {};
+static radio_mode_stats_t mode_stats[RADIO_MODE_COUNT] = {};
+
+static void scheduler_task(void *pvParameters);
+static void run_window(void);
+static int64_t next_window_locked(int64_t now_us);
+static void account_elapsed_locked(int64_t now_us);
+
+void radio_scheduler_init(void)
+{
+    if (scheduler_task_handle) {
+        return;
+    }
+    
+    mode_start_us = esp_timer_get_time();
+    xTaskCreatePinnedToCore(scheduler_task, "radio_sched", SCHEDULER_STACK_SIZE, NULL, TASK_PRIO_RADIO,
+                            &scheduler_task_handle, TASK_CORE_PROTOCOL);
+    ESP_LOGI(TAG, "Radio scheduler started (%lld ms windows, %d ms DTIM)", (long long)(WINDOW_PERIOD_US / 1000),
+             (int)(DTIM_INTERVAL_US / 1000));
+}
+
+int radio_scheduler_register(const char *name, radio_job_fn_t fn, void *arg)
+{
+    int job = -1;
+    
+    portENTER_CRITICAL(&radio_lock);
+    if (job_count < RADIO_SCHEDULER_MAX_JOBS) {
+        job = job_count;
+        jobs[job].name = name;
+        jobs[job].fn = fn;
+        jobs[job].arg = arg;
+        job_count++;
+    }
+    portEXIT_CRITICAL(&radio_lock);
+    
+    if (job < 0) {
+        ESP_LOGE(TAG, "Too many radio jobs, %s not registered", name);
+    }
+    return job;
+}
+
+uint32_t radio_scheduler_defer(int job, uint32_t max_delay_ms)
+{
+    if (job < 0 || job >= job_count) {
+        return 0;
+    }
+    
+    int64_t now_us = esp_timer_get_time();
+    int64_t deadline_us = now_us + (int64_t)max_delay_ms * 1000;
+    
+    portENTER_CRITICAL(&radio_lock);
+    radio_job_t *j = &jobs[job];
+    if (!batching) {
+        deadline_us = now_us;
+    }
+    if (!j->pending || deadline_us < j->deadline_us) {
+        j->deadline_us = deadline_us;
+    }
+    j->pending = true;
+    int64_t window_us = next_window_locked(now_us);
+    portEXIT_CRITICAL(&radio_lock);
+    
+    if (scheduler_task_handle) {
+        xTaskNotifyGive(scheduler_task_handle);
+    }
+    
+    if (window_us == INT64_MAX) {
+        // No link; the job waits for the next association
+        return max_delay_ms;
+    }
+    return window_us > now_us ? (uint32_t)((window_us - now_us) / 1000) : 0;
+}
+
+void radio_scheduler_set_link(bool up)
+{
+    portENTER_CRITICAL(&radio_lock);
+    link_up = up;
+    if (up) {
+        // The association just had the radio on; catch up on what waited
+        link_origin_us = esp_timer_get_time();
+        piggyback = true;
+    }
+    portEXIT_CRITICAL(&radio_lock);
+    
+    if (scheduler_task_handle) {
+        xTaskNotifyGive(scheduler_task_handle);
+    }
+}
+
+void radio_scheduler_note_traffic(int64_t start_us, int64_t end_us)
+{
+    if (end_us < start_us) {
+        end_us = start_us;
+    }
+    int64_t until_us = end_us + RADIO_SCHEDULER_TAIL_MS * 1000;
+    int64_t added_us = 0;
+    bool wake = false;
+    
+    portENTER_CRITICAL(&radio_lock);
+    radio_mode_t mode = batching ? RADIO_MODE_BATCHED : RADIO_MODE_IMMEDIATE;
+    if (start_us > radio_on_until_us) {
+        mode_stats[mode].wakes++;
+        added_us = until_us - start_us;
+        radio_on_until_us = until_us;
+    } else if (until_us > radio_on_until_us) {
+        added_us = until_us - radio_on_until_us;
+        radio_on_until_us = until_us;
+    }
+    radio_on_us[mode] += added_us;
+    
+    // Pending jobs ride along with this wake instead of making their own
+    if (batching && !in_window) {
+        for (int i = 0; i < job_count; i++) {
+            if (jobs[i].pending) {
+                piggyback = true;
+                wake = true;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&radio_lock);
+    
+    if (added_us > 0) {
+        energy_account_add_us(ENERGY_RAIL_WIFI_RX, (uint32_t)added_us);
+    }
+    if (wake && scheduler_task_handle) {
+        xTaskNotifyGive(scheduler_task_handle);
+    }
+}
+
+void radio_scheduler_set_batching(bool enabled)
+{
+    portENTER_CRITICAL(&radio_lock);
+    account_elapsed_locked(esp_timer_get_time());
+    batching = enabled;
+    portEXIT_CRITICAL(&radio_lock);
+    
+    if (scheduler_task_handle) {
+        xTaskNotifyGive(scheduler_task_handle);
+    }
+    ESP_LOGI(TAG, "Radio batching %s", enabled ? "enabled" : "disabled");
+}
+
+void radio_scheduler_get_stats(radio_mode_stats_t stats[RADIO_MODE_COUNT])
+{
+    portENTER_CRITICAL(&radio_lock);
+    account_elapsed_locked(esp_timer_get_time());
+    for (int i = 0; i < RADIO_MODE_COUNT; i++) {
+        stats[i] = mode_stats[i];
+        stats[i].radio_on_ms = radio_on_us[i] / 1000;
+    }
+    portEXIT_CRITICAL(&radio_lock);
+}
+
+void radio_scheduler_log_stats(void)
+{
+    static const char *mode_names[RADIO_MODE_COUNT] = { "immediate", "batched" };
+    radio_mode_stats_t stats[RADIO_MODE_COUNT];
+    radio_scheduler_get_stats(stats);
+    
+    ESP_LOGI(TAG, "Radio: batching %s, scheduler stack %lu of %d bytes never used", batching ? "on" : "off",
+             scheduler_task_handle ? (unsigned long)uxTaskGetStackHighWaterMark(scheduler_task_handle) : 0UL,
+             SCHEDULER_STACK_SIZE);
+    double on_per_hour[RADIO_MODE_COUNT] = {};
+    for (int i = 0; i < RADIO_MODE_COUNT; i++) {
+        const radio_mode_stats_t *s = &stats[i];
+        if (s->elapsed_ms == 0) {
+            continue;
+        }
+        double hours = s->elapsed_ms / 3600000.0;
+        on_per_hour[i] = s->radio_on_ms / 1000.0 / hours;
+        ESP_LOGI(TAG, "  %-9s %7.1f s radio on/h, %6.1f wakes/h, %lu windows, %lu jobs over %llu s",
+                 mode_names[i], on_per_hour[i], s->wakes / hours, (unsigned long)s->windows,
+                 (unsigned long)s->jobs_run, (unsigned long long)(s->elapsed_ms / 1000));
+    }
+    if (on_per_hour[RADIO_MODE_IMMEDIATE] > 0 && stats[RADIO_MODE_BATCHED].elapsed_ms > 0) {
+        ESP_LOGI(TAG, "  batching changes radio-on time by %+.1f%%",
+                 (on_per_hour[RADIO_MODE_BATCHED] - on_per_hour[RADIO_MODE_IMMEDIATE]) * 100.0 /
+                 on_per_hour[RADIO_MODE_IMMEDIATE]);
+    }
+    
+    for (int i = 0; i < job_count; i++) {
+        ESP_LOGI(TAG, "  job %-14s %lu runs%s", jobs[i].name, (unsigned long)jobs[i].runs,
+                 jobs[i].pending ? ", pending" : "");
+    }
+}
+
+static void scheduler_task(void *pvParameters)
+{
+    heap_account_enter(HEAP_ACCOUNT_NETWORK);
+    
+    while (1) {
+        int64_t now_us = esp_timer_get_time();
+        portENTER_CRITICAL(&radio_lock);
+        int64_t window_us = next_window_locked(now_us);
+        portEXIT_CRITICAL(&radio_lock);
+        
+        if (window_us > now_us) {
+            // A defer, a link change or traffic may move the window; look again when notified
+            TickType_t wait = window_us == INT64_MAX ? portMAX_DELAY
+                                                     : pdMS_TO_TICKS((window_us - now_us + 999) / 1000) + 1;
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+        
+        run_window();
+    }
+}
+
+// Runs every pending job back to back while the radio is up
+static void run_window(void)
+{
+    portENTER_CRITICAL(&radio_lock);
+    in_window = true;
+    piggyback = false;
+    radio_mode_t mode = batching ? RADIO_MODE_BATCHED : RADIO_MODE_IMMEDIATE;
+    mode_stats[mode].windows++;
+    portEXIT_CRITICAL(&radio_lock);
+    
+    int ran = 0;
+    for (int i = 0; i < job_count; i++) {
+        portENTER_CRITICAL(&radio_lock);
+        bool run = jobs[i].pending;
+        jobs[i].pending = false;
+        portEXIT_CRITICAL(&radio_lock);
+        
+        if (!run) {
+            continue;
+        }
+        // A job may defer itself again; that lands in a later window
+        jobs[i].fn(jobs[i].arg);
+        jobs[i].runs++;
+        ran++;
+    }
+    
+    portENTER_CRITICAL(&radio_lock);
+    in_window = false;
+    mode_stats[mode].jobs_run += ran;
+    portEXIT_CRITICAL(&radio_lock);
+    
+    ESP_LOGD(TAG, "Window ran %d jobs", ran);
+}
+
+// When pending jobs should run: the next window boundary, or the DTIM wake
+// before the earliest deadline if that comes first. INT64_MAX: nothing to do.
+static int64_t next_window_locked(int64_t now_us)
+{
+    if (!link_up) {
+        return INT64_MAX;
+    }
+    
+    int64_t earliest_us = INT64_MAX;
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].pending && jobs[i].deadline_us < earliest_us) {
+            earliest_us = jobs[i].deadline_us;
+        }
+    }
+    if (earliest_us == INT64_MAX) {
+        return INT64_MAX;
+    }
+    if (piggyback) {
+        return now_us;
+    }
+    
+    int64_t window_us = link_origin_us + ((now_us - link_origin_us) / WINDOW_PERIOD_US + 1) * WINDOW_PERIOD_US;
+    if (earliest_us < window_us) {
+        window_us = link_origin_us + (earliest_us - link_origin_us) / DTIM_INTERVAL_US * DTIM_INTERVAL_US;
+    }
+    return window_us < now_us ? now_us : window_us;
+}
+
+// Whole milliseconds move to the current mode and the remainder stays in
+// mode_start_us
+static void account_elapsed_locked(int64_t now_us)
+{
+    radio_mode_t mode = batching ? RADIO_MODE_BATCHED : RADIO_MODE_IMMEDIATE;
+    int64_t elapsed_ms = (now_us - mode_start_us) / 1000;
+    mode_stats[mode].elapsed_ms += elapsed_ms;
+    mode_start_us += elapsed_ms * 1000;
+}
@@ -0,0 +1,270 @@
+#include "sleep_manager.h"
+#include <string.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+
+static const char *TAG = "SLEEP_MANAGER";
+
+#define SNAPSHOT_MAGIC   0x57505331  // "WPS1"
+#define ACCOUNTING_MAGIC 0x57504131  // "WPA1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t len;
+    uint32_t crc;
+    uint8_t data[SLEEP_SNAPSHOT_MAX_BYTES];
+} rtc_snapshot_t;
+
+// Per-mode accounting, carried across deep sleep
+typedef struct {
+    uint32_t magic;
+    sleep_mode_stats_t modes[SLEEP_MODE_COUNT];
+    int64_t deep_entered_us;  // wall clock (RTC timer) at deep sleep entry
+} rtc_accounting_t;
+
+static RTC_DATA_ATTR rtc_snapshot_t rtc_snapshot;
+static RTC_DATA_ATTR rtc_accounting_t rtc_accounting;
+
+static const char *mode_names[SLEEP_MODE_COUNT] = { "active", "light", "deep" };
+static const float mode_current_ma[SLEEP_MODE_COUNT] = {
+    SLEEP_CURRENT_ACTIVE_MA, SLEEP_CURRENT_LIGHT_MA, SLEEP_CURRENT_DEEP_MA
+};
+
+static int wake_gpio = -1;
+static bool deep_wake = false;
+static int64_t active_start_us = 0;
+static int64_t last_activity_us = 0;
+static volatile bool screen_off = false;
+
+// The wake whose first frame is still to be drawn
+static bool frame_pending = false;
+static sleep_mode_t frame_mode = SLEEP_MODE_DEEP;
+static int64_t frame_wake_us = 0;
+
+static portMUX_TYPE sleep_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t wall_clock_us(void);
+static void account_elapsed(int64_t now_us);
+
+void sleep_manager_init(int gpio)
+{
+    wake_gpio = gpio;
+    int64_t now_us = esp_timer_get_time();
+    active_start_us = now_us;
+    last_activity_us = now_us;
+    
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    deep_wake = cause != ESP_SLEEP_WAKEUP_UNDEFINED && rtc_accounting.magic == ACCOUNTING_MAGIC;
+    
+    if (!deep_wake) {
+        // Power-on or reset: nothing in RTC memory can be trusted
+        memset(&rtc_accounting, 0, sizeof(rtc_accounting));
+        rtc_accounting.magic = ACCOUNTING_MAGIC;
+        rtc_snapshot.magic = 0;
+        ESP_LOGI(TAG, "Cold boot, sleep accounting reset");
+        return;
+    }
+    
+    int64_t slept_ms = (wall_clock_us() - rtc_accounting.deep_entered_us) / 1000;
+    if (slept_ms > 0) {
+        rtc_accounting.modes[SLEEP_MODE_DEEP].residency_ms += slept_ms;
+    }
+    
+    // esp_timer starts with the app, so the frame time is measured from here
+    frame_pending = true;
+    frame_mode = SLEEP_MODE_DEEP;
+    frame_wake_us = 0;
+    
+    ESP_LOGI(TAG, "Woke from deep sleep (%s) after %lld ms",
+             cause == ESP_SLEEP_WAKEUP_EXT0 ? "touch" : "timer", (long long)slept_ms);
+}
+
+bool sleep_manager_woke_from_deep_sleep(void)
+{
+    return deep_wake;
+}
+
+bool sleep_manager_save_snapshot(const void *data, size_t len)
+{
+    if (!data || len > SLEEP_SNAPSHOT_MAX_BYTES) {
+        ESP_LOGE(TAG, "Snapshot of %d bytes does not fit in %d", (int)len, SLEEP_SNAPSHOT_MAX_BYTES);
+        return false;
+    }
+    
+    memcpy(rtc_snapshot.data, data, len);
+    rtc_snapshot.len = len;
+    rtc_snapshot.crc = esp_rom_crc32_le(0, rtc_snapshot.data, len);
+    rtc_snapshot.magic = SNAPSHOT_MAGIC;
+    return true;
+}
+
+bool sleep_manager_load_snapshot(void *data, size_t len)
+{
+    // A length change means the firmware's layout changed since it was saved
+    if (!data || rtc_snapshot.magic != SNAPSHOT_MAGIC || rtc_snapshot.len != len ||
+        esp_rom_crc32_le(0, rtc_snapshot.data, len) != rtc_snapshot.crc) {
+        return false;
+    }
+    
+    memcpy(data, rtc_snapshot.data, len);
+    return true;
+}
+
+void sleep_manager_note_activity(void)
+{
+    last_activity_us = esp_timer_get_time();
+}
+
+uint32_t sleep_manager_idle_ms(void)
+{
+    return (uint32_t)((esp_timer_get_time() - last_activity_us) / 1000);
+}
+
+void sleep_manager_screen_off(void)
+{
+    portENTER_CRITICAL(&sleep_lock);
+    if (!screen_off) {
+        account_elapsed(esp_timer_get_time());
+        rtc_accounting.modes[SLEEP_MODE_LIGHT].entries++;
+        screen_off = true;
+    }
+    portEXIT_CRITICAL(&sleep_lock);
+}
+
+void sleep_manager_screen_on(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&sleep_lock);
+    if (screen_off) {
+        account_elapsed(now_us);
+        screen_off = false;
+        frame_pending = true;
+        frame_mode = SLEEP_MODE_LIGHT;
+        frame_wake_us = now_us;
+    }
+    portEXIT_CRITICAL(&sleep_lock);
+    
+    last_activity_us = now_us;
+}
+
+bool sleep_manager_screen_is_off(void)
+{
+    return screen_off;
+}
+
+void sleep_manager_deep_sleep(void)
+{
+    portENTER_CRITICAL(&sleep_lock);
+    account_elapsed(esp_timer_get_time());
+    rtc_accounting.modes[SLEEP_MODE_DEEP].entries++;
+    portEXIT_CRITICAL(&sleep_lock);
+    
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    if (wake_gpio >= 0 && rtc_gpio_is_valid_gpio((gpio_num_t)wake_gpio)) {
+        // The digital pull-up is off in deep sleep; hold the line with the RTC one
+        rtc_gpio_pullup_en((gpio_num_t)wake_gpio);
+        rtc_gpio_pulldown_dis((gpio_num_t)wake_gpio);
+        esp_sleep_enable_ext0_wakeup((gpio_num_t)wake_gpio, 0);
+    } else {
+        ESP_LOGW(TAG, "No RTC wake GPIO, only a reset will wake the device");
+    }
+    
+    // Keep pins the caller held (e.g. the backlight) at their level while asleep
+    gpio_deep_sleep_hold_en();
+    
+    ESP_LOGI(TAG, "Entering deep sleep");
+    rtc_accounting.deep_entered_us = wall_clock_us();
+    esp_deep_sleep_start();
+}
+
+void sleep_manager_frame_shown(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&sleep_lock);
+    bool pending = frame_pending;
+    sleep_mode_t mode = frame_mode;
+    uint32_t frame_ms = (uint32_t)((now_us - frame_wake_us) / 1000);
+    if (pending) {
+        sleep_mode_stats_t *stats = &rtc_accounting.modes[mode];
+        stats->frames++;
+        stats->frame_total_ms += frame_ms;
+        if (frame_ms > stats->frame_max_ms) {
+            stats->frame_max_ms = frame_ms;
+        }
+        frame_pending = false;
+    }
+    portEXIT_CRITICAL(&sleep_lock);
+    
+    if (pending) {
+        ESP_LOGI(TAG, "First frame %lu ms after %s sleep wake", (unsigned long)frame_ms, mode_names[mode]);
+    }
+}
+
+void sleep_manager_get_stats(sleep_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&sleep_lock);
+    account_elapsed(esp_timer_get_time());
+    memcpy(stats->modes, rtc_accounting.modes, sizeof(stats->modes));
+    portEXIT_CRITICAL(&sleep_lock);
+    
+    uint64_t total_ms = 0;
+    float charge = 0;
+    for (int i = 0; i < SLEEP_MODE_COUNT; i++) {
+        total_ms += stats->modes[i].residency_ms;
+        charge += stats->modes[i].residency_ms * mode_current_ma[i];
+    }
+    stats->avg_current_ma = total_ms ? charge / total_ms : mode_current_ma[SLEEP_MODE_ACTIVE];
+}
+
+void sleep_manager_log_stats(void)
+{
+    sleep_stats_t stats;
+    sleep_manager_get_stats(&stats);
+    
+    uint64_t total_ms = 0;
+    for (int i = 0; i < SLEEP_MODE_COUNT; i++) {
+        total_ms += stats.modes[i].residency_ms;
+    }
+    
+    ESP_LOGI(TAG, "Sleep: estimated average current %.2f mA over %llu s", stats.avg_current_ma,
+             (unsigned long long)(total_ms / 1000));
+    for (int i = 0; i < SLEEP_MODE_COUNT; i++) {
+        const sleep_mode_stats_t *mode = &stats.modes[i];
+        ESP_LOGI(TAG, "  %-6s %5.1f%% of time, %lu entries, wake-to-frame avg %lu ms, max %lu ms (%lu wakes)",
+                 mode_names[i], total_ms ? mode->residency_ms * 100.0 / total_ms : 0.0,
+                 (unsigned long)mode->entries,
+                 (unsigned long)(mode->frames ? mode->frame_total_ms / mode->frames : 0),
+                 (unsigned long)mode->frame_max_ms, (unsigned long)mode->frames);
+    }
+}
+
+// Survives deep sleep: the system time runs on the RTC timer
+static int64_t wall_clock_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Caller holds sleep_lock. Whole milliseconds move to the active (or
+// screen-off) total and the remainder stays in active_start_us, so nothing
+// is lost to rounding.
+static void account_elapsed(int64_t now_us)
+{
+    int64_t elapsed_ms = (now_us - active_start_us) / 1000;
+    rtc_accounting.modes[screen_off ? SLEEP_MODE_LIGHT : SLEEP_MODE_ACTIVE].residency_ms += elapsed_ms;
+    active_start_us += elapsed_ms * 1000;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+// Where every firmware task runs and at what priority.
+//
+// Core 0 (protocol): the WiFi, BT controller, Bluedroid, lwIP, event loop
+// and esp_timer tasks (pinned in sdkconfig), plus everything that blocks on
+// the network: the network worker, the backend check and the radio
+// scheduler's jobs. Boot steps that bring up WiFi and BLE also run here, so
+// the stacks' interrupts are allocated on this core.
+//
+// Core 1 (UI): touch, the app state machine and rendering. The display and
+// touch boot steps run here so the SPI and touch GPIO interrupts land on the
+// core that consumes them, and a TLS handshake on core 0 can't delay a frame.
+//
+// Priorities only order tasks on the same core and all stay below the
+// protocol stacks (18 and up). Locks shared across cores are FreeRTOS
+// mutexes, so a low-priority holder inherits the waiter's priority:
+// http_mutex is taken by the network worker and the radio scheduler. The UI
+// tasks never wait on a lock held across a network call; the GPS governor
+// and prefetch mutexes only guard copies, and the event bus is a spinlock.
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_CORE_PROTOCOL tskNO_AFFINITY
+#define TASK_CORE_UI       tskNO_AFFINITY
+#else
+#define TASK_CORE_PROTOCOL 0
+#define TASK_CORE_UI       1
+#endif
+
+// UI core: input first, then the state machine, then LVGL housekeeping
+#define TASK_PRIO_TOUCH    6
+#define TASK_PRIO_APP      5
+#define TASK_PRIO_LVGL     4
+
+// Protocol core: requests the user is waiting for before background work
+#define TASK_PRIO_NETWORK  4
+#define TASK_PRIO_BACKEND  3
+#define TASK_PRIO_RADIO    2
+#define TASK_PRIO_TELEMETRY 1
+#define TASK_PRIO_LOG      1
+#define TASK_PRIO_METRICS  1
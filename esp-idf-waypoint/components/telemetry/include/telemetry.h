@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runtime telemetry: CPU load per core and per task (FreeRTOS run-time
+// stats), each task's stack high-water mark, and free, largest free block
+// and fragmentation per heap capability. A low-priority task samples every
+// TELEMETRY_SAMPLE_MS and keeps min/max over the last TELEMETRY_WINDOW
+// samples. Typing TELEMETRY_DUMP_KEY on the serial console logs a dump.
+//
+// CPU figures need CONFIG_FREERTOS_USE_TRACE_FACILITY and
+// CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without them only stacks and
+// heaps are reported.
+#define TELEMETRY_SAMPLE_MS      5000
+#define TELEMETRY_WINDOW         12      // one minute of samples
+#define TELEMETRY_MAX_TASKS      24
+#define TELEMETRY_MAX_CORES      2
+#define TELEMETRY_DUMP_KEY       't'
+
+// Tasks with less free stack than this are flagged in the dump
+#define TELEMETRY_STACK_LOW_BYTES 512
+
+#define TELEMETRY_LINE_LEN       64
+
+typedef enum {
+    TELEMETRY_HEAP_INTERNAL,
+    TELEMETRY_HEAP_DMA,
+    TELEMETRY_HEAP_PSRAM,
+    TELEMETRY_HEAP_COUNT
+} telemetry_heap_t;
+
+// Loads are in permille of one core over the last sample interval
+typedef struct {
+    uint16_t load;
+    uint16_t load_min;
+    uint16_t load_max;
+} telemetry_cpu_t;
+
+typedef struct {
+    char name[16];
+    int core;                 // -1 when not pinned or unknown
+    uint32_t priority;
+    telemetry_cpu_t cpu;
+    uint32_t stack_free_min;  // bytes never used since the task started
+} telemetry_task_t;
+
+// Bytes; fragmentation is the share of free memory outside the largest block
+typedef struct {
+    uint32_t total;
+    uint32_t free;
+    uint32_t free_min;
+    uint32_t free_max;
+    uint32_t largest;
+    uint32_t largest_min;
+    uint8_t frag_pct;
+    uint8_t frag_max_pct;
+    uint32_t low_water;       // lowest free since boot, from the allocator
+} telemetry_heap_stats_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t uptime_ms;
+    bool run_time_stats;      // CPU figures are valid
+    int core_count;
+    telemetry_cpu_t cores[TELEMETRY_MAX_CORES];
+    int task_count;
+    telemetry_task_t tasks[TELEMETRY_MAX_TASKS];  // busiest first
+    telemetry_heap_stats_t heaps[TELEMETRY_HEAP_COUNT];
+} telemetry_snapshot_t;
+
+typedef void (*telemetry_key_handler_t)(uint8_t key);
+
+// Takes the first sample and starts the sampling task; idempotent
+void telemetry_init(void);
+
+// Other keys typed on the console go to this handler, on the sampling task
+void telemetry_set_key_handler(telemetry_key_handler_t handler);
+
+// Samples now; the sampling task calls this every TELEMETRY_SAMPLE_MS
+void telemetry_sample(void);
+
+void telemetry_get_snapshot(telemetry_snapshot_t *snapshot);
+void telemetry_log(void);
+
+// Short lines for a diagnostics screen: uptime, cores, heaps, then the
+// busiest tasks until max_lines. Returns the number of lines written.
+int telemetry_format_lines(char lines[][TELEMETRY_LINE_LEN], int max_lines);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,403 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include "task_plan.h"
+#include "energy_account.h"
+#if CONFIG_ESP_CONSOLE_UART
+#include "driver/uart.h"
+#endif
+
+static const char *TAG = "TELEMETRY";
+
+#define TELEMETRY_STACK_SIZE 3072
+
+// uxTaskGetSystemState fails outright when the array is too small, so leave
+// room for the tasks beyond TELEMETRY_MAX_TASKS that are dropped afterwards
+#define STATUS_CAPACITY (TELEMETRY_MAX_TASKS + 8)
+
+#define CPU_STATS_ENABLED (configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS)
+
+// Per-task history, matched across samples by the task number
+typedef struct {
+    UBaseType_t number;
+    uint32_t last_run_time;
+    uint16_t history[TELEMETRY_WINDOW];
+    uint8_t history_count;
+    bool seen;
+} task_slot_t;
+
+static const uint32_t heap_caps[TELEMETRY_HEAP_COUNT] = {
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    MALLOC_CAP_DMA,
+    MALLOC_CAP_SPIRAM,
+};
+static const char *heap_names[TELEMETRY_HEAP_COUNT] = { "internal", "dma", "psram" };
+
+static SemaphoreHandle_t telemetry_mutex = NULL;
+static SemaphoreHandle_t log_mutex = NULL;     // telemetry_log's copy, app task and dump key
+static TaskHandle_t telemetry_task_handle = NULL;
+static telemetry_key_handler_t key_handler = NULL;
+
+// Everything below is protected by telemetry_mutex
+static telemetry_snapshot_t current = {};
+static task_slot_t slots[TELEMETRY_MAX_TASKS];
+static uint16_t core_history[TELEMETRY_MAX_CORES][TELEMETRY_WINDOW];
+static uint32_t heap_free_history[TELEMETRY_HEAP_COUNT][TELEMETRY_WINDOW];
+static uint32_t heap_largest_history[TELEMETRY_HEAP_COUNT][TELEMETRY_WINDOW];
+static uint8_t heap_frag_history[TELEMETRY_HEAP_COUNT][TELEMETRY_WINDOW];
+#if CPU_STATS_ENABLED
+static TaskStatus_t status[STATUS_CAPACITY];
+static uint32_t last_total_run_time = 0;
+#endif
+
+static void telemetry_task(void *pvParameters);
+static void sample_tasks(void);
+static void sample_heaps(void);
+static void window_range16(const uint16_t *history, int count, uint16_t *min, uint16_t *max);
+static void window_range32(const uint32_t *history, int count, uint32_t *min, uint32_t *max);
+
+void telemetry_init(void)
+{
+    if (telemetry_task_handle) {
+        return;
+    }
+    
+    telemetry_mutex = xSemaphoreCreateMutex();
+    log_mutex = xSemaphoreCreateMutex();
+    if (!telemetry_mutex || !log_mutex) {
+        ESP_LOGE(TAG, "Failed to create telemetry mutex");
+        return;
+    }
+    
+    telemetry_sample();
+    xTaskCreatePinnedToCore(telemetry_task, "telemetry", TELEMETRY_STACK_SIZE, NULL, TASK_PRIO_TELEMETRY,
+                            &telemetry_task_handle, TASK_CORE_PROTOCOL);
+    ESP_LOGI(TAG, "Telemetry every %d ms, press '%c' on the console for a dump%s", TELEMETRY_SAMPLE_MS,
+             TELEMETRY_DUMP_KEY, CPU_STATS_ENABLED ? "" : " (run-time stats disabled, no CPU load)");
+}
+
+void telemetry_set_key_handler(telemetry_key_handler_t handler)
+{
+    key_handler = handler;
+}
+
+void telemetry_sample(void)
+{
+    if (!telemetry_mutex) {
+        return;
+    }
+    
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    sample_tasks();
+    sample_heaps();
+    current.samples++;
+    current.uptime_ms = esp_log_timestamp();
+    xSemaphoreGive(telemetry_mutex);
+}
+
+void telemetry_get_snapshot(telemetry_snapshot_t *snapshot)
+{
+    if (!telemetry_mutex) {
+        memset(snapshot, 0, sizeof(*snapshot));
+        return;
+    }
+    
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    *snapshot = current;
+    xSemaphoreGive(telemetry_mutex);
+}
+
+void telemetry_log(void)
+{
+    // Too big for the callers' stacks; shared, so one caller prints at a time
+    static telemetry_snapshot_t snap;
+    if (!log_mutex) {
+        return;
+    }
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    telemetry_get_snapshot(&snap);
+    
+    ESP_LOGI(TAG, "Telemetry at %lu ms, %lu samples, min/max over the last %d", (unsigned long)snap.uptime_ms,
+             (unsigned long)snap.samples, TELEMETRY_WINDOW);
+    if (snap.run_time_stats) {
+        for (int i = 0; i < snap.core_count; i++) {
+            const telemetry_cpu_t *c = &snap.cores[i];
+            ESP_LOGI(TAG, "  core %d load %5.1f%% (min %5.1f%%, max %5.1f%%)", i, c->load / 10.0,
+                     c->load_min / 10.0, c->load_max / 10.0);
+        }
+    }
+    
+    for (int i = 0; i < TELEMETRY_HEAP_COUNT; i++) {
+        const telemetry_heap_stats_t *h = &snap.heaps[i];
+        if (h->total == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "  heap %-8s free %6lu of %6lu (min %6lu, max %6lu, low water %6lu), largest %6lu (min %6lu), "
+                 "frag %2u%% (max %2u%%)", heap_names[i], (unsigned long)h->free, (unsigned long)h->total,
+                 (unsigned long)h->free_min, (unsigned long)h->free_max, (unsigned long)h->low_water,
+                 (unsigned long)h->largest, (unsigned long)h->largest_min, h->frag_pct, h->frag_max_pct);
+    }
+    
+    for (int i = 0; i < snap.task_count; i++) {
+        const telemetry_task_t *t = &snap.tasks[i];
+        bool low = t->stack_free_min < TELEMETRY_STACK_LOW_BYTES;
+        if (snap.run_time_stats) {
+            ESP_LOGI(TAG, "  task %-16s core %2d prio %2lu cpu %5.1f%% (max %5.1f%%) stack free %5lu%s", t->name,
+                     t->core, (unsigned long)t->priority, t->cpu.load / 10.0, t->cpu.load_max / 10.0,
+                     (unsigned long)t->stack_free_min, low ? " LOW" : "");
+        } else {
+            ESP_LOGI(TAG, "  task %-16s prio %2lu stack free %5lu%s", t->name, (unsigned long)t->priority,
+                     (unsigned long)t->stack_free_min, low ? " LOW" : "");
+        }
+    }
+    xSemaphoreGive(log_mutex);
+}
+
+int telemetry_format_lines(char lines[][TELEMETRY_LINE_LEN], int max_lines)
+{
+    // Separate from telemetry_log's copy; only the app task formats lines
+    static telemetry_snapshot_t snap;
+    telemetry_get_snapshot(&snap);
+    int n = 0;
+    
+    if (n < max_lines) {
+        snprintf(lines[n++], TELEMETRY_LINE_LEN, "Up %lu s, %lu samples, min/max over %d",
+                 (unsigned long)(snap.uptime_ms / 1000), (unsigned long)snap.samples, TELEMETRY_WINDOW);
+    }
+    for (int i = 0; snap.run_time_stats && i < snap.core_count && n < max_lines; i++) {
+        const telemetry_cpu_t *c = &snap.cores[i];
+        snprintf(lines[n++], TELEMETRY_LINE_LEN, "CPU%d %5.1f%%  min %5.1f%%  max %5.1f%%", i, c->load / 10.0,
+                 c->load_min / 10.0, c->load_max / 10.0);
+    }
+    for (int i = 0; i < TELEMETRY_HEAP_COUNT && n < max_lines; i++) {
+        const telemetry_heap_stats_t *h = &snap.heaps[i];
+        if (h->total == 0) continue;
+        snprintf(lines[n++], TELEMETRY_LINE_LEN, "%-8s %4luK free (min %luK) blk %luK frag %u%%", heap_names[i],
+                 (unsigned long)(h->free / 1024), (unsigned long)(h->free_min / 1024),
+                 (unsigned long)(h->largest / 1024), h->frag_max_pct);
+    }
+    for (int i = 0; i < snap.task_count && n < max_lines; i++) {
+        const telemetry_task_t *t = &snap.tasks[i];
+        snprintf(lines[n++], TELEMETRY_LINE_LEN, "%-14s c%-2d p%-2lu %5.1f%% stk %lu%s", t->name, t->core,
+                 (unsigned long)t->priority, t->cpu.load / 10.0, (unsigned long)t->stack_free_min,
+                 t->stack_free_min < TELEMETRY_STACK_LOW_BYTES ? "!" : "");
+    }
+    return n;
+}
+
+static void telemetry_task(void *pvParameters)
+{
+#if CONFIG_ESP_CONSOLE_UART
+    // Reads only; the log keeps writing through the console VFS
+    bool console_rx = uart_driver_install((uart_port_t)CONFIG_ESP_CONSOLE_UART_NUM, 256, 0, 0, NULL, 0) == ESP_OK;
+    if (!console_rx) {
+        ESP_LOGW(TAG, "Console UART busy, serial dump disabled");
+    }
+#endif
+    
+    TickType_t next_sample = xTaskGetTickCount() + pdMS_TO_TICKS(TELEMETRY_SAMPLE_MS);
+    while (1) {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = (int32_t)(next_sample - now) > 0 ? next_sample - now : 0;
+    
+#if CONFIG_ESP_CONSOLE_UART
+        uint8_t key;
+        if (console_rx) {
+            if (uart_read_bytes((uart_port_t)CONFIG_ESP_CONSOLE_UART_NUM, &key, 1, wait) == 1) {
+                if (key == TELEMETRY_DUMP_KEY) {
+                    telemetry_sample();
+                    telemetry_log();
+                } else if (key_handler) {
+                    key_handler(key);
+                }
+                continue;
+            }
+        } else {
+            vTaskDelay(wait);
+        }
+#else
+        vTaskDelay(wait);
+#endif
+    
+        telemetry_sample();
+        next_sample += pdMS_TO_TICKS(TELEMETRY_SAMPLE_MS);
+        if ((int32_t)(xTaskGetTickCount() - next_sample) > 0) {
+            next_sample = xTaskGetTickCount() + pdMS_TO_TICKS(TELEMETRY_SAMPLE_MS);
+        }
+    }
+}
+
+// Caller holds telemetry_mutex
+static void sample_tasks(void)
+{
+    int index = current.samples % TELEMETRY_WINDOW;
+    int window = current.samples + 1 < TELEMETRY_WINDOW ? current.samples + 1 : TELEMETRY_WINDOW;
+    
+#if CPU_STATS_ENABLED
+    uint32_t total_run_time = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, STATUS_CAPACITY, &total_run_time);
+    uint32_t elapsed = total_run_time - last_total_run_time;
+    bool have_delta = current.samples > 0 && elapsed > 0;
+    last_total_run_time = total_run_time;
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, skipping task sample", STATUS_CAPACITY);
+        return;
+    }
+    
+    current.run_time_stats = have_delta;
+    current.core_count = portNUM_PROCESSORS < TELEMETRY_MAX_CORES ? portNUM_PROCESSORS : TELEMETRY_MAX_CORES;
+    for (int i = 0; i < TELEMETRY_MAX_TASKS; i++) {
+        slots[i].seen = false;
+    }
+    
+    current.task_count = 0;
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *s = &status[i];
+        
+        // Find the task's slot, or take a free one
+        task_slot_t *slot = NULL;
+        task_slot_t *free_slot = NULL;
+        for (int j = 0; j < TELEMETRY_MAX_TASKS; j++) {
+            if (slots[j].history_count > 0 && slots[j].number == s->xTaskNumber) {
+                slot = &slots[j];
+                break;
+            }
+            if (!free_slot && slots[j].history_count == 0) {
+                free_slot = &slots[j];
+            }
+        }
+        bool is_new = slot == NULL;
+        if (is_new) {
+            if (!free_slot) continue;
+            slot = free_slot;
+            slot->number = s->xTaskNumber;
+            slot->last_run_time = s->ulRunTimeCounter;
+        }
+        slot->seen = true;
+        
+        // A task first seen this sample has no interval yet
+        uint32_t run = s->ulRunTimeCounter - slot->last_run_time;
+        slot->last_run_time = s->ulRunTimeCounter;
+        uint16_t load = have_delta ? (uint16_t)((uint64_t)run * 1000 / elapsed) : 0;
+        if (load > 1000) load = 1000;
+        slot->history[slot->history_count < TELEMETRY_WINDOW ? slot->history_count : index] = load;
+        if (slot->history_count < TELEMETRY_WINDOW) slot->history_count++;
+        
+        int core = -1;
+#if configTASKLIST_INCLUDE_COREID
+        if (s->xCoreID >= 0 && s->xCoreID < TELEMETRY_MAX_CORES) core = s->xCoreID;
+#endif
+    
+        // Idle time is what the rest of the core didn't use; IDF names them IDLE0/IDLE1
+        if (strncmp(s->pcTaskName, "IDLE", 4) == 0) {
+            int idle_core = s->pcTaskName[4] >= '0' && s->pcTaskName[4] <= '9' ? s->pcTaskName[4] - '0' : 0;
+            if (idle_core < TELEMETRY_MAX_CORES) {
+                core_history[idle_core][index] = 1000 - load;
+                current.cores[idle_core].load = 1000 - load;
+                window_range16(core_history[idle_core], window, &current.cores[idle_core].load_min,
+                               &current.cores[idle_core].load_max);
+            }
+            // The run-time counter is esp_timer microseconds, so busy time
+            // is the interval less this core's idle time
+            if (have_delta && idle_core < 2 && run <= elapsed) {
+                energy_account_add_us((energy_rail_t)(ENERGY_RAIL_CPU0 + idle_core), elapsed - run);
+            }
+        }
+        
+        telemetry_task_t *t = &current.tasks[current.task_count++];
+        strncpy(t->name, s->pcTaskName, sizeof(t->name) - 1);
+        t->name[sizeof(t->name) - 1] = '\0';
+        t->core = core;
+        t->priority = s->uxCurrentPriority;
+        t->cpu.load = load;
+        window_range16(slot->history, slot->history_count, &t->cpu.load_min, &t->cpu.load_max);
+        // The high-water mark is in bytes on ESP-IDF
+        t->stack_free_min = s->usStackHighWaterMark;
+    }
+    
+    // Tasks that were deleted free their slot
+    for (int i = 0; i < TELEMETRY_MAX_TASKS; i++) {
+        if (!slots[i].seen) slots[i].history_count = 0;
+    }
+    
+    // Busiest first
+    for (int i = 1; i < current.task_count; i++) {
+        telemetry_task_t t = current.tasks[i];
+        int j = i - 1;
+        while (j >= 0 && current.tasks[j].cpu.load < t.cpu.load) {
+            current.tasks[j + 1] = current.tasks[j];
+            j--;
+        }
+        current.tasks[j + 1] = t;
+    }
+#else
+    // Without the trace facility only the caller's own stack is visible
+    (void)index;
+    (void)window;
+    current.run_time_stats = false;
+    current.task_count = 1;
+    strncpy(current.tasks[0].name, pcTaskGetName(NULL), sizeof(current.tasks[0].name) - 1);
+    current.tasks[0].core = -1;
+    current.tasks[0].priority = uxTaskPriorityGet(NULL);
+    current.tasks[0].stack_free_min = uxTaskGetStackHighWaterMark(NULL);
+#endif
+}
+
+// Caller holds telemetry_mutex
+static void sample_heaps(void)
+{
+    int index = current.samples % TELEMETRY_WINDOW;
+    int window = current.samples + 1 < TELEMETRY_WINDOW ? current.samples + 1 : TELEMETRY_WINDOW;
+    
+    for (int i = 0; i < TELEMETRY_HEAP_COUNT; i++) {
+        telemetry_heap_stats_t *h = &current.heaps[i];
+        h->total = heap_caps_get_total_size(heap_caps[i]);
+        if (h->total == 0) {
+            continue;
+        }
+        h->free = heap_caps_get_free_size(heap_caps[i]);
+        h->largest = heap_caps_get_largest_free_block(heap_caps[i]);
+        h->low_water = heap_caps_get_minimum_free_size(heap_caps[i]);
+        h->frag_pct = h->free ? (uint8_t)(100 - (uint64_t)h->largest * 100 / h->free) : 0;
+        
+        heap_free_history[i][index] = h->free;
+        heap_largest_history[i][index] = h->largest;
+        heap_frag_history[i][index] = h->frag_pct;
+        
+        uint32_t unused;
+        window_range32(heap_free_history[i], window, &h->free_min, &h->free_max);
+        window_range32(heap_largest_history[i], window, &h->largest_min, &unused);
+        h->frag_max_pct = 0;
+        for (int j = 0; j < window; j++) {
+            if (heap_frag_history[i][j] > h->frag_max_pct) h->frag_max_pct = heap_frag_history[i][j];
+        }
+    }
+}
+
+static void window_range16(const uint16_t *history, int count, uint16_t *min, uint16_t *max)
+{
+    *min = UINT16_MAX;
+    *max = 0;
+    for (int i = 0; i < count; i++) {
+        if (history[i] < *min) *min = history[i];
+        if (history[i] > *max) *max = history[i];
+    }
+    if (count == 0) *min = 0;
+}
+
+static void window_range32(const uint32_t *history, int count, uint32_t *min, uint32_t *max)
+{
+    *min = UINT32_MAX;
+    *max = 0;
+    for (int i = 0; i < count; i++) {
+        if (history[i] < *min) *min = history[i];
+        if (history[i] > *max) *max = history[i];
+    }
+    if (count == 0) *min = 0;
+}
@@ -20,6 +20,15 @@ void touch_controller_init(void);
 bool touch_controller_get_event(touch_event_t *event);
 bool touch_controller_is_touched(void);
 
+// GPIO that goes low while the panel is touched, -1 if none. It is a
+// light-sleep wake source from init on; deep sleep arms it separately.
+int touch_controller_get_irq_gpio(void);
+
+// Called for every press and release on the touch task, in addition to the
+// event queue: copy and hand off only
+typedef void (*touch_callback_t)(const touch_event_t *event);
+void touch_controller_set_callback(touch_callback_t callback);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -1,10 +1,19 @@
 #include "touch_controller.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "esp_sleep.h"
+#endif
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "task_plan.h"
+#include "binlog.h"
+#include "heap_account.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "TOUCH_CONTROLLER";
@@ -31,9 +40,43 @@ static const char *TAG = "TOUCH_CONTROLLER";
 #define DISPLAY_HEIGHT   320
 
 // Global variables
-static spi_device_handle_t touch_spi_handle;
 static QueueHandle_t touch_event_queue;
 static bool touch_initialized = false;
+static touch_callback_t touch_callback = NULL;
+
+#if CONFIG_IDF_TARGET_LINUX
+// Linux target: touches come from the script named by SIM_TOUCH_SCRIPT, one
+// "<sim_ms> <x> <y>" tap per line ('#' starts a comment). Script times are
+// on the same accelerated clock as the GPS replay (SIM_TIME_SCALE).
+#define SIM_TAP_DURATION_MS 100
+
+static FILE *touch_script = NULL;
+static volatile bool sim_touching = false;
+
+static void touch_task(void *pvParameters);
+static uint32_t sim_now_ms(void);
+
+void touch_controller_init(void)
+{
+    const char *path = getenv("SIM_TOUCH_SCRIPT");
+    if (path) {
+        touch_script = fopen(path, "r");
+        if (!touch_script) {
+            ESP_LOGE(TAG, "Cannot open touch script %s", path);
+        }
+    }
+    
+    touch_event_queue = xQueueCreate(10, sizeof(touch_event_t));
+    if (touch_script) {
+        xTaskCreate(touch_task, "touch_task", 4096, NULL, 5, NULL);
+    }
+    
+    touch_initialized = true;
+    ESP_LOGI(TAG, "Simulated touch controller initialized (%s)", path ? path : "no script");
+}
+#else
+static spi_device_handle_t touch_spi_handle;
+static TaskHandle_t touch_task_handle = NULL;
 
 // Internal functions
 static void touch_init_spi(void);
@@ -50,13 +93,18 @@ void touch_controller_init(void)
     // Initialize SPI for touch controller
     touch_init_spi();
     
-    // Configure IRQ pin
+    // Configure IRQ pin. A low-level interrupt is also a light-sleep wake
+    // source, so a press wakes the chip from automatic light sleep (menu and
+    // idle power profiles) and is still pending when it does; an edge would
+    // be lost while the chip sleeps. The ISR masks it until the release.
     gpio_config_t io_conf = {};
-    io_conf.intr_type = GPIO_INTR_NEGEDGE;
+    io_conf.intr_type = GPIO_INTR_LOW_LEVEL;
     io_conf.mode = GPIO_MODE_INPUT;
     io_conf.pin_bit_mask = (1ULL << TOUCH_IRQ_PIN);
     io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
     gpio_config(&io_conf);
+    gpio_wakeup_enable((gpio_num_t)TOUCH_IRQ_PIN, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
     
     // Create event queue
     touch_event_queue = xQueueCreate(10, sizeof(touch_event_t));
@@ -65,12 +113,13 @@ void touch_controller_init(void)
     gpio_install_isr_service(0);
     gpio_isr_handler_add(TOUCH_IRQ_PIN, touch_isr_handler, NULL);
     
-    // Create touch task
-    xTaskCreate(touch_task, "touch_task", 4096, NULL, 5, NULL);
+    // Create touch task next to the app task that consumes its events
+    xTaskCreatePinnedToCore(touch_task, "touch_task", 4096, NULL, TASK_PRIO_TOUCH, &touch_task_handle, TASK_CORE_UI);
     
     touch_initialized = true;
     ESP_LOGI(TAG, "Touch controller initialized");
 }
+#endif
 
 bool touch_controller_get_event(touch_event_t *event)
 {
@@ -81,15 +130,86 @@ bool touch_controller_get_event(touch_event_t *event)
     return xQueueReceive(touch_event_queue, event, 0) == pdTRUE;
 }
 
+int touch_controller_get_irq_gpio(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    return -1;
+#else
+    return TOUCH_IRQ_PIN;
+#endif
+}
+
+void touch_controller_set_callback(touch_callback_t callback)
+{
+    touch_callback = callback;
+}
+
 bool touch_controller_is_touched(void)
 {
     if (!touch_initialized) {
         return false;
     }
     
+#if CONFIG_IDF_TARGET_LINUX
+    return sim_touching;
+#else
     return gpio_get_level(TOUCH_IRQ_PIN) == 0;
+#endif
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+static uint32_t sim_now_ms(void)
+{
+    static float scale = 0;
+    if (scale == 0) {
+        const char *env = getenv("SIM_TIME_SCALE");
+        scale = env ? atof(env) : 1.0f;
+        if (scale <= 0) scale = 1.0f;
+    }
+    return (uint32_t)(esp_log_timestamp() * scale);
 }
 
+static void touch_task(void *pvParameters)
+{
+    char line[128];
+    heap_account_enter(HEAP_ACCOUNT_TOUCH);
+    
+    while (fgets(line, sizeof(line), touch_script)) {
+        unsigned long at_ms;
+        unsigned int x, y;
+        if (line[0] == '#' || sscanf(line, "%lu %u %u", &at_ms, &x, &y) != 3) {
+            continue;
+        }
+        
+        while (sim_now_ms() < at_ms) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        
+        touch_event_t event = {};
+        event.x = x < DISPLAY_WIDTH ? x : DISPLAY_WIDTH - 1;
+        event.y = y < DISPLAY_HEIGHT ? y : DISPLAY_HEIGHT - 1;
+        event.pressed = true;
+        event.timestamp = sim_now_ms();
+        sim_touching = true;
+        xQueueSend(touch_event_queue, &event, 0);
+        if (touch_callback) touch_callback(&event);
+        BINLOG_I(TAG, "Touch at (%d, %d)", event.x, event.y);
+        
+        vTaskDelay(pdMS_TO_TICKS(SIM_TAP_DURATION_MS));
+        event.pressed = false;
+        event.timestamp = sim_now_ms();
+        sim_touching = false;
+        xQueueSend(touch_event_queue, &event, 0);
+        if (touch_callback) touch_callback(&event);
+    }
+    
+    ESP_LOGI(TAG, "Touch script finished");
+    fclose(touch_script);
+    touch_script = NULL;
+    vTaskDelete(NULL);
+}
+#else
+
 static void touch_init_spi(void)
 {
     spi_device_interface_config_t devcfg = {
@@ -105,11 +225,14 @@ static void touch_init_spi(void)
 
 static void IRAM_ATTR touch_isr_handler(void *arg)
 {
-    // Touch interrupt occurred - wake up touch task
+    // Touch interrupt occurred - wake up touch task. The level would keep
+    // firing while the finger is down; touch_task unmasks it on release.
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     
-    // Send a notification to touch task
-    // (In a real implementation, you might use a more sophisticated approach)
+    gpio_intr_disable((gpio_num_t)TOUCH_IRQ_PIN);
+    if (touch_task_handle) {
+        vTaskNotifyGiveFromISR(touch_task_handle, &xHigherPriorityTaskWoken);
+    }
     
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
@@ -119,8 +242,14 @@ static void touch_task(void *pvParameters)
     touch_event_t event;
     uint16_t last_x = 0, last_y = 0;
     bool was_touched = false;
+    heap_account_enter(HEAP_ACCOUNT_TOUCH);
     
     while (1) {
+        // Idle until the pen-down interrupt; poll only while a finger is down
+        if (!was_touched) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        
         bool is_touched = touch_controller_is_touched();
         
         if (is_touched) {
@@ -139,8 +268,9 @@ static void touch_task(void *pvParameters)
                 event.timestamp = esp_log_timestamp();
                 
                 xQueueSend(touch_event_queue, &event, 0);
+                if (touch_callback) touch_callback(&event);
                 
-                ESP_LOGI(TAG, "Touch at (%d, %d)", x, y);
+                BINLOG_I(TAG, "Touch at (%d, %d)", x, y);
                 
                 last_x = x;
                 last_y = y;
@@ -156,14 +286,16 @@ static void touch_task(void *pvParameters)
                 event.timestamp = esp_log_timestamp();
                 
                 xQueueSend(touch_event_queue, &event, 0);
+                if (touch_callback) touch_callback(&event);
                 
-                ESP_LOGI(TAG, "Touch released at (%d, %d)", last_x, last_y);
+                BINLOG_I(TAG, "Touch released at (%d, %d)", last_x, last_y);
             }
             
             was_touched = false;
+            gpio_intr_enable((gpio_num_t)TOUCH_IRQ_PIN);
         }
         
-        vTaskDelay(pdMS_TO_TICKS(50)); // 20 Hz polling rate
+        vTaskDelay(pdMS_TO_TICKS(50)); // 20 Hz polling rate while touched
     }
 }
 
@@ -204,4 +336,5 @@ static uint16_t touch_map_coordinate(uint16_t raw, uint16_t raw_min, uint16_t ra
     if (raw > raw_max) raw = raw_max;
     
     return (uint16_t)(((uint32_t)(raw - raw_min) * display_max) / (raw_max - raw_min));
-}
\ No newline at end of file
+}
+#endif
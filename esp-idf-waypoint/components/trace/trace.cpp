@@ -0,0 +1,108 @@
+#include "trace.h"
+#include <stdio.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+// Events per line of the dump
+#define DUMP_EVENTS_PER_LINE 8
+
+// Dump names, in trace_point_t order
+static const char *point_names[TRACE_POINT_COUNT] = {
+    "gps_ble_write",
+    "gps_parse",
+    "app_event",
+    "app_gps_fix",
+    "nav_bearing",
+    "display_draw",
+    "display_bytes",
+    "http_request",
+    "gps_upload",
+    "gps_flow",
+};
+
+// Zero-initialized, so events are recorded from the first instruction
+static trace_event_t rings[TRACE_MAX_CORES][TRACE_EVENTS_PER_CORE];
+static uint32_t heads[TRACE_MAX_CORES];   // events ever claimed per core
+static uint32_t next_flow = 0;
+static volatile bool paused = false;
+
+static void dump_tasks(void);
+
+void trace_record(trace_point_t point, trace_type_t type, uint32_t arg)
+{
+    if (paused) return;
+
+#if portNUM_PROCESSORS > 1
+    int core = xPortGetCoreID();
+#else
+    int core = 0;
+#endif
+    // Another task on this core may claim the next slot before this one is
+    // filled in; each slot has exactly one writer either way
+    uint32_t slot = __atomic_fetch_add(&heads[core], 1, __ATOMIC_RELAXED) & (TRACE_EVENTS_PER_CORE - 1);
+    trace_event_t *event = &rings[core][slot];
+    event->timestamp_us = (uint32_t)esp_timer_get_time();
+    event->arg = arg;
+    event->task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    event->point = (uint8_t)point;
+    event->type = (uint8_t)type;
+}
+
+uint32_t trace_new_flow(void)
+{
+    uint32_t id = __atomic_add_fetch(&next_flow, 1, __ATOMIC_RELAXED);
+    return id ? id : __atomic_add_fetch(&next_flow, 1, __ATOMIC_RELAXED);
+}
+
+void trace_dump(void)
+{
+    paused = true;
+    // Let a write that was claimed before the pause finish
+    vTaskDelay(1);
+    
+    printf("TRACE start %d %d %lld\n", TRACE_MAX_CORES, TRACE_EVENTS_PER_CORE, (long long)esp_timer_get_time());
+    for (int i = 0; i < TRACE_POINT_COUNT; i++) {
+        printf("TRACE point %d %s\n", i, point_names[i]);
+    }
+    dump_tasks();
+    
+    for (int core = 0; core < TRACE_MAX_CORES; core++) {
+        uint32_t head = heads[core];
+        uint32_t count = head < TRACE_EVENTS_PER_CORE ? head : TRACE_EVENTS_PER_CORE;
+        printf("TRACE core %d %lu %lu\n", core, (unsigned long)count, (unsigned long)(head - count));
+        
+        // Oldest first, as hex of the raw little-endian events
+        for (uint32_t i = 0; i < count; i += DUMP_EVENTS_PER_LINE) {
+            printf("TRACE ev %d ", core);
+            for (uint32_t j = i; j < count && j < i + DUMP_EVENTS_PER_LINE; j++) {
+                const uint8_t *bytes = (const uint8_t *)&rings[core][(head - count + j) & (TRACE_EVENTS_PER_CORE - 1)];
+                for (size_t k = 0; k < sizeof(trace_event_t); k++) {
+                    printf("%02x", bytes[k]);
+                }
+            }
+            printf("\n");
+        }
+    }
+    printf("TRACE end\n");
+    fflush(stdout);
+    
+    paused = false;
+}
+
+// Names for the live tasks; deleted ones show up by handle
+static void dump_tasks(void)
+{
+#if configUSE_TRACE_FACILITY
+    static TaskStatus_t status[32];
+    UBaseType_t count = uxTaskGetSystemState(status, sizeof(status) / sizeof(status[0]), NULL);
+    for (UBaseType_t i = 0; i < count; i++) {
+        printf("TRACE task %08lx %s\n", (unsigned long)(uint32_t)(uintptr_t)status[i].xHandle,
+               status[i].pcTaskName);
+    }
+#else
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    printf("TRACE task %08lx %s\n", (unsigned long)(uint32_t)(uintptr_t)self, pcTaskGetName(self));
+#endif
+}
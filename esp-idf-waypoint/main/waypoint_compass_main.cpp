@@ -1,13 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/event_groups.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
 #include "nvs_flash.h"
 #include "esp_bt.h"
 #include "esp_gap_ble_api.h"
@@ -23,6 +25,21 @@
 #include "network_manager.h"
 #include "navigation_calc.h"
 #include "touch_controller.h"
+#include "event_bus.h"
+#include "init_scheduler.h"
+#include "wifi_station.h"
+#include "sleep_manager.h"
+#include "power_profile.h"
+#include "radio_scheduler.h"
+#include "task_plan.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "binlog.h"
+#include "heap_account.h"
+#include "latency_budget.h"
+#include "energy_account.h"
+#include "metrics_server.h"
+#include "compass_app.h"
 
 static const char *TAG = "WAYPOINT_COMPASS";
 
@@ -31,13 +48,14 @@ static const char *TAG = "WAYPOINT_COMPASS";
 #define WIFI_PASS "1011997MG"
 #define BACKEND_URL "https://waypointcompass-production.up.railway.app"
 
-// Application States
-typedef enum {
-    STATE_MENU,
-    STATE_POINTING,
-    STATE_SAFETY_WARNING,
-    STATE_SIDEQUEST
-} app_state_t;
+// App state kept in RTC memory across deep sleep
+typedef struct {
+    app_state_t state;
+    target_data_t target;
+    gps_data_t gps;
+    safety_data_t safety;
+    sidequest_data_t sidequest;
+} app_snapshot_t;
 
 // Global State
 static app_state_t current_state = STATE_MENU;
@@ -48,231 +66,694 @@ static safety_data_t safety_data = {0};
 static sidequest_data_t sidequest_data = {0};
 static bool wifi_connected = false;
 static bool backend_reachable = false;
+static bool resumed = false;  // state restored from a deep-sleep snapshot
+static volatile uint32_t wake_touch_until_ms = 0;
 
 // Task handles
 static TaskHandle_t main_task_handle = NULL;
-static TaskHandle_t gps_task_handle = NULL;
 static TaskHandle_t network_task_handle = NULL;
 
-// Event group for synchronization
-static EventGroupHandle_t app_event_group;
-#define WIFI_CONNECTED_BIT    BIT0
-#define GPS_DATA_READY_BIT    BIT1
-#define TOUCH_EVENT_BIT       BIT2
-#define BACKEND_READY_BIT     BIT3
+// Event bus subscribers: the state machine, the blocking backend calls and
+// the health poller each drain their own queue
+static bus_subscriber_t *app_sub = NULL;
+static bus_subscriber_t *network_sub = NULL;
+static bus_subscriber_t *backend_sub = NULL;
+
+#define APP_EVENTS (BUS_EVENT_MASK(BUS_EVENT_GPS_FIX) | BUS_EVENT_MASK(BUS_EVENT_TOUCH) | \
+                    BUS_EVENT_MASK(BUS_EVENT_NET_RESULT) | BUS_EVENT_MASK(BUS_EVENT_TIMER))
+
+// Boot steps, in init_scheduler order; the values double as INIT_STEP() indexes
+enum {
+    BOOT_NVS,
+    BOOT_DISPLAY,
+    BOOT_TOUCH,
+    BOOT_GPS,
+    BOOT_WIFI,
+    BOOT_NETWORK,
+    BOOT_STEP_COUNT
+};
+
+// The menu needs only these; WiFi and the backend come up behind it
+#define BOOT_UI_STEPS  (INIT_STEP(BOOT_DISPLAY) | INIT_STEP(BOOT_TOUCH))
+#define BOOT_ALL_STEPS (INIT_STEP(BOOT_STEP_COUNT) - 1)
+
+// Power-on to interactive menu budget, checked in the boot log
+#define BOOT_TARGET_MS 1000
+
+// Bus timers
+#define APP_TIMER_DIAGNOSTICS 1
+#define APP_TIMER_SLEEP       2
+#define APP_TIMER_BENCH_SETUP 3  // published by the latency bench, not a timer
+#define APP_TIMER_MESSAGE     4  // one-shot: a message box is done, redraw the screen
+
+// How long message boxes stay over the screen
+#define MESSAGE_SHORT_MS 1000
+#define MESSAGE_LONG_MS  2000
+
+// Three taps on the menu title within DIAG_TAP_WINDOW_MS open the hidden
+// diagnostics page; it refreshes with the idle check
+#define DIAG_TAPS           3
+#define DIAG_TAP_WINDOW_MS  1500
+#define DIAG_MAX_LINES      20
+
+// Typed on the serial console: print the event trace for trace-to-chrome.js
+#define TRACE_DUMP_KEY      'd'
+
+// Latency benchmark, off by default. Set to 1 to run it once after boot:
+// LATENCY_BENCH_SAMPLES GPS fixes and touches go through the app task and
+// are timed until their frame is drawn, first with the network idle and
+// then while a load task keeps HTTP requests running on the protocol core.
+#define LATENCY_BENCH         0
+#define LATENCY_BENCH_SAMPLES 20
+#define LATENCY_BENCH_GAP_MS  200
+
+#if LATENCY_BENCH
+// The bench message the app task is handling, and whether bench fixes are flowing
+static bus_msg_t *volatile bench_msg = NULL;
+static TaskHandle_t bench_task_handle = NULL;
+static volatile bool bench_running = false;
+static volatile bool bench_load_running = false;
+#else
+#define bench_running false
+#endif
+
+// Idle sleep: the panel goes off after SLEEP_LIGHT_IDLE_MS without a touch
+// while the chip naps in automatic light sleep with the radios still
+// associated, then a state snapshot and deep sleep at SLEEP_DEEP_IDLE_MS.
+// While pointing every fix counts as activity, so navigation only sleeps
+// once the GPS goes quiet.
+#define SLEEP_LIGHT_IDLE_MS       30000
+#define SLEEP_DEEP_IDLE_MS        300000
+#define SLEEP_CHECK_INTERVAL_MS   10000
+
+// Touches this soon after a touch wake only woke the device
+#define SLEEP_WAKE_TOUCH_GUARD_MS 500
+
+// Drop to the idle power profile after this long without a touch (not while pointing)
+#define POWER_IDLE_AFTER_MS 10000
+
+// How often backend_reachable is refreshed from the passive health state;
+// link changes cut the wait short, so the idle profile can wait much longer
+#define BACKEND_STATE_REFRESH_MS      5000
+#define BACKEND_STATE_REFRESH_IDLE_MS 60000
+
+// How often network timeout/retry and event bus statistics are logged
+#define NETWORK_DIAG_INTERVAL_MS 600000
+
+// Metrics endpoint for fleet scraping, off by default. Set to 1 to serve
+// GET /metrics (Prometheus) and /metrics.json on METRICS_SERVER_PORT
+#define METRICS_SERVER      0
+#define METRICS_SERVER_PORT 8080
 
 // Function prototypes
 static void app_main_task(void *pvParameters);
-static void wifi_init_sta(void);
-static void wifi_event_handler(void* arg, esp_event_base_t event_base,
-                              int32_t event_id, void* event_data);
-static void handle_touch_event(touch_event_t touch_event);
+static esp_err_t boot_nvs(void);
+static esp_err_t boot_display(void);
+static esp_err_t boot_touch(void);
+static esp_err_t boot_gps(void);
+static esp_err_t boot_wifi(void);
+static esp_err_t boot_network(void);
+static bool network_ready(void);
+static bool backend_usable(void);
+static void on_wifi_link(bool up);
+static void publish_link(bus_link_kind_t kind, bool up);
+static void on_gps_fix(const gps_data_t *fix);
+static void on_touch(const touch_event_t *event);
+static void handle_gps_fix(const gps_data_t *fix);
+static void handle_touch_event(const bus_touch_t *touch);
+static void handle_net_result(const bus_net_result_t *result);
+static void handle_timer_event(uint32_t timer_id);
+static void draw_current_screen(void);
+static void draw_diagnostics(void);
+static void show_message(const char *message, uint16_t color, uint32_t duration_ms);
+static void show_busy(const char *message, uint16_t color);
+static void on_console_key(uint8_t key);
+static void update_power_profile(void);
+static void check_idle_sleep(void);
+static void wake_screen(void);
+static void save_snapshot(void);
+static bool restore_snapshot(void);
+static void request_network(bus_net_kind_t kind);
 static void update_compass_display(void);
+static void network_task(void *pvParameters);
 static void backend_connectivity_task(void *pvParameters);
+static void start_push_channel(void);
+static void publish_pushed(bus_msg_t *msg, bus_net_kind_t kind);
+static void on_pushed_target(const target_data_t *target);
+static void on_pushed_safety(const safety_data_t *safety);
+static void on_pushed_sidequest(const sidequest_data_t *sidequest);
+#if METRICS_SERVER
+static void write_panel_metrics(metrics_writer_t *w);
+#endif
+#if LATENCY_BENCH
+static void latency_bench_task(void *pvParameters);
+static void latency_bench_load_task(void *pvParameters);
+static void bench_enter_pointing(void);
+#endif
+
+static const init_step_t boot_steps[BOOT_STEP_COUNT] = {
+    { "nvs", boot_nvs, 0, 0, tskNO_AFFINITY },
+    { "display", boot_display, 0, 0, TASK_CORE_UI },
+    { "touch", boot_touch, INIT_STEP(BOOT_DISPLAY), 0, TASK_CORE_UI },    // adds itself to the display's SPI bus
+    { "ble_gps", boot_gps, INIT_STEP(BOOT_NVS), 0, TASK_CORE_PROTOCOL },  // BT controller reads its calibration from NVS
+    { "wifi", boot_wifi, INIT_STEP(BOOT_NVS), 0, TASK_CORE_PROTOCOL },
+    { "network", boot_network, INIT_STEP(BOOT_WIFI), 6144, TASK_CORE_PROTOCOL },
+};
 
 extern "C" void app_main(void)
 {
-    // Initialize NVS
+    // A deep-sleep wake resumes the last screen instead of the splash
+    sleep_manager_init(touch_controller_get_irq_gpio());
+    resumed = sleep_manager_woke_from_deep_sleep() && restore_snapshot();
+    if (resumed) {
+        wake_touch_until_ms = UINT32_MAX;
+    }
+    
+    // Hot-path logs print from the drain task from here on
+    binlog_init();
+    energy_account_init(&compass_app_energy_model);
+    
+    // Event bus and its subscribers, before anything can publish
+    event_bus_init();
+    app_sub = event_bus_subscribe("app", APP_EVENTS, 8);
+    network_sub = event_bus_subscribe("network", BUS_EVENT_MASK(BUS_EVENT_NET_REQUEST), 4);
+    backend_sub = event_bus_subscribe("backend_check", BUS_EVENT_MASK(BUS_EVENT_LINK), 4);
+    
+    // Sampling from here on sees every boot step's task
+    telemetry_init();
+    telemetry_set_key_handler(on_console_key);
+    
+    // Independent subsystems come up concurrently; see boot_steps
+    init_scheduler_start(boot_steps, BOOT_STEP_COUNT);
+    
+    // Create tasks per task_plan.h; each waits for the boot steps it needs
+    xTaskCreatePinnedToCore(app_main_task, "app_main", 8192, NULL, TASK_PRIO_APP, &main_task_handle, TASK_CORE_UI);
+    xTaskCreatePinnedToCore(network_task, "network", 8192, NULL, TASK_PRIO_NETWORK, &network_task_handle,
+                            TASK_CORE_PROTOCOL);
+    xTaskCreatePinnedToCore(backend_connectivity_task, "backend_check", 4096, NULL, TASK_PRIO_BACKEND, NULL,
+                            TASK_CORE_PROTOCOL);
+#if LATENCY_BENCH
+    xTaskCreatePinnedToCore(latency_bench_task, "latency_bench", 4096, NULL, TASK_PRIO_TOUCH, &bench_task_handle,
+                            TASK_CORE_UI);
+#endif
+    event_bus_timer_start(APP_TIMER_DIAGNOSTICS, NETWORK_DIAG_INTERVAL_MS);
+    event_bus_timer_start(APP_TIMER_SLEEP, SLEEP_CHECK_INTERVAL_MS);
+}
+
+static esp_err_t boot_nvs(void)
+{
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
-    ESP_ERROR_CHECK(ret);
-
-    // Create event group
-    app_event_group = xEventGroupCreate();
+    return ret;
+}
 
-    // Initialize components
-    ESP_LOGI(TAG, "Initializing display...");
+static esp_err_t boot_display(void)
+{
     compass_display_init();
-    
-    ESP_LOGI(TAG, "Initializing touch controller...");
+    if (!resumed) {
+        compass_display_show_startup();
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_touch(void)
+{
     touch_controller_init();
-    
-    ESP_LOGI(TAG, "Initializing BLE GPS handler...");
+    touch_controller_set_callback(on_touch);
+    return ESP_OK;
+}
+
+static esp_err_t boot_gps(void)
+{
     gps_handler_init();
-    
-    ESP_LOGI(TAG, "Initializing WiFi...");
-    wifi_init_sta();
-    
-    ESP_LOGI(TAG, "Initializing network manager...");
+    gps_handler_set_fix_callback(on_gps_fix);
+    return ESP_OK;
+}
+
+static esp_err_t boot_wifi(void)
+{
+    wifi_station_init(WIFI_SSID, WIFI_PASS, on_wifi_link);
+    return ESP_OK;
+}
+
+static esp_err_t boot_network(void)
+{
     network_manager_init(BACKEND_URL);
+    network_manager_set_first_byte_callback(wifi_station_record_first_byte);
+    network_manager_sidequest_prefetch_start(SIDEQUEST_PREFETCH_DEFAULT_DISTANCE_M);
+    start_push_channel();
+#if METRICS_SERVER
+    metrics_server_set_extra(write_panel_metrics);
+    metrics_server_start(METRICS_SERVER_PORT);
+#endif
+    return ESP_OK;
+}
 
-    // Show startup screen
-    compass_display_show_startup();
-    vTaskDelay(pdMS_TO_TICKS(2000));
+static bool network_ready(void)
+{
+    return init_scheduler_is_done(INIT_STEP(BOOT_NETWORK));
+}
 
-    // Create main application task
-    xTaskCreate(app_main_task, "app_main", 8192, NULL, 5, &main_task_handle);
-    
-    // Create background tasks
-    xTaskCreate(backend_connectivity_task, "backend_check", 4096, NULL, 3, NULL);
-    
-    ESP_LOGI(TAG, "WaypointCompass ESP-IDF started!");
+// The menu is up before WiFi; backend actions wait for all three
+static bool backend_usable(void)
+{
+    return wifi_connected && network_ready() && network_manager_backend_available();
 }
 
+// The state machine: every input arrives as a bus event and nothing here
+// blocks on the network, so a touch or fix is handled as soon as it lands
 static void app_main_task(void *pvParameters)
 {
-    EventBits_t bits;
-    touch_event_t touch_event;
+    heap_account_enter(HEAP_ACCOUNT_APP);
     
-    // Wait for initial WiFi connection
-    ESP_LOGI(TAG, "Waiting for WiFi connection...");
-    xEventGroupWaitBits(app_event_group, WIFI_CONNECTED_BIT, false, true, portMAX_DELAY);
+    // Interactive as soon as the screen and touch are up, online or not
+    init_scheduler_wait(BOOT_UI_STEPS, portMAX_DELAY);
+    draw_current_screen();
+    if (resumed) {
+        sleep_manager_frame_shown();
+        wake_touch_until_ms = esp_log_timestamp() + SLEEP_WAKE_TOUCH_GUARD_MS;
+    }
     
-    // Show main menu
-    compass_display_draw_menu();
-    current_state = STATE_MENU;
+    uint32_t menu_ms = esp_log_timestamp();
+    if (menu_ms > BOOT_TARGET_MS) {
+        ESP_LOGW(TAG, "Menu interactive at %lu ms, over the %d ms boot target", (unsigned long)menu_ms, BOOT_TARGET_MS);
+    } else {
+        ESP_LOGI(TAG, "Menu interactive at %lu ms", (unsigned long)menu_ms);
+    }
     
     while (1) {
-        // Wait for events
-        bits = xEventGroupWaitBits(app_event_group,
-                                  GPS_DATA_READY_BIT | TOUCH_EVENT_BIT,
-                                  true, // Clear bits on exit
-                                  false, // Wait for any bit
-                                  pdMS_TO_TICKS(1000));
+        bus_msg_t *msg = event_bus_receive(app_sub, portMAX_DELAY);
+        if (!msg) continue;
+        TRACE_BEGIN(TRACE_APP_EVENT, msg->type);
         
-        if (bits & GPS_DATA_READY_BIT) {
-            // Get latest GPS data
-            current_gps = gps_handler_get_data();
-            
-            // Update compass if in pointing mode
-            if (current_state == STATE_POINTING && current_target.active) {
-                update_compass_display();
-            }
+        switch (msg->type) {
+            case BUS_EVENT_GPS_FIX:
+                handle_gps_fix(&msg->data.fix);
+                break;
+            case BUS_EVENT_TOUCH:
+                handle_touch_event(&msg->data.touch);
+                // Drawing is synchronous, so this is touch to frame on screen
+                power_profile_record_ui_latency(esp_log_timestamp() - msg->published_ms);
+                break;
+            case BUS_EVENT_NET_RESULT:
+                handle_net_result(&msg->data.result);
+                break;
+            case BUS_EVENT_TIMER:
+                handle_timer_event(msg->data.timer_id);
+                break;
+            default:
+                break;
         }
-        
-        if (bits & TOUCH_EVENT_BIT) {
-            // Get touch event
-            if (touch_controller_get_event(&touch_event)) {
-                handle_touch_event(touch_event);
-            }
+#if LATENCY_BENCH
+        // Drawing is synchronous, so the bench's frame is on the panel now
+        if (msg == bench_msg) {
+            bench_msg = NULL;
+            xTaskNotifyGive(bench_task_handle);
         }
-        
-        // Periodic updates
-        if (current_state == STATE_POINTING && current_target.active) {
-            update_compass_display();
+#endif
+        event_bus_release(msg);
+        // Activity other than a touch (a pushed alert or target) turns the screen on too
+        if (sleep_manager_screen_is_off() && sleep_manager_idle_ms() < SLEEP_LIGHT_IDLE_MS) {
+            wake_screen();
+        }
+        update_power_profile();
+        TRACE_END(TRACE_APP_EVENT);
+    }
+}
+
+static void handle_gps_fix(const gps_data_t *fix)
+{
+    TRACE_BEGIN(TRACE_APP_GPS_FIX, 0);
+    TRACE_FLOW_STEP(TRACE_GPS_FLOW, fix->trace_flow);
+    latency_budget_begin(fix->received_us, fix->parsed_us);
+    latency_budget_mark(LATENCY_STAGE_DISPATCH);
+    current_gps = *fix;
+    
+    // Fixes before the network step finishes still move the compass; bench
+    // fixes never reach the backend
+    if (network_ready() && !bench_running) {
+        network_manager_sidequest_prefetch_update(&current_gps);
+        if (wifi_connected) {
+            network_manager_submit_gps_fix(&current_gps);
+        }
+    }
+    
+    if (current_state == STATE_POINTING && current_target.active) {
+        sleep_manager_note_activity();
+        update_compass_display();
+    }
+    latency_budget_end();
+    TRACE_END(TRACE_APP_GPS_FIX);
+}
+
+static void handle_timer_event(uint32_t timer_id)
+{
+    if (timer_id == APP_TIMER_DIAGNOSTICS) {
+        network_manager_log_diagnostics();
+        wifi_station_log_stats();
+        sleep_manager_log_stats();
+        power_profile_log_stats();
+        radio_scheduler_log_stats();
+        event_bus_log_stats();
+        telemetry_log();
+        latency_budget_log_stats();
+        heap_account_log();
+        energy_account_log();
+    } else if (timer_id == APP_TIMER_MESSAGE) {
+        draw_current_screen();
+    } else if (timer_id == APP_TIMER_SLEEP) {
+        check_idle_sleep();
+        if (current_state == STATE_DIAGNOSTICS) {
+            draw_diagnostics();
         }
+#if LATENCY_BENCH
+    } else if (timer_id == APP_TIMER_BENCH_SETUP) {
+        bench_enter_pointing();
+#endif
+    }
+}
+
+// Navigating while pointing, menu while someone is using it, idle otherwise
+static void update_power_profile(void)
+{
+    power_profile_t profile = POWER_PROFILE_MENU;
+    if (current_state == STATE_POINTING) {
+        profile = POWER_PROFILE_NAVIGATING;
+    } else if (sleep_manager_idle_ms() >= POWER_IDLE_AFTER_MS) {
+        profile = POWER_PROFILE_IDLE;
+    }
+    power_profile_set(profile);
+}
+
+// Redraws the screen for current_state from the cached data
+static void draw_current_screen(void)
+{
+    switch (current_state) {
+        case STATE_MENU:
+            compass_display_draw_menu();
+            break;
+        case STATE_POINTING:
+            update_compass_display();
+            break;
+        case STATE_SAFETY_WARNING:
+            compass_display_draw_safety(&safety_data);
+            break;
+        case STATE_SIDEQUEST:
+            compass_display_draw_sidequest(&sidequest_data);
+            break;
+        case STATE_DIAGNOSTICS:
+            draw_diagnostics();
+            break;
+    }
+}
+
+// Never waits: the screen under the box is redrawn when APP_TIMER_MESSAGE fires
+static void show_message(const char *message, uint16_t color, uint32_t duration_ms)
+{
+    compass_display_show_message(message, color);
+    event_bus_timer_once(APP_TIMER_MESSAGE, duration_ms);
+}
+
+// Loading state: stays up until the reply draws its screen
+static void show_busy(const char *message, uint16_t color)
+{
+    event_bus_timer_stop(APP_TIMER_MESSAGE);
+    compass_display_show_message(message, color);
+}
+
+// Runs on the telemetry task
+static void on_console_key(uint8_t key)
+{
+    if (key == TRACE_DUMP_KEY) {
+        trace_dump();
     }
 }
 
-static void wifi_init_sta(void)
+static void draw_diagnostics(void)
 {
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+    // App task only
+    static char text[DIAG_MAX_LINES][TELEMETRY_LINE_LEN];
+    const char *lines[DIAG_MAX_LINES];
+    
+    int count = telemetry_format_lines(text, DIAG_MAX_LINES);
+    for (int i = 0; i < count; i++) {
+        lines[i] = text[i];
+    }
+    compass_display_draw_diagnostics(lines, count);
+}
 
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+// Runs on the app task. No manual light sleep: it would drop the WiFi and
+// BLE links, so the screen goes off and automatic light sleep (the idle
+// power profile) does the napping; only deep sleep powers the radios down.
+static void check_idle_sleep(void)
+{
+    uint32_t idle_ms = sleep_manager_idle_ms();
+    if (idle_ms < SLEEP_LIGHT_IDLE_MS) return;
+    
+    if (!sleep_manager_screen_is_off()) {
+        compass_display_set_sleep(true);
+        sleep_manager_screen_off();
+    }
+    
+    if (idle_ms >= SLEEP_DEEP_IDLE_MS) {
+        // Idle through the screen-off stretch too: keep the state and power down
+        save_snapshot();
+        sleep_manager_deep_sleep();
+    }
+}
+
+// The panel keeps its frame in sleep mode, so waking needs no redraw
+static void wake_screen(void)
+{
+    compass_display_set_sleep(false);
+    sleep_manager_screen_on();
+    sleep_manager_frame_shown();
+    wake_touch_until_ms = esp_log_timestamp() + SLEEP_WAKE_TOUCH_GUARD_MS;
+}
+
+static void save_snapshot(void)
+{
+    app_snapshot_t snapshot = {};
+    snapshot.state = current_state;
+    snapshot.target = current_target;
+    snapshot.gps = current_gps;
+    snapshot.safety = safety_data;
+    snapshot.sidequest = sidequest_data;
+    sleep_manager_save_snapshot(&snapshot, sizeof(snapshot));
+}
 
-    esp_event_handler_instance_t instance_any_id;
-    esp_event_handler_instance_t instance_got_ip;
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-                                                        ESP_EVENT_ANY_ID,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_any_id));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-                                                        IP_EVENT_STA_GOT_IP,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_got_ip));
+static bool restore_snapshot(void)
+{
+    app_snapshot_t snapshot;
+    if (!sleep_manager_load_snapshot(&snapshot, sizeof(snapshot))) {
+        ESP_LOGW(TAG, "No valid sleep snapshot, starting from the menu");
+        return false;
+    }
+    
+    current_state = snapshot.state;
+    current_target = snapshot.target;
+    current_gps = snapshot.gps;
+    safety_data = snapshot.safety;
+    sidequest_data = snapshot.sidequest;
+    ESP_LOGI(TAG, "Resuming in state %d from the sleep snapshot", current_state);
+    return true;
+}
 
-    wifi_config_t wifi_config = {};
-    strcpy((char*)wifi_config.sta.ssid, WIFI_SSID);
-    strcpy((char*)wifi_config.sta.password, WIFI_PASS);
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+// Runs on the event loop task; wifi_station handles reconnects and backoff
+static void on_wifi_link(bool up)
+{
+    wifi_connected = up;
+    radio_scheduler_set_link(up);
+    publish_link(BUS_LINK_WIFI, up);
+}
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+static void publish_link(bus_link_kind_t kind, bool up)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_LINK);
+    if (msg) {
+        msg->data.link.kind = kind;
+        msg->data.link.up = up;
+        event_bus_publish(msg);
+    }
+}
 
-    ESP_LOGI(TAG, "WiFi initialization finished.");
+// Runs on the GPS handler's task: hand the fix to the bus and return
+static void on_gps_fix(const gps_data_t *fix)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_GPS_FIX);
+    if (msg) {
+        msg->data.fix = *fix;
+        event_bus_publish(msg);
+    }
 }
 
-static void wifi_event_handler(void* arg, esp_event_base_t event_base,
-                              int32_t event_id, void* event_data)
+// Runs on the touch task; the state machine only acts on presses
+static void on_touch(const touch_event_t *event)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        esp_wifi_connect();
-        wifi_connected = false;
-        xEventGroupClearBits(app_event_group, WIFI_CONNECTED_BIT);
-        ESP_LOGI(TAG, "WiFi disconnected, trying to reconnect...");
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        wifi_connected = true;
-        xEventGroupSetBits(app_event_group, WIFI_CONNECTED_BIT);
+    if (!event->pressed) return;
+    
+    // The touch that woke the device only wakes it
+    if (esp_log_timestamp() < wake_touch_until_ms) return;
+    
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_TOUCH);
+    if (msg) {
+        msg->data.touch.x = event->x;
+        msg->data.touch.y = event->y;
+        msg->data.touch.pressed = true;
+        event_bus_publish(msg);
     }
 }
 
-static void handle_touch_event(touch_event_t touch_event)
+static void handle_touch_event(const bus_touch_t *touch)
 {
-    int x = touch_event.x;
-    int y = touch_event.y;
+    int x = touch->x;
+    int y = touch->y;
+    
+    // The touch that turns the screen back on only does that
+    if (sleep_manager_screen_is_off()) {
+        wake_screen();
+        return;
+    }
     
     ESP_LOGI(TAG, "Touch event at (%d, %d) in state %d", x, y, current_state);
+    sleep_manager_note_activity();
     
-    switch (current_state) {
-        case STATE_MENU:
-            if (y >= 150 && y <= 190) {
-                // Save Location
-                network_manager_save_location(&current_gps);
-            } else if (y >= 200 && y <= 240) {
-                // Navigate To
-                network_manager_select_target_location(&current_target);
-                if (current_target.active) {
-                    current_state = STATE_POINTING;
-                    update_compass_display();
-                }
-            } else if (y >= 250 && y <= 290) {
-                // Safety Check
-                current_state = STATE_SAFETY_WARNING;
-                network_manager_check_location_safety(&current_gps, &safety_data);
-                compass_display_draw_safety(&safety_data);
-            } else if (y >= 270 && y <= 310) {
-                // Sidequest
-                current_state = STATE_SIDEQUEST;
-                if (!sidequest_data.active) {
-                    network_manager_generate_sidequest(&current_gps, &sidequest_data);
-                }
+    app_touch_action_t action = compass_app_touch_action(current_state, y, sidequest_data.active);
+    if (compass_app_touch_needs_backend(action) && !backend_usable()) {
+        show_message("Backend offline", COLOR_DANGER, MESSAGE_SHORT_MS);
+        return;
+    }
+    
+    switch (action) {
+        case APP_TOUCH_TITLE: {
+            // Taps on the title count towards the hidden diagnostics page
+            static uint32_t first_tap_ms = 0;
+            static int taps = 0;
+            uint32_t now_ms = esp_log_timestamp();
+            if (taps == 0 || now_ms - first_tap_ms > DIAG_TAP_WINDOW_MS) {
+                taps = 0;
+                first_tap_ms = now_ms;
+            }
+            if (++taps >= DIAG_TAPS) {
+                taps = 0;
+                current_state = STATE_DIAGNOSTICS;
+                draw_diagnostics();
+            }
+            break;
+        }
+        
+        case APP_TOUCH_SAVE_LOCATION:
+            request_network(BUS_NET_SAVE_LOCATION);
+            break;
+        
+        case APP_TOUCH_NAVIGATE:
+            // Pointing starts when the target arrives
+            request_network(BUS_NET_TARGET);
+            break;
+        
+        case APP_TOUCH_SAFETY:
+            current_state = STATE_SAFETY_WARNING;
+            show_busy("Checking safety...", COLOR_WARNING);
+            request_network(BUS_NET_SAFETY);
+            break;
+        
+        case APP_TOUCH_SIDEQUEST:
+            // Prefetched ones are instant, otherwise ask the network task
+            current_state = STATE_SIDEQUEST;
+            if (sidequest_data.active ||
+                network_manager_sidequest_prefetch_take(&current_gps, &sidequest_data)) {
                 compass_display_draw_sidequest(&sidequest_data);
+            } else {
+                show_busy("Finding sidequest...", COLOR_SIDEQUEST);
+                request_network(BUS_NET_SIDEQUEST);
             }
             break;
-            
-        case STATE_POINTING:
-            // Back to menu
-            current_state = STATE_MENU;
-            current_target.active = false;
-            compass_display_draw_menu();
+        
+        case APP_TOUCH_SIDEQUEST_GO:
+            strcpy(current_target.name, sidequest_data.title);
+            current_target.latitude = sidequest_data.target_lat;
+            current_target.longitude = sidequest_data.target_lng;
+            current_target.active = true;
+            current_state = STATE_POINTING;
+            update_compass_display();
             break;
-            
-        case STATE_SAFETY_WARNING:
-            // Back to menu
+        
+        case APP_TOUCH_SIDEQUEST_RETRY:
+            show_busy("Finding sidequest...", COLOR_SIDEQUEST);
+            request_network(BUS_NET_SIDEQUEST);
+            break;
+        
+        case APP_TOUCH_BACK:
+            // Leaving the compass drops the target
+            if (current_state == STATE_POINTING) {
+                current_target.active = false;
+            }
             current_state = STATE_MENU;
             compass_display_draw_menu();
             break;
-            
-        case STATE_SIDEQUEST:
-            if (sidequest_data.active && y >= 400 && y <= 430) {
-                // Navigate to sidequest
-                strcpy(current_target.name, sidequest_data.title);
-                current_target.latitude = sidequest_data.target_lat;
-                current_target.longitude = sidequest_data.target_lng;
-                current_target.active = true;
+        
+        case APP_TOUCH_NONE:
+            break;
+    }
+}
+
+static void request_network(bus_net_kind_t kind)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_REQUEST);
+    if (msg) {
+        msg->data.request.kind = kind;
+        msg->data.request.fix = current_gps;
+        event_bus_publish(msg);
+    }
+}
+
+// Replies and pushed updates both land here. A reply only changes the
+// screen if the user is still on the one that asked for it.
+static void handle_net_result(const bus_net_result_t *result)
+{
+    switch (result->kind) {
+        case BUS_NET_SAVE_LOCATION:
+            if (current_state == STATE_MENU) {
+                show_message(result->ok ? "Location saved" : "Save failed",
+                             result->ok ? COLOR_SAFE : COLOR_DANGER, MESSAGE_SHORT_MS);
+            }
+            break;
+        
+        case BUS_NET_TARGET:
+            // A target set from the app takes over the compass
+            if (result->ok && result->target.active && (result->pushed || current_state == STATE_MENU)) {
+                current_target = result->target;
                 current_state = STATE_POINTING;
                 update_compass_display();
-            } else if (!sidequest_data.active && y >= 250 && y <= 290) {
-                // Generate new sidequest
-                network_manager_generate_sidequest(&current_gps, &sidequest_data);
+            }
+            break;
+        
+        case BUS_NET_SAFETY:
+            if (!result->ok) {
+                // No report to show: back to the menu rather than a zeroed screen
+                if (current_state == STATE_SAFETY_WARNING) {
+                    current_state = STATE_MENU;
+                    show_message("Safety check failed", COLOR_DANGER, MESSAGE_LONG_MS);
+                }
+            } else if (result->pushed) {
+                safety_data = result->safety;
+                show_message("Safety alert", COLOR_DANGER, MESSAGE_LONG_MS);
+                sleep_manager_note_activity();
+            } else if (current_state == STATE_SAFETY_WARNING) {
+                safety_data = result->safety;
+                compass_display_draw_safety(&safety_data);
+            }
+            break;
+        
+        case BUS_NET_SIDEQUEST:
+            if (result->ok) {
+                sidequest_data = result->sidequest;
+            }
+            if (current_state == STATE_SIDEQUEST) {
                 compass_display_draw_sidequest(&sidequest_data);
-            } else {
-                // Back to menu
-                current_state = STATE_MENU;
-                compass_display_draw_menu();
             }
             break;
     }
@@ -283,32 +764,308 @@ static void update_compass_display(void)
     if (!current_gps.valid || !current_target.active) return;
     
     // Calculate bearing and distance
+    TRACE_BEGIN(TRACE_NAV_BEARING, 0);
     compass_data.bearing = navigation_calc_bearing(current_gps.latitude, current_gps.longitude,
                                                   current_target.latitude, current_target.longitude);
     compass_data.distance = navigation_calc_distance(current_gps.latitude, current_gps.longitude,
                                                     current_target.latitude, current_target.longitude);
+    TRACE_END(TRACE_NAV_BEARING);
+    latency_budget_mark(LATENCY_STAGE_BEARING);
     
-    // Update display
+    // Update display; the SPI transfers are synchronous, so the last byte
+    // of the frame is out when the draw returns
+    latency_budget_mark(LATENCY_STAGE_DRAW_ISSUED);
     compass_display_draw_compass(&compass_data, &current_target);
+    latency_budget_mark(LATENCY_STAGE_PIXELS);
+}
+
+// Runs the blocking backend calls so the state machine never waits on them.
+// The reply is filled in place in a pool message and published as-is.
+static void network_task(void *pvParameters)
+{
+    heap_account_enter(HEAP_ACCOUNT_NETWORK);
+    
+    // Requests made before then wait in the queue
+    init_scheduler_wait(INIT_STEP(BOOT_NETWORK), portMAX_DELAY);
+    
+    while (1) {
+        bus_msg_t *msg = event_bus_receive(network_sub, portMAX_DELAY);
+        if (!msg) continue;
+        
+        bus_net_request_t request = msg->data.request;
+        event_bus_release(msg);
+        
+        bus_msg_t *reply = event_bus_alloc(BUS_EVENT_NET_RESULT);
+        if (!reply) continue;
+        
+        bus_net_result_t *result = &reply->data.result;
+        result->kind = request.kind;
+        switch (request.kind) {
+            case BUS_NET_SAVE_LOCATION:
+                result->ok = network_manager_save_location(&request.fix);
+                break;
+            case BUS_NET_TARGET:
+                result->ok = network_manager_select_target_location(&result->target);
+                break;
+            case BUS_NET_SAFETY:
+                result->ok = network_manager_check_location_safety(&request.fix, &result->safety);
+                break;
+            case BUS_NET_SIDEQUEST:
+                result->ok = network_manager_generate_sidequest(&request.fix, &result->sidequest);
+                break;
+        }
+        event_bus_publish(reply);
+    }
 }
 
 static void backend_connectivity_task(void *pvParameters)
 {
+    heap_account_enter(HEAP_ACCOUNT_NETWORK);
+    
+    init_scheduler_wait(BOOT_ALL_STEPS, portMAX_DELAY);
+    init_scheduler_log();
+    
+    // Boot runs at full speed; frequency scaling starts once everything is up
+    power_profile_init(current_state == STATE_POINTING ? POWER_PROFILE_NAVIGATING : POWER_PROFILE_MENU);
+    
     while (1) {
-        if (wifi_connected) {
-            bool reachable = network_manager_test_connectivity();
-            if (reachable != backend_reachable) {
-                backend_reachable = reachable;
-                if (reachable) {
-                    xEventGroupSetBits(app_event_group, BACKEND_READY_BIT);
-                    ESP_LOGI(TAG, "Backend is reachable");
-                } else {
-                    xEventGroupClearBits(app_event_group, BACKEND_READY_BIT);
-                    ESP_LOGI(TAG, "Backend is not reachable");
-                }
-            }
+        // Health comes from real traffic; this only probes when idle or recovering
+        uint32_t next_poll_ms = network_manager_health_poll(wifi_connected);
+        
+        bool reachable = wifi_connected && network_manager_backend_available();
+        if (reachable != backend_reachable) {
+            backend_reachable = reachable;
+            ESP_LOGI(TAG, "Backend is %s", reachable ? "reachable" : "not reachable");
+            publish_link(BUS_LINK_BACKEND, reachable);
+        }
+        
+        uint32_t refresh_ms = power_profile_get() == POWER_PROFILE_IDLE ? BACKEND_STATE_REFRESH_IDLE_MS
+                                                                         : BACKEND_STATE_REFRESH_MS;
+        if (next_poll_ms > refresh_ms) {
+            next_poll_ms = refresh_ms;
+        }
+        
+        // A link change cuts the wait short so the state follows WiFi at once
+        event_bus_release(event_bus_receive(backend_sub, pdMS_TO_TICKS(next_poll_ms)));
+    }
+}
+
+static void start_push_channel(void)
+{
+    // One connection per unit, named after its MAC address
+    uint8_t mac[6];
+    char device_id[32];
+    esp_efuse_mac_get_default(mac);
+    snprintf(device_id, sizeof(device_id), "compass-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    
+    nm_push_handlers_t handlers = {};
+    handlers.on_target = on_pushed_target;
+    handlers.on_safety = on_pushed_safety;
+    handlers.on_sidequest = on_pushed_sidequest;
+    network_manager_push_start(device_id, &handlers);
+}
+
+// Pushed updates arrive on the WebSocket task and take the same path as replies
+static void publish_pushed(bus_msg_t *msg, bus_net_kind_t kind)
+{
+    msg->data.result.kind = kind;
+    msg->data.result.ok = true;
+    msg->data.result.pushed = true;
+    event_bus_publish(msg);
+}
+
+static void on_pushed_target(const target_data_t *target)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_RESULT);
+    if (msg) {
+        msg->data.result.target = *target;
+        publish_pushed(msg, BUS_NET_TARGET);
+    }
+}
+
+static void on_pushed_safety(const safety_data_t *safety)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_RESULT);
+    if (msg) {
+        msg->data.result.safety = *safety;
+        publish_pushed(msg, BUS_NET_SAFETY);
+    }
+}
+
+static void on_pushed_sidequest(const sidequest_data_t *sidequest)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_RESULT);
+    if (msg) {
+        msg->data.result.sidequest = *sidequest;
+        publish_pushed(msg, BUS_NET_SIDEQUEST);
+    }
+}
+
+#if METRICS_SERVER
+// Panel traffic since boot, from the metrics refresh task
+static void write_panel_metrics(metrics_writer_t *w)
+{
+    display_metrics_t panel;
+    compass_display_get_metrics(&panel);
+    metrics_family(w, "waypoint_panel_sent_total", "counter", "SPI traffic to the panel");
+    metrics_sample(w, panel.transactions, "kind=\"transaction\"");
+    metrics_sample(w, panel.bytes, "kind=\"byte\"");
+    metrics_sample(w, panel.pixels, "kind=\"pixel\"");
+}
+#endif
+
+#if LATENCY_BENCH
+typedef struct {
+    const char *name;
+    uint32_t count;
+    uint32_t samples_us[LATENCY_BENCH_SAMPLES];
+} bench_series_t;
+
+// Points at a target 1 km north of the last fix, so each bench fix redraws the compass
+static void bench_enter_pointing(void)
+{
+    strcpy(current_target.name, "Latency bench");
+    current_target.latitude = current_gps.latitude + 0.009;
+    current_target.longitude = current_gps.longitude;
+    current_target.active = true;
+    current_state = STATE_POINTING;
+}
+
+// Publishes msg and returns the microseconds until the app task has drawn it
+static bool bench_round_trip(bus_msg_t *msg, uint32_t *elapsed_us)
+{
+    ulTaskNotifyTake(pdTRUE, 0);
+    bench_msg = msg;
+    int64_t start_us = esp_timer_get_time();
+    event_bus_publish(msg);
+    
+    if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000))) {
+        bench_msg = NULL;
+        return false;
+    }
+    *elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    return true;
+}
+
+static void bench_run(bench_series_t *gps, bench_series_t *touch)
+{
+    gps_data_t fix = current_gps;
+    if (!fix.valid) {
+        fix.latitude = 37.7749;
+        fix.longitude = -122.4194;
+        fix.accuracy = 5.0f;
+        fix.valid = true;
+    }
+    // Timed here, not against the latency budget
+    fix.received_us = 0;
+    
+    for (int i = 0; i < LATENCY_BENCH_SAMPLES; i++) {
+        // Pointing, so a fix redraws the compass and a touch the menu
+        bus_msg_t *msg = event_bus_alloc(BUS_EVENT_TIMER);
+        uint32_t elapsed_us;
+        if (!msg) break;
+        msg->data.timer_id = APP_TIMER_BENCH_SETUP;
+        bench_round_trip(msg, &elapsed_us);
+        
+        msg = event_bus_alloc(BUS_EVENT_GPS_FIX);
+        if (!msg) break;
+        fix.latitude += 0.00001 * (i + 1);
+        fix.timestamp = esp_log_timestamp();
+        msg->data.fix = fix;
+        if (bench_round_trip(msg, &elapsed_us)) {
+            gps->samples_us[gps->count++] = elapsed_us;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Check every 10 seconds
+        msg = event_bus_alloc(BUS_EVENT_TOUCH);
+        if (!msg) break;
+        msg->data.touch.x = 120;
+        msg->data.touch.y = 160;
+        msg->data.touch.pressed = true;
+        if (bench_round_trip(msg, &elapsed_us)) {
+            touch->samples_us[touch->count++] = elapsed_us;
+        }
+        
+        vTaskDelay(pdMS_TO_TICKS(LATENCY_BENCH_GAP_MS));
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_log(const char *phase, bench_series_t *series)
+{
+    if (series->count == 0) {
+        ESP_LOGW(TAG, "  %-6s %-10s no samples", phase, series->name);
+        return;
+    }
+    
+    uint64_t total_us = 0;
+    for (uint32_t i = 0; i < series->count; i++) {
+        total_us += series->samples_us[i];
     }
-}
\ No newline at end of file
+    qsort(series->samples_us, series->count, sizeof(uint32_t), compare_u32);
+    ESP_LOGI(TAG, "  %-6s %-10s n=%-3lu avg %6.1f ms  p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms", phase,
+             series->name, (unsigned long)series->count, total_us / 1000.0 / series->count,
+             series->samples_us[series->count / 2] / 1000.0,
+             series->samples_us[(series->count * 95) / 100] / 1000.0,
+             series->samples_us[series->count - 1] / 1000.0);
+}
+
+// Keeps the location list downloading back to back, like a user request
+static void latency_bench_load_task(void *pvParameters)
+{
+    uint32_t transfers = 0;
+    target_data_t scratch;
+    while (bench_load_running) {
+        network_manager_select_target_location_within(&scratch, 5000);
+        transfers++;
+    }
+    ESP_LOGI(TAG, "Bench load task made %lu requests", (unsigned long)transfers);
+    xTaskNotifyGive(bench_task_handle);
+    vTaskDelete(NULL);
+}
+
+static void latency_bench_task(void *pvParameters)
+{
+    init_scheduler_wait(BOOT_ALL_STEPS, portMAX_DELAY);
+    // Let the first connect and health probe settle
+    vTaskDelay(pdMS_TO_TICKS(5000));
+    
+    bench_series_t idle_gps = { "gps", 0, {} };
+    bench_series_t idle_touch = { "touch", 0, {} };
+    bench_series_t load_gps = { "gps", 0, {} };
+    bench_series_t load_touch = { "touch", 0, {} };
+    
+    ESP_LOGI(TAG, "Latency bench: %d samples idle, then under HTTP load", LATENCY_BENCH_SAMPLES);
+    bench_running = true;
+    bench_run(&idle_gps, &idle_touch);
+    
+    bool load = backend_usable();
+    if (load) {
+        bench_load_running = true;
+        xTaskCreatePinnedToCore(latency_bench_load_task, "bench_load", 8192, NULL, TASK_PRIO_NETWORK, NULL,
+                                TASK_CORE_PROTOCOL);
+        vTaskDelay(pdMS_TO_TICKS(500));
+        bench_run(&load_gps, &load_touch);
+        bench_load_running = false;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    } else {
+        ESP_LOGW(TAG, "Backend not reachable, skipping the HTTP load phase");
+    }
+    bench_running = false;
+    
+    ESP_LOGI(TAG, "Latency bench, publish to frame drawn (app on core %d, network on core %d):",
+             (int)TASK_CORE_UI, (int)TASK_CORE_PROTOCOL);
+    bench_log("idle", &idle_gps);
+    bench_log("idle", &idle_touch);
+    if (load) {
+        bench_log("http", &load_gps);
+        bench_log("http", &load_touch);
+    }
+    vTaskDelete(NULL);
+}
+#endif
@@ -0,0 +1,200 @@
+#include "sim_golden.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "compass_display.h"
+
+static const char *TAG = "SIM_GOLDEN";
+
+#define GOLDEN_MAX_SCREENS 16
+
+// One line of the golden file: name, frame hash and the SPI cost of drawing it
+typedef struct {
+    char name[32];
+    uint32_t hash;
+    display_metrics_t metrics;
+} golden_entry_t;
+
+typedef struct {
+    const char *name;
+    void (*draw)(void);
+} golden_screen_t;
+
+// Fixtures, fixed so the frames only change when the renderer does
+static void draw_startup(void)
+{
+    compass_display_show_startup();
+}
+
+static void draw_menu(void)
+{
+    compass_display_draw_menu();
+}
+
+static void draw_compass(void)
+{
+    target_data_t target = {};
+    strcpy(target.name, "Summit Lookout");
+    target.latitude = 37.7849;
+    target.longitude = -122.4094;
+    target.active = true;
+    compass_data_t compass = { .bearing = 45.0f, .distance = 1.23f, .valid = true };
+    compass_display_draw_compass(&compass, &target);
+}
+
+static void draw_safety(void)
+{
+    safety_data_t safety = {};
+    safety.risk_score = 5.5f;
+    strcpy(safety.time_risk, "moderate");
+    strcpy(safety.warnings, "Sunset in 45 minutes, trail poorly lit");
+    strcpy(safety.hazards, "Loose rock on the upper switchbacks");
+    safety.has_emergency_services = true;
+    compass_display_draw_safety(&safety);
+}
+
+static void draw_sidequest(void)
+{
+    sidequest_data_t sidequest = {};
+    strcpy(sidequest.title, "Mystery Adventure");
+    strcpy(sidequest.description, "Destination unknown - follow your compass to a spot most hikers walk right past!");
+    strcpy(sidequest.location, "Mystery Location");
+    strcpy(sidequest.difficulty, "moderate");
+    sidequest.active = true;
+    compass_display_draw_sidequest(&sidequest);
+}
+
+static void draw_sidequest_empty(void)
+{
+    sidequest_data_t sidequest = {};
+    compass_display_draw_sidequest(&sidequest);
+}
+
+static const golden_screen_t golden_screens[] = {
+    { "startup", draw_startup },
+    { "menu", draw_menu },
+    { "compass", draw_compass },
+    { "safety", draw_safety },
+    { "sidequest", draw_sidequest },
+    { "sidequest_empty", draw_sidequest_empty },
+};
+
+static int load_golden(const char *path, golden_entry_t *entries, int max_entries)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    
+    char line[160];
+    int count = 0;
+    while (count < max_entries && fgets(line, sizeof(line), f)) {
+        golden_entry_t *e = &entries[count];
+        if (line[0] != '#' &&
+            sscanf(line, "%31s %" SCNx32 " %" SCNu32 " %" SCNu32 " %" SCNu32, e->name, &e->hash,
+                   &e->metrics.transactions, &e->metrics.bytes, &e->metrics.pixels) == 5) {
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+static const golden_entry_t *find_golden(const golden_entry_t *entries, int count, const char *name)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static double percent_change(uint32_t before, uint32_t after)
+{
+    return before ? (after - (double)before) * 100.0 / before : 0.0;
+}
+
+int sim_golden_run(const char *mode, const char *golden_path, const char *frame_dir)
+{
+    bool update = strcmp(mode, "update") == 0;
+    golden_entry_t golden[GOLDEN_MAX_SCREENS];
+    int golden_count = load_golden(golden_path, golden, GOLDEN_MAX_SCREENS);
+    if (!update && golden_count < 0) {
+        ESP_LOGE(TAG, "Cannot read %s (run with SIM_GOLDEN=update to create it)", golden_path);
+        return 1;
+    }
+    
+    int screen_count = sizeof(golden_screens) / sizeof(golden_screens[0]);
+    golden_entry_t current[GOLDEN_MAX_SCREENS];
+    int failures = 0;
+    
+    ESP_LOGI(TAG, "%-16s %-10s %12s %12s %10s %9s  %s", "screen", "hash", "spi_txns", "spi_bytes", "pixels",
+             "draw_ms", "result");
+    
+    for (int i = 0; i < screen_count; i++) {
+        golden_entry_t *entry = &current[i];
+        strncpy(entry->name, golden_screens[i].name, sizeof(entry->name) - 1);
+        entry->name[sizeof(entry->name) - 1] = '\0';
+        
+        compass_display_reset_metrics();
+        int64_t start_us = esp_timer_get_time();
+        golden_screens[i].draw();
+        int64_t draw_us = esp_timer_get_time() - start_us;
+        compass_display_get_metrics(&entry->metrics);
+        entry->hash = compass_display_frame_hash();
+        
+        char path[256];
+        snprintf(path, sizeof(path), "%s/golden_%s.ppm", frame_dir, entry->name);
+        compass_display_save_frame(path);
+        
+        const golden_entry_t *expected = golden_count > 0 ? find_golden(golden, golden_count, entry->name) : NULL;
+        const char *result = "new";
+        if (expected && expected->hash == entry->hash) {
+            result = "match";
+        } else if (expected) {
+            result = update ? "updated" : "MISMATCH";
+            if (!update) failures++;
+        } else if (!update) {
+            failures++;
+        }
+        
+        ESP_LOGI(TAG, "%-16s %08" PRIx32 " %12" PRIu32 " %12" PRIu32 " %10" PRIu32 " %9.2f  %s", entry->name,
+                 entry->hash, entry->metrics.transactions, entry->metrics.bytes, entry->metrics.pixels,
+                 draw_us / 1000.0, result);
+        
+        // Cost drift against the recorded baseline, e.g. after batching work
+        if (expected && expected->metrics.transactions != entry->metrics.transactions) {
+            ESP_LOGI(TAG, "%-16s spi_txns %+.1f%%, spi_bytes %+.1f%% vs golden", "",
+                     percent_change(expected->metrics.transactions, entry->metrics.transactions),
+                     percent_change(expected->metrics.bytes, entry->metrics.bytes));
+        }
+    }
+    
+    if (update) {
+        FILE *f = fopen(golden_path, "w");
+        if (!f) {
+            ESP_LOGE(TAG, "Cannot write %s", golden_path);
+            return 1;
+        }
+        fprintf(f, "# Golden frames for the compass_display screens (sim/main/sim_golden.cpp)\n");
+        fprintf(f, "# screen hash spi_transactions spi_bytes pixels\n");
+        for (int i = 0; i < screen_count; i++) {
+            fprintf(f, "%s %08" PRIx32 " %" PRIu32 " %" PRIu32 " %" PRIu32 "\n", current[i].name, current[i].hash,
+                    current[i].metrics.transactions, current[i].metrics.bytes, current[i].metrics.pixels);
+        }
+        fclose(f);
+        ESP_LOGI(TAG, "Wrote %d screens to %s", screen_count, golden_path);
+        return 0;
+    }
+    
+    if (failures) {
+        ESP_LOGE(TAG, "%d of %d screens differ from %s; frames are in %s", failures, screen_count, golden_path,
+                 frame_dir);
+        return 1;
+    }
+    ESP_LOGI(TAG, "All %d screens match %s", screen_count, golden_path);
+    return 0;
+}
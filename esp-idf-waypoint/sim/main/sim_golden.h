@@ -0,0 +1,14 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Renders every screen from fixed data and compares the frames against the
+// golden file ("check") or rewrites it ("update"). Each frame is also saved
+// to frame_dir. Returns the process exit code (0 = all screens match).
+int sim_golden_run(const char *mode, const char *golden_path, const char *frame_dir);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+// Component includes
+#include "compass_display.h"
+#include "gps_handler.h"
+#include "network_manager.h"
+#include "radio_scheduler.h"
+#include "navigation_calc.h"
+#include "touch_controller.h"
+#include "trace.h"
+#include "binlog.h"
+#include "energy_account.h"
+#include "compass_app.h"
+#include "sim_golden.h"
+
+static const char *TAG = "WAYPOINT_SIM";
+
+// Defaults when the environment doesn't say otherwise
+#define DEFAULT_BACKEND_URL       "http://localhost:3000"
+#define DEFAULT_FRAME_DIR         "sim-frames"
+#define DEFAULT_FRAME_INTERVAL_S  60
+#define DEFAULT_GOLDEN_FILE       "golden/screens.txt"
+
+// The app loop polls this often (wall time) so no replayed fix is missed
+#define SIM_POLL_MS 5
+
+// Count, total and worst case of one measured step
+typedef struct {
+    uint32_t count;
+    int64_t total_us;
+    int64_t max_us;
+} sim_timing_t;
+
+// Global State
+static app_state_t current_state = STATE_MENU;
+static gps_data_t current_gps = {0};
+static target_data_t current_target = {0};
+static compass_data_t compass_data = {0};
+static safety_data_t safety_data = {0};
+static sidequest_data_t sidequest_data = {0};
+
+static const char *frame_dir = DEFAULT_FRAME_DIR;
+static uint32_t frame_interval_ms = DEFAULT_FRAME_INTERVAL_S * 1000;
+static uint32_t frames_saved = 0;
+
+static sim_timing_t draw_timing = {};
+static sim_timing_t submit_timing = {};
+static sim_timing_t touch_timing = {};
+static uint32_t fixes_seen = 0;
+
+// Function prototypes
+static void sim_task(void *pvParameters);
+static void handle_touch_event(touch_event_t touch_event);
+static void update_compass_display(void);
+static void save_frame(uint32_t sim_ms, const char *reason);
+static void timing_add(sim_timing_t *timing, int64_t start_us);
+static void log_timing(const char *label, const sim_timing_t *timing);
+static void log_summary(uint32_t sim_ms, int64_t wall_us);
+
+extern "C" void app_main(void)
+{
+    const char *backend_url = getenv("BACKEND_URL");
+    if (!backend_url) backend_url = DEFAULT_BACKEND_URL;
+    if (getenv("SIM_FRAME_DIR")) frame_dir = getenv("SIM_FRAME_DIR");
+    if (getenv("SIM_FRAME_INTERVAL_S")) frame_interval_ms = atoi(getenv("SIM_FRAME_INTERVAL_S")) * 1000;
+    mkdir(frame_dir, 0755);
+    
+    // Golden-image mode: render every screen from fixtures and exit
+    const char *golden_mode = getenv("SIM_GOLDEN");
+    if (golden_mode) {
+        const char *golden_file = getenv("SIM_GOLDEN_FILE");
+        compass_display_init();
+        exit(sim_golden_run(golden_mode, golden_file ? golden_file : DEFAULT_GOLDEN_FILE, frame_dir));
+    }
+    
+    ESP_LOGI(TAG, "Initializing simulated peripherals...");
+    binlog_init();
+    // The firmware's model. Host CPU time says nothing about the chip's, so
+    // the CPU rails stay empty; the radio, BLE, panel and backlight rails
+    // follow the replayed hike.
+    energy_account_init(&compass_app_energy_model);
+    // Duty rails run on the replay's accelerated clock, like fix timestamps
+    if (getenv("SIM_TIME_SCALE")) energy_account_set_time_scale(atof(getenv("SIM_TIME_SCALE")));
+    compass_display_init();
+    touch_controller_init();
+    gps_handler_init();
+    
+    ESP_LOGI(TAG, "Backend: %s", backend_url);
+    network_manager_init(backend_url);
+    network_manager_sidequest_prefetch_start(SIDEQUEST_PREFETCH_DEFAULT_DISTANCE_M);
+    // Host networking is always up
+    radio_scheduler_set_link(true);
+    
+    compass_display_show_startup();
+    save_frame(0, "startup");
+    
+    xTaskCreate(sim_task, "sim_main", 8192, NULL, 5, NULL);
+}
+
+// The firmware's app_main_task loop, driven by the replay instead of events.
+// Ends when the GPS replay runs out (or after SIM_DURATION_S of sim time).
+static void sim_task(void *pvParameters)
+{
+    const char *duration_env = getenv("SIM_DURATION_S");
+    uint32_t duration_ms = duration_env ? atoi(duration_env) * 1000 : 0;
+    int64_t wall_start_us = esp_timer_get_time();
+    uint32_t last_fix_ms = 0;
+    uint32_t last_frame_ms = 0;
+    bool replay_started = false;
+    touch_event_t touch_event;
+    
+    compass_display_draw_menu();
+    current_state = STATE_MENU;
+    
+    while (1) {
+        current_gps = gps_handler_get_data();
+        uint32_t sim_ms = current_gps.timestamp;
+        
+        if (current_gps.valid && current_gps.timestamp != last_fix_ms) {
+            last_fix_ms = current_gps.timestamp;
+            fixes_seen++;
+            replay_started = true;
+            
+            network_manager_sidequest_prefetch_update(&current_gps);
+            
+            int64_t start_us = esp_timer_get_time();
+            network_manager_submit_gps_fix(&current_gps);
+            timing_add(&submit_timing, start_us);
+            
+            if (current_state == STATE_POINTING && current_target.active) {
+                update_compass_display();
+            }
+        }
+        
+        while (touch_controller_get_event(&touch_event)) {
+            if (!touch_event.pressed) continue;
+            int64_t start_us = esp_timer_get_time();
+            handle_touch_event(touch_event);
+            timing_add(&touch_timing, start_us);
+            save_frame(sim_ms, "touch");
+        }
+        
+        if (sim_ms - last_frame_ms >= frame_interval_ms) {
+            last_frame_ms = sim_ms;
+            save_frame(sim_ms, "periodic");
+        }
+        
+        bool replay_done = replay_started && !gps_handler_is_connected();
+        if (replay_done || (duration_ms && sim_ms >= duration_ms)) {
+            log_summary(sim_ms, esp_timer_get_time() - wall_start_us);
+            exit(0);
+        }
+        
+        vTaskDelay(pdMS_TO_TICKS(SIM_POLL_MS));
+    }
+}
+
+// The firmware's touch handling (compass_app_touch_action), with the
+// backend calls made inline since the replay has no network task
+static void handle_touch_event(touch_event_t touch_event)
+{
+    int y = touch_event.y;
+    
+    ESP_LOGI(TAG, "Touch event at (%d, %d) in state %d", touch_event.x, y, current_state);
+    
+    switch (compass_app_touch_action(current_state, y, sidequest_data.active)) {
+        case APP_TOUCH_SAVE_LOCATION:
+            network_manager_save_location(&current_gps);
+            break;
+        
+        case APP_TOUCH_NAVIGATE:
+            network_manager_select_target_location(&current_target);
+            if (current_target.active) {
+                current_state = STATE_POINTING;
+                update_compass_display();
+            }
+            break;
+        
+        case APP_TOUCH_SAFETY:
+            current_state = STATE_SAFETY_WARNING;
+            network_manager_check_location_safety(&current_gps, &safety_data);
+            compass_display_draw_safety(&safety_data);
+            break;
+        
+        case APP_TOUCH_SIDEQUEST:
+            current_state = STATE_SIDEQUEST;
+            if (!sidequest_data.active &&
+                !network_manager_sidequest_prefetch_take(&current_gps, &sidequest_data)) {
+                network_manager_generate_sidequest(&current_gps, &sidequest_data);
+            }
+            compass_display_draw_sidequest(&sidequest_data);
+            break;
+        
+        case APP_TOUCH_SIDEQUEST_GO:
+            strcpy(current_target.name, sidequest_data.title);
+            current_target.latitude = sidequest_data.target_lat;
+            current_target.longitude = sidequest_data.target_lng;
+            current_target.active = true;
+            current_state = STATE_POINTING;
+            update_compass_display();
+            break;
+        
+        case APP_TOUCH_SIDEQUEST_RETRY:
+            network_manager_generate_sidequest(&current_gps, &sidequest_data);
+            compass_display_draw_sidequest(&sidequest_data);
+            break;
+        
+        case APP_TOUCH_BACK:
+            if (current_state == STATE_POINTING) {
+                current_target.active = false;
+            }
+            current_state = STATE_MENU;
+            compass_display_draw_menu();
+            break;
+        
+        case APP_TOUCH_TITLE:
+        case APP_TOUCH_NONE:
+            // No diagnostics page without telemetry
+            break;
+    }
+}
+
+static void update_compass_display(void)
+{
+    if (!current_gps.valid || !current_target.active) return;
+    
+    int64_t start_us = esp_timer_get_time();
+    compass_data.bearing = navigation_calc_bearing(current_gps.latitude, current_gps.longitude,
+                                                  current_target.latitude, current_target.longitude);
+    compass_data.distance = navigation_calc_distance(current_gps.latitude, current_gps.longitude,
+                                                    current_target.latitude, current_target.longitude);
+    compass_display_draw_compass(&compass_data, &current_target);
+    timing_add(&draw_timing, start_us);
+}
+
+static void save_frame(uint32_t sim_ms, const char *reason)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/frame_%07lu_%s.ppm", frame_dir, (unsigned long)(sim_ms / 1000), reason);
+    if (compass_display_save_frame(path)) {
+        frames_saved++;
+    }
+}
+
+static void timing_add(sim_timing_t *timing, int64_t start_us)
+{
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    timing->count++;
+    timing->total_us += elapsed_us;
+    if (elapsed_us > timing->max_us) {
+        timing->max_us = elapsed_us;
+    }
+}
+
+static void log_timing(const char *label, const sim_timing_t *timing)
+{
+    ESP_LOGI(TAG, "  %-14s n=%-6lu avg=%7.2f ms  max=%7.2f ms", label, (unsigned long)timing->count,
+             timing->count ? timing->total_us / 1000.0 / timing->count : 0.0, timing->max_us / 1000.0);
+}
+
+static void log_summary(uint32_t sim_ms, int64_t wall_us)
+{
+    gps_upload_stats_t uploads;
+    network_manager_get_gps_upload_stats(&uploads);
+    
+    ESP_LOGI(TAG, "Simulation finished: %.1f min simulated in %.1f s (%.0fx)",
+             sim_ms / 60000.0, wall_us / 1e6, wall_us > 0 ? sim_ms * 1000.0 / wall_us : 0.0);
+    ESP_LOGI(TAG, "  fixes %lu, uploads sent %lu, suppressed %lu, coalesced %lu, rejected %lu, failed %lu, skipped %lu, frames %lu",
+             (unsigned long)fixes_seen, (unsigned long)uploads.sent, (unsigned long)uploads.suppressed,
+             (unsigned long)uploads.coalesced, (unsigned long)uploads.rejected, (unsigned long)uploads.failed,
+             (unsigned long)uploads.skipped, (unsigned long)frames_saved);
+    log_timing("compass draw", &draw_timing);
+    log_timing("gps submit", &submit_timing);
+    log_timing("touch handler", &touch_timing);
+    network_manager_log_diagnostics();
+    radio_scheduler_log_stats();
+    energy_account_log();
+    
+    // SIM_TRACE=1: print the event trace for trace-to-chrome.js
+    if (getenv("SIM_TRACE")) {
+        trace_dump();
+    }
+}
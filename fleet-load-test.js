@@ -0,0 +1,342 @@
+// Fleet load generator
+// Simulates many compass devices against a local backend, issuing the same
+// requests network_manager.cpp makes: governed GPS uploads, location saves,
+// location list fetches, safety checks, sidequest generation and idle /health
+// probes. Each device walks its own trace and, like the firmware (one
+// http_mutex), never has more than one request in flight.
+//
+// Usage: node fleet-load-test.js
+//        DEVICES=2000 DURATION_S=300 BASE_URL=http://localhost:3000 node fleet-load-test.js
+// Start the server with a high RATE_LIMIT_MAX_REQUESTS; the whole fleet shares
+// one IP and the default /api limit is 100 requests per 15 minutes.
+
+const http = require('http');
+const https = require('https');
+const zlib = require('zlib');
+
+const config = {
+  baseUrl: process.env.BASE_URL || 'http://localhost:3000',
+  devices: parseInt(process.env.DEVICES) || 1000,
+  durationS: parseInt(process.env.DURATION_S) || 60,
+  rampS: parseInt(process.env.RAMP_S) || 10,             // devices start spread over this window
+  fixIntervalMs: parseInt(process.env.FIX_INTERVAL_MS) || 1000, // GPS fix rate fed to the governor
+  keepAlive: process.env.KEEP_ALIVE === '1',             // firmware opens a new connection per request
+  // Per-device user actions per hour
+  savesPerHour: parseFloat(process.env.SAVES_PER_HOUR) || 2,
+  targetsPerHour: parseFloat(process.env.TARGETS_PER_HOUR) || 4,
+  safetyPerHour: parseFloat(process.env.SAFETY_PER_HOUR) || 6,
+  sidequestsPerHour: parseFloat(process.env.SIDEQUESTS_PER_HOUR) || 2,
+  // Movement traces
+  originLat: parseFloat(process.env.ORIGIN_LAT) || 37.7749,
+  originLng: parseFloat(process.env.ORIGIN_LNG) || -122.4194,
+  spreadM: parseFloat(process.env.SPREAD_M) || 5000,
+  stoppedFraction: 0.3                                    // share of time spent standing still
+};
+
+// Mirrors GPS_UPLOAD_POLICY_DEFAULT and the health/timeout settings in network_manager
+const UPLOAD_POLICY = { minDistanceM: 15, accuracyScale: 5, headingChangeDeg: 30, heartbeatMs: 60000, maxSpeedMps: 50 };
+const HEALTH_IDLE_PROBE_MS = 120000;
+const ENDPOINT_TIMEOUT_MS = {
+  health: 5000,
+  gps: 10000,
+  location_save: 10000,
+  location_list: 10000,
+  safety: 15000,
+  sidequest: 15000
+};
+
+const EARTH_RADIUS_M = 6371000;
+const baseUrl = new URL(config.baseUrl);
+const transport = baseUrl.protocol === 'https:' ? https : http;
+const agent = new transport.Agent({ keepAlive: config.keepAlive, maxSockets: Infinity });
+
+const toRad = (deg) => deg * Math.PI / 180;
+
+function distanceM(lat1, lng1, lat2, lng2) {
+  const dLat = toRad(lat2 - lat1);
+  const dLng = toRad(lng2 - lng1);
+  const a = Math.sin(dLat / 2) ** 2 + Math.cos(toRad(lat1)) * Math.cos(toRad(lat2)) * Math.sin(dLng / 2) ** 2;
+  return 2 * EARTH_RADIUS_M * Math.atan2(Math.sqrt(a), Math.sqrt(1 - a));
+}
+
+function bearingDeg(lat1, lng1, lat2, lng2) {
+  const y = Math.sin(toRad(lng2 - lng1)) * Math.cos(toRad(lat2));
+  const x = Math.cos(toRad(lat1)) * Math.sin(toRad(lat2)) -
+            Math.sin(toRad(lat1)) * Math.cos(toRad(lat2)) * Math.cos(toRad(lng2 - lng1));
+  return (Math.atan2(y, x) * 180 / Math.PI + 360) % 360;
+}
+
+// Exponentially distributed delay for an event rate given per hour
+function nextEventMs(perHour) {
+  return perHour > 0 ? -Math.log(1 - Math.random()) * 3600000 / perHour : Infinity;
+}
+
+// ---- Statistics ----
+
+const stats = {};
+
+function record(endpoint, latencyMs, status, bytesOut, bytesIn) {
+  if (!stats[endpoint]) {
+    stats[endpoint] = { latencies: [], statuses: {}, errors: 0, bytesOut: 0, bytesIn: 0 };
+  }
+  const s = stats[endpoint];
+  s.latencies.push(latencyMs);
+  s.bytesOut += bytesOut;
+  s.bytesIn += bytesIn;
+  if (status) {
+    s.statuses[status] = (s.statuses[status] || 0) + 1;
+  } else {
+    s.errors++;
+  }
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return 0;
+  return sorted[Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1)];
+}
+
+function report(elapsedS) {
+  console.log(`\n📊 ${config.devices} devices, ${elapsedS.toFixed(0)}s`);
+  console.log('   endpoint        reqs   req/s    p50    p90    p99    max  kB out   kB in  errors  statuses');
+  let total = 0;
+  Object.keys(ENDPOINT_TIMEOUT_MS).forEach(endpoint => {
+    const s = stats[endpoint];
+    if (!s) return;
+    const sorted = Float64Array.from(s.latencies).sort();
+    total += sorted.length;
+    const statuses = Object.entries(s.statuses).map(([code, n]) => `${code}:${n}`).join(' ');
+    console.log(`   ${endpoint.padEnd(14)} ${String(sorted.length).padStart(5)} ` +
+                `${(sorted.length / elapsedS).toFixed(1).padStart(7)} ` +
+                [50, 90, 99].map(p => percentile(sorted, p).toFixed(0).padStart(6)).join(' ') +
+                ` ${sorted[sorted.length - 1].toFixed(0).padStart(6)}` +
+                ` ${(s.bytesOut / 1024).toFixed(0).padStart(7)} ${(s.bytesIn / 1024).toFixed(0).padStart(7)}` +
+                ` ${String(s.errors).padStart(7)}  ${statuses}`);
+  });
+  console.log(`   total          ${String(total).padStart(5)} ${(total / elapsedS).toFixed(1).padStart(7)} req/s`);
+}
+
+// ---- HTTP, shaped like http_attempt() ----
+
+function request(endpoint, method, path, body) {
+  return new Promise((resolve) => {
+    const payload = body ? Buffer.from(JSON.stringify(body)) : null;
+    const headers = { 'Accept-Encoding': 'gzip' };
+    if (payload) {
+      headers['Content-Type'] = 'application/json';
+      headers['Content-Length'] = payload.length;
+    }
+
+    const started = process.hrtime.bigint();
+    let bytesIn = 0;
+    const done = (status, data) => {
+      const latencyMs = Number(process.hrtime.bigint() - started) / 1e6;
+      record(endpoint, latencyMs, status, payload ? payload.length : 0, bytesIn);
+      resolve({ status, data });
+    };
+
+    const req = transport.request({
+      hostname: baseUrl.hostname,
+      port: baseUrl.port,
+      path,
+      method,
+      headers,
+      agent,
+      timeout: ENDPOINT_TIMEOUT_MS[endpoint]
+    }, (res) => {
+      const chunks = [];
+      res.on('data', chunk => {
+        bytesIn += chunk.length;
+        chunks.push(chunk);
+      });
+      res.on('end', () => {
+        let data = Buffer.concat(chunks);
+        if (res.headers['content-encoding'] === 'gzip') {
+          try {
+            data = zlib.gunzipSync(data);
+          } catch (error) {
+            return done(0, null);
+          }
+        }
+        let json = null;
+        try {
+          json = JSON.parse(data.toString('utf8'));
+        } catch (error) {
+          // not JSON, status still counts
+        }
+        done(res.statusCode, json);
+      });
+    });
+
+    req.on('timeout', () => req.destroy(new Error('timeout')));
+    req.on('error', () => done(0, null));
+    if (payload) req.write(payload);
+    req.end();
+  });
+}
+
+// ---- Simulated device ----
+
+class Device {
+  constructor(index, startAt) {
+    const angle = Math.random() * 2 * Math.PI;
+    const radius = Math.sqrt(Math.random()) * config.spreadM;
+    this.id = `fleet-${String(index).padStart(5, '0')}`;
+    this.lat = config.originLat + (radius * Math.cos(angle)) / 111320;
+    this.lng = config.originLng + (radius * Math.sin(angle)) / (111320 * Math.cos(toRad(config.originLat)));
+    this.heading = Math.random() * 360;
+    this.speedMps = 1.1 + Math.random() * 0.6;
+    this.moving = Math.random() > config.stoppedFraction;
+    this.busy = false;
+    this.queue = [];
+    this.startAt = startAt;
+    this.nextFixAt = startAt;
+    this.lastSent = null;       // { lat, lng, time, heading }
+    this.lastTrafficAt = startAt;
+    const now = startAt;
+    this.nextSaveAt = now + nextEventMs(config.savesPerHour);
+    this.nextTargetAt = now + nextEventMs(config.targetsPerHour);
+    this.nextSafetyAt = now + nextEventMs(config.safetyPerHour);
+    this.nextSidequestAt = now + nextEventMs(config.sidequestsPerHour);
+  }
+
+  // Advance the walk by one fix interval
+  move(dtS) {
+    if (Math.random() < dtS / 120) {
+      // Switch between walking and standing roughly every two minutes
+      this.moving = Math.random() > config.stoppedFraction;
+    }
+    if (!this.moving) return;
+
+    this.heading = (this.heading + (Math.random() - 0.5) * 20 + 360) % 360;
+    const d = this.speedMps * dtS;
+    this.lat += (d * Math.cos(toRad(this.heading))) / 111320;
+    this.lng += (d * Math.sin(toRad(this.heading))) / (111320 * Math.cos(toRad(this.lat)));
+  }
+
+  fix() {
+    // HDOP-style accuracy as reported by the BLE GPS source
+    return { latitude: this.lat, longitude: this.lng, altitude: 15 + Math.random() * 5, accuracy: 1 + Math.random() * 2 };
+  }
+
+  // Same decisions as network_manager_submit_gps_fix()
+  shouldUpload(fix, now) {
+    if (!this.lastSent) return true;
+    const moved = distanceM(this.lastSent.lat, this.lastSent.lng, fix.latitude, fix.longitude);
+    const threshold = Math.max(UPLOAD_POLICY.minDistanceM, fix.accuracy * UPLOAD_POLICY.accuracyScale);
+    if (moved > threshold) return true;
+    if (now - this.lastSent.time >= UPLOAD_POLICY.heartbeatMs) return true;
+    if (moved > UPLOAD_POLICY.minDistanceM / 2 && this.lastSent.heading !== null) {
+      const heading = bearingDeg(this.lastSent.lat, this.lastSent.lng, fix.latitude, fix.longitude);
+      const turn = Math.abs(((heading - this.lastSent.heading + 540) % 360) - 180);
+      if (turn > UPLOAD_POLICY.headingChangeDeg) return true;
+    }
+    return false;
+  }
+
+  tick(now) {
+    if (now < this.startAt) return;
+
+    if (now >= this.nextFixAt) {
+      this.move(config.fixIntervalMs / 1000);
+      this.nextFixAt = now + config.fixIntervalMs;
+
+      const fix = this.fix();
+      if (this.shouldUpload(fix, now)) {
+        const heading = this.lastSent
+          ? bearingDeg(this.lastSent.lat, this.lastSent.lng, fix.latitude, fix.longitude) : null;
+        this.lastSent = { lat: fix.latitude, lng: fix.longitude, time: now, heading };
+        this.enqueue(() => request('gps', 'POST', '/api/gps', { ...fix, source: 'ble', deviceId: this.id }));
+      }
+    }
+
+    if (now >= this.nextSaveAt) {
+      this.nextSaveAt = now + nextEventMs(config.savesPerHour);
+      const fix = this.fix();
+      this.enqueue(() => request('location_save', 'POST', '/api/locations', {
+        name: `ESP32 Waypoint ${now % 100000000}`,
+        description: 'Saved from WaypointCompass ESP32 device',
+        latitude: fix.latitude,
+        longitude: fix.longitude,
+        category: 'waypoint',
+        source: 'esp32',
+        deviceId: this.id
+      }));
+    }
+
+    if (now >= this.nextTargetAt) {
+      this.nextTargetAt = now + nextEventMs(config.targetsPerHour);
+      this.enqueue(() => request('location_list', 'GET', '/api/locations'));
+    }
+
+    if (now >= this.nextSafetyAt) {
+      this.nextSafetyAt = now + nextEventMs(config.safetyPerHour);
+      this.enqueue(() => request('safety', 'GET',
+        `/api/safety/analyze-location?lat=${this.lat.toFixed(6)}&lng=${this.lng.toFixed(6)}`));
+    }
+
+    if (now >= this.nextSidequestAt) {
+      this.nextSidequestAt = now + nextEventMs(config.sidequestsPerHour);
+      this.enqueue(() => request('sidequest', 'POST',
+        `/api/sidequest/start?lat=${this.lat.toFixed(6)}&lng=${this.lng.toFixed(6)}`));
+    }
+
+    // Passive health: only probe after a quiet period
+    if (!this.busy && this.queue.length === 0 && now - this.lastTrafficAt >= HEALTH_IDLE_PROBE_MS) {
+      this.enqueue(() => request('health', 'GET', '/health'));
+    }
+  }
+
+  enqueue(fn) {
+    this.queue.push(fn);
+    this.drain();
+  }
+
+  async drain() {
+    if (this.busy) return;
+    this.busy = true;
+    while (this.queue.length > 0) {
+      await this.queue.shift()();
+      this.lastTrafficAt = Date.now();
+    }
+    this.busy = false;
+  }
+}
+
+async function fleetLoadTest() {
+  console.log('🚚 Fleet load test');
+  console.log(`   ${config.devices} devices against ${config.baseUrl} for ${config.durationS}s ` +
+              `(ramp ${config.rampS}s, keep-alive ${config.keepAlive ? 'on' : 'off'})`);
+
+  const started = Date.now();
+  const devices = [];
+  for (let i = 0; i < config.devices; i++) {
+    devices.push(new Device(i, started + (i / config.devices) * config.rampS * 1000));
+  }
+
+  const ticker = setInterval(() => {
+    const now = Date.now();
+    for (const device of devices) {
+      device.tick(now);
+    }
+  }, 50);
+
+  const progress = setInterval(() => report((Date.now() - started) / 1000), 10000);
+
+  await new Promise(resolve => setTimeout(resolve, config.durationS * 1000));
+  clearInterval(ticker);
+  clearInterval(progress);
+
+  // Let in-flight requests finish
+  const drainDeadline = Date.now() + 15000;
+  while (devices.some(device => device.busy) && Date.now() < drainDeadline) {
+    await new Promise(resolve => setTimeout(resolve, 100));
+  }
+
+  report((Date.now() - started) / 1000);
+  agent.destroy();
+}
+
+fleetLoadTest().catch(error => {
+  console.error('❌ Fleet load test failed:', error);
+  process.exit(1);
+});
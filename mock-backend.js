@@ -0,0 +1,284 @@
+// Mock backend for firmware network testing
+// A stand-in for the Railway deployment that returns the JSON shapes
+// network_manager.cpp parses, with scriptable latency and faults: truncated
+// bodies, oversized payloads (over the firmware's 4 KB response buffer),
+// connection resets, stalls and 5xx bursts. A seeded PRNG makes every run
+// with the same scenario and request sequence behave identically.
+//
+// Usage: node mock-backend.js                                 (clean, port 3000)
+//        node mock-backend.js mock-scenarios/hotspot.json     (scenario file)
+//        PORT=3100 SEED=7 node mock-backend.js mock-scenarios/outage.json
+// Point BACKEND_URL in the firmware (or the linux build) at http://<host>:<port>.
+
+const http = require('http');
+const fs = require('fs');
+const zlib = require('zlib');
+
+const scenarioPath = process.argv[2];
+const scenario = scenarioPath ? JSON.parse(fs.readFileSync(scenarioPath, 'utf8')) : {};
+const PORT = parseInt(process.env.PORT) || scenario.port || 3000;
+const SEED = parseInt(process.env.SEED) || scenario.seed || 1;
+
+// ---- Deterministic randomness (mulberry32) ----
+
+let rngState = SEED >>> 0;
+function random() {
+  rngState = (rngState + 0x6D2B79F5) >>> 0;
+  let t = rngState;
+  t = Math.imul(t ^ (t >>> 15), t | 1);
+  t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+  return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+}
+
+function gaussian() {
+  const u = 1 - random();
+  const v = random();
+  return Math.sqrt(-2 * Math.log(u)) * Math.cos(2 * Math.PI * v);
+}
+
+// Latency distributions: fixed, uniform, normal, lognormal, pareto
+function sampleLatency(spec) {
+  if (!spec) return 0;
+  let ms;
+  switch (spec.dist) {
+    case 'fixed':
+      ms = spec.ms;
+      break;
+    case 'uniform':
+      ms = spec.minMs + random() * (spec.maxMs - spec.minMs);
+      break;
+    case 'normal':
+      ms = spec.meanMs + gaussian() * spec.stddevMs;
+      break;
+    case 'lognormal':
+      ms = spec.medianMs * Math.exp(gaussian() * spec.sigma);
+      break;
+    case 'pareto':
+      // Heavy tail: most requests near minMs, a few far beyond
+      ms = spec.minMs / Math.pow(1 - random(), 1 / spec.alpha);
+      break;
+    default:
+      ms = 0;
+  }
+  return Math.max(0, Math.min(ms, spec.capMs || 120000));
+}
+
+// ---- Canned responses in the shapes the firmware parses ----
+
+const savedLocations = [
+  { _id: '64f000000000000000000001', name: 'Trailhead Parking', latitude: 37.7749, longitude: -122.4194, category: 'waypoint', type: 'saved' },
+  { _id: '64f000000000000000000002', name: 'Summit Lookout', latitude: 37.7849, longitude: -122.4094, category: 'waypoint', type: 'saved' }
+];
+let nextLocationId = 3;
+
+const routes = {
+  'GET /health': () => ({
+    status: 200,
+    body: { status: 'healthy', timestamp: new Date().toISOString(), uptime: process.uptime(), environment: 'mock' }
+  }),
+
+  'POST /api/gps': (req) => ({
+    status: 201,
+    body: {
+      success: true,
+      message: 'GPS location updated successfully',
+      data: { ...pick(req.json, ['latitude', 'longitude', 'altitude', 'accuracy']), timestamp: new Date().toISOString(), source: 'ble' }
+    }
+  }),
+
+  'GET /api/locations': () => ({
+    status: 200,
+    body: { success: true, data: savedLocations, count: savedLocations.length }
+  }),
+
+  'POST /api/locations': (req) => {
+    const location = {
+      _id: `64f0000000000000000${String(nextLocationId++).padStart(5, '0')}`,
+      name: (req.json && req.json.name) || 'Unnamed',
+      latitude: req.json && req.json.latitude,
+      longitude: req.json && req.json.longitude,
+      category: 'waypoint',
+      type: 'saved'
+    };
+    savedLocations.push(location);
+    return { status: 201, body: { success: true, message: `Location "${location.name}" saved`, data: location } };
+  },
+
+  'GET /api/safety/analyze-location': (req) => ({
+    status: 200,
+    body: {
+      success: true,
+      data: {
+        riskScore: Math.round(random() * 40) / 10,
+        timeRisk: 'low',
+        warnings: 'Mock safety warning',
+        hazards: 'None reported',
+        emergencyServices: { nearby: true },
+        location: { latitude: parseFloat(req.query.get('lat')), longitude: parseFloat(req.query.get('lng')) }
+      },
+      message: 'Location safety analysis completed'
+    }
+  }),
+
+  'POST /api/sidequest/start': (req) => {
+    const lat = parseFloat(req.query.get('lat')) || 37.7749;
+    const lng = parseFloat(req.query.get('lng')) || -122.4194;
+    return {
+      status: 200,
+      body: {
+        success: true,
+        message: 'Mystery adventure started! Follow the compass to discover what awaits...',
+        data: {
+          title: 'Mystery Adventure',
+          description: 'Destination unknown - follow your compass!',
+          difficulty: 'moderate',
+          location: { name: 'Mystery Location', latitude: lat + 0.004, longitude: lng + 0.003 },
+          type: 'sidequest',
+          message: 'Destination unknown - follow your compass!',
+          estimatedDistance: '300-800 meters away',
+          safetyMessage: 'Have a safe adventure!'
+        }
+      }
+    };
+  }
+};
+
+function pick(obj, keys) {
+  const out = {};
+  keys.forEach(key => {
+    if (obj && obj[key] !== undefined) out[key] = obj[key];
+  });
+  return out;
+}
+
+// ---- Faults ----
+// Each route (or "defaults") may list faults; the first one that triggers wins:
+//   { "type": "reset", "probability": 0.05 }                   close the socket without a response
+//   { "type": "stall", "probability": 0.02, "ms": 30000 }      send nothing for ms, then reset
+//   { "type": "truncate", "probability": 0.05, "fraction": 0.5 }  promise the full body, send part of it
+//   { "type": "oversize", "probability": 0.1, "bytes": 6000 }  pad the JSON body past the 4 KB buffer
+//   { "type": "status", "probability": 0.05, "status": 500 }   plain error response
+//   { "type": "burst5xx", "every": 50, "length": 5, "status": 503 }  last `length` of every `every` requests
+
+const requestCounts = {};
+const stats = { requests: 0, faults: {} };
+
+function routeConfig(key) {
+  const defaults = scenario.defaults || {};
+  const route = (scenario.routes && scenario.routes[key]) || {};
+  return {
+    latency: route.latency || defaults.latency,
+    faults: [...(route.faults || []), ...(defaults.faults || [])]
+  };
+}
+
+function chooseFault(faults, count) {
+  for (const fault of faults) {
+    if (fault.type === 'burst5xx') {
+      if (count % fault.every >= fault.every - fault.length) return fault;
+    } else if (random() < (fault.probability || 0)) {
+      return fault;
+    }
+  }
+  return null;
+}
+
+function send(req, res, status, body, fault) {
+  let payload = Buffer.from(JSON.stringify(body));
+
+  if (fault && fault.type === 'oversize') {
+    const padding = Math.max(0, (fault.bytes || 6000) - payload.length);
+    payload = Buffer.from(JSON.stringify({ ...body, padding: 'x'.repeat(padding) }));
+  }
+
+  const headers = { 'Content-Type': 'application/json' };
+  if (/\bgzip\b/.test(req.headers['accept-encoding'] || '') && payload.length >= 256 && !(fault && fault.noGzip)) {
+    payload = zlib.gzipSync(payload);
+    headers['Content-Encoding'] = 'gzip';
+  }
+  headers['Content-Length'] = payload.length;
+
+  res.writeHead(status, headers);
+  if (fault && fault.type === 'truncate') {
+    res.write(payload.subarray(0, Math.floor(payload.length * (fault.fraction || 0.5))));
+    res.socket.destroy();
+    return;
+  }
+  res.end(payload);
+}
+
+function handle(req, res, rawBody) {
+  const url = new URL(req.url, 'http://localhost');
+  const key = `${req.method} ${url.pathname}`;
+  const handler = routes[key];
+  stats.requests++;
+
+  if (!handler) {
+    send(req, res, 404, { error: 'Endpoint not found', path: url.pathname });
+    return;
+  }
+
+  let json = null;
+  if (rawBody.length > 0) {
+    try {
+      const body = req.headers['content-encoding'] === 'deflate' ? zlib.inflateSync(rawBody) : rawBody;
+      json = JSON.parse(body.toString('utf8'));
+    } catch (error) {
+      send(req, res, 400, { success: false, error: 'Invalid JSON body' });
+      return;
+    }
+  }
+
+  const count = requestCounts[key] = (requestCounts[key] || 0) + 1;
+  const { latency, faults } = routeConfig(key);
+  const fault = chooseFault(faults, count - 1);
+  const delayMs = sampleLatency(latency);
+
+  if (fault) {
+    stats.faults[fault.type] = (stats.faults[fault.type] || 0) + 1;
+    if (scenario.verbose) console.log(`💥 ${key} #${count}: ${fault.type}`);
+  }
+
+  setTimeout(() => {
+    if (!fault) {
+      const result = handler({ json, query: url.searchParams });
+      send(req, res, result.status, result.body);
+      return;
+    }
+
+    switch (fault.type) {
+      case 'reset':
+        req.socket.destroy();
+        break;
+      case 'stall':
+        setTimeout(() => req.socket.destroy(), fault.ms || 30000);
+        break;
+      case 'status':
+      case 'burst5xx':
+        send(req, res, fault.status || 503, { success: false, error: 'Injected failure' });
+        break;
+      default: {
+        // truncate / oversize still carry the normal body
+        const result = handler({ json, query: url.searchParams });
+        send(req, res, result.status, result.body, fault);
+      }
+    }
+  }, delayMs);
+}
+
+const server = http.createServer((req, res) => {
+  const chunks = [];
+  req.on('data', chunk => chunks.push(chunk));
+  req.on('end', () => handle(req, res, Buffer.concat(chunks)));
+});
+
+server.listen(PORT, '0.0.0.0', () => {
+  console.log(`🧪 Mock backend on http://0.0.0.0:${PORT} (seed ${SEED})`);
+  console.log(`   Scenario: ${scenarioPath || 'none (no latency, no faults)'}`);
+  console.log(`   Routes: ${Object.keys(routes).join(', ')}`);
+});
+
+process.on('SIGINT', () => {
+  console.log(`\n📊 ${stats.requests} requests, faults: ${JSON.stringify(stats.faults)}`);
+  process.exit(0);
+});
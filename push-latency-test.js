@@ -0,0 +1,158 @@
+// Push vs polling latency test
+// Measures how long a target change made through /api/target/set takes to
+// reach a device over the push channel (/ws/device) compared to a device
+// polling GET /api/target, and how many requests each design costs.
+//
+// Usage: node push-latency-test.js            (server on http://localhost:3000)
+//        BASE_URL=http://host:port ROUNDS=20 POLL_INTERVAL_MS=5000 node push-latency-test.js
+// Note: the /api rate limiter allows 100 requests per 15 minutes by default;
+// raise RATE_LIMIT_MAX_REQUESTS on the server for long runs.
+
+const http = require('http');
+const axios = require('axios');
+const { encodeFrame, decodeFrames } = require('./src/services/pushService');
+
+const BASE_URL = process.env.BASE_URL || 'http://localhost:3000';
+const ROUNDS = parseInt(process.env.ROUNDS) || 10;
+const POLL_INTERVAL_MS = parseInt(process.env.POLL_INTERVAL_MS) || 2000;
+const PING_INTERVAL_MS = 30000; // pushService ping interval
+const TARGETS = ['Push Test A', 'Push Test B'];
+
+const sleep = (ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+function percentile(values, p) {
+  if (values.length === 0) return NaN;
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1)];
+}
+
+function summarize(label, values) {
+  const mean = values.reduce((sum, v) => sum + v, 0) / (values.length || 1);
+  console.log(`   ${label.padEnd(8)} n=${values.length}  mean=${mean.toFixed(0)}ms  ` +
+              `p50=${percentile(values, 50)}ms  p95=${percentile(values, 95)}ms  max=${Math.max(...values)}ms`);
+}
+
+// Opens /ws/device and calls onMessage for every pushed JSON message
+function connectPush(deviceId, onMessage) {
+  return new Promise((resolve, reject) => {
+    const url = new URL(`/ws/device?deviceId=${deviceId}`, BASE_URL);
+    const req = http.request({
+      hostname: url.hostname,
+      port: url.port,
+      path: url.pathname + url.search,
+      headers: {
+        Connection: 'Upgrade',
+        Upgrade: 'websocket',
+        'Sec-WebSocket-Version': '13',
+        'Sec-WebSocket-Key': Buffer.from(String(Math.random())).toString('base64')
+      }
+    });
+
+    req.on('upgrade', (res, socket, head) => {
+      let buffer = head;
+      socket.on('data', (chunk) => {
+        buffer = Buffer.concat([buffer, chunk]);
+        const decoded = decodeFrames(buffer);
+        buffer = decoded.rest;
+        decoded.frames.forEach(frame => {
+          if (frame.opcode === 0x9) {
+            socket.write(encodeFrame(0xA, frame.payload, true));
+          } else if (frame.opcode === 0x1) {
+            onMessage(JSON.parse(frame.payload.toString('utf8')));
+          }
+        });
+      });
+      resolve(socket);
+    });
+    req.on('response', (res) => reject(new Error(`Upgrade refused: ${res.statusCode}`)));
+    req.on('error', reject);
+    req.end();
+  });
+}
+
+async function pushLatencyTest() {
+  console.log('📡 Push vs polling latency test');
+  console.log(`   Server: ${BASE_URL}, ${ROUNDS} rounds, polling every ${POLL_INTERVAL_MS}ms\n`);
+
+  // Two saved locations to flip between (already existing ones are fine)
+  for (const [i, name] of TARGETS.entries()) {
+    await axios.post(`${BASE_URL}/api/locations`, {
+      name,
+      latitude: 37.7749 + i * 0.01,
+      longitude: -122.4194
+    }).catch(() => {});
+  }
+
+  let pending = null; // { name, setAt, pushAt, pollAt }
+  const pushLatencies = [];
+  const pollLatencies = [];
+  let pushMessages = 0;
+  let pollRequests = 0;
+
+  const socket = await connectPush('latency-test', (message) => {
+    pushMessages++;
+    if (message.type === 'target' && pending && !pending.pushAt && message.data.name === pending.name) {
+      pending.pushAt = Date.now();
+    }
+  });
+  console.log('✅ Push channel connected');
+
+  // The polling device, as network_manager would do without a push channel
+  let polling = true;
+  const poller = (async () => {
+    while (polling) {
+      const started = Date.now();
+      try {
+        pollRequests++;
+        const res = await axios.get(`${BASE_URL}/api/target`);
+        const name = res.data.data && res.data.data.name;
+        if (pending && !pending.pollAt && name === pending.name) {
+          pending.pollAt = Date.now();
+        }
+      } catch (error) {
+        console.log(`⚠️  Poll failed: ${error.message}`);
+      }
+      await sleep(Math.max(0, POLL_INTERVAL_MS - (Date.now() - started)));
+    }
+  })();
+
+  const testStarted = Date.now();
+  for (let round = 0; round < ROUNDS; round++) {
+    // Random phase against the poll interval
+    await sleep(Math.random() * POLL_INTERVAL_MS);
+
+    pending = { name: TARGETS[round % TARGETS.length], setAt: Date.now() };
+    await axios.post(`${BASE_URL}/api/target/set`, { name: pending.name });
+
+    const deadline = Date.now() + POLL_INTERVAL_MS * 3;
+    while ((!pending.pushAt || !pending.pollAt) && Date.now() < deadline) {
+      await sleep(5);
+    }
+
+    if (pending.pushAt) pushLatencies.push(pending.pushAt - pending.setAt);
+    if (pending.pollAt) pollLatencies.push(pending.pollAt - pending.setAt);
+    console.log(`   Round ${round + 1}: push ${pending.pushAt ? pending.pushAt - pending.setAt : '-'}ms, ` +
+                `poll ${pending.pollAt ? pending.pollAt - pending.setAt : '-'}ms`);
+  }
+  const elapsedHours = (Date.now() - testStarted) / 3600000;
+
+  polling = false;
+  await poller;
+  socket.end(encodeFrame(0x8, Buffer.alloc(0), true));
+
+  console.log('\n📊 Time from /api/target/set to the device seeing the new target:');
+  summarize('push', pushLatencies);
+  summarize('poll', pollLatencies);
+
+  console.log('\n📊 Requests per device per hour:');
+  console.log(`   poll     ${(pollRequests / elapsedHours).toFixed(0)} HTTP requests (${pollRequests} in this run)`);
+  console.log(`   push     ${(3600000 / PING_INTERVAL_MS).toFixed(0)} pings + one message per change ` +
+              `(${pushMessages} messages in this run)`);
+
+  process.exit(0);
+}
+
+pushLatencyTest().catch(error => {
+  console.error('❌ Test failed:', error.message);
+  process.exit(1);
+});
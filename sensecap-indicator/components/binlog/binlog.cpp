@@ -0,0 +1,129 @@
+#include "binlog.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "task_plan.h"
+
+static const char *TAG = "BINLOG";
+
+#define BINLOG_STACK_SIZE 3072
+#define BINLOG_LINE_LEN   192
+
+// Writers on either core and the drain share the ring; the lock only
+// covers copying one record in or out
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+static binlog_record_t ring[BINLOG_RING_ENTRIES];
+static uint32_t ring_head = 0;   // next slot to write
+static uint32_t ring_count = 0;
+static binlog_stats_t stats = {};
+
+static TaskHandle_t drain_task_handle = NULL;
+
+static void drain_task(void *pvParameters);
+static void print_record(const binlog_record_t *record);
+static char level_letter(uint8_t level);
+
+void binlog_init(void)
+{
+    if (drain_task_handle) {
+        return;
+    }
+    
+    xTaskCreatePinnedToCore(drain_task, "binlog", BINLOG_STACK_SIZE, NULL, TASK_PRIO_LOG,
+                            &drain_task_handle, TASK_CORE_PROTOCOL);
+    ESP_LOGI(TAG, "Deferred logging, %d records buffered", BINLOG_RING_ENTRIES);
+}
+
+void binlog_write(esp_log_level_t level, const char *tag, const char *format, int arg_count,
+                  uintptr_t arg0, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3)
+{
+    uint32_t now_ms = esp_log_timestamp();
+    bool wake = false;
+    
+    portENTER_CRITICAL(&ring_lock);
+    if (ring_count == BINLOG_RING_ENTRIES) {
+        stats.dropped++;
+        portEXIT_CRITICAL(&ring_lock);
+        return;
+    }
+    binlog_record_t *record = &ring[ring_head];
+    record->timestamp_ms = now_ms;
+    record->tag = tag;
+    record->format = format;
+    record->level = (uint8_t)level;
+    record->arg_count = (uint8_t)arg_count;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+    record->args[3] = arg3;
+    ring_head = (ring_head + 1) % BINLOG_RING_ENTRIES;
+    wake = ring_count++ == 0;
+    if (ring_count > stats.high_water) {
+        stats.high_water = ring_count;
+    }
+    stats.written++;
+    portEXIT_CRITICAL(&ring_lock);
+    
+    // The drain empties the ring each time, so only the first record wakes it
+    if (wake && drain_task_handle) {
+        xTaskNotifyGive(drain_task_handle);
+    }
+}
+
+void binlog_get_stats(binlog_stats_t *out)
+{
+    portENTER_CRITICAL(&ring_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&ring_lock);
+}
+
+static void drain_task(void *pvParameters)
+{
+    uint32_t dropped_reported = 0;
+    
+    while (1) {
+        // Empty the ring, including records written before the task started
+        while (1) {
+            binlog_record_t record;
+            uint32_t dropped;
+            portENTER_CRITICAL(&ring_lock);
+            if (ring_count == 0) {
+                portEXIT_CRITICAL(&ring_lock);
+                break;
+            }
+            record = ring[(ring_head + BINLOG_RING_ENTRIES - ring_count) % BINLOG_RING_ENTRIES];
+            ring_count--;
+            dropped = stats.dropped;
+            portEXIT_CRITICAL(&ring_lock);
+            
+            print_record(&record);
+            if (dropped != dropped_reported) {
+                ESP_LOGW(TAG, "%lu records dropped, ring full", (unsigned long)(dropped - dropped_reported));
+                dropped_reported = dropped;
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+// Same layout as ESP_LOGx, with the time the record was written
+static void print_record(const binlog_record_t *record)
+{
+    char line[BINLOG_LINE_LEN];
+    snprintf(line, sizeof(line), record->format, record->args[0], record->args[1], record->args[2],
+             record->args[3]);
+    esp_log_write((esp_log_level_t)record->level, record->tag, "%c (%lu) %s: %s\n", level_letter(record->level),
+                  (unsigned long)record->timestamp_ms, record->tag, line);
+}
+
+static char level_letter(uint8_t level)
+{
+    switch (level) {
+        case ESP_LOG_ERROR:   return 'E';
+        case ESP_LOG_WARN:    return 'W';
+        case ESP_LOG_INFO:    return 'I';
+        case ESP_LOG_DEBUG:   return 'D';
+        default:              return 'V';
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deferred-format logging for hot paths. BINLOG_I() and friends store only
+// the format string's address, a timestamp and up to BINLOG_MAX_ARGS raw
+// arguments into a RAM ring; a low-priority drain task formats and prints
+// them later, so the caller never waits on printf or the UART.
+//
+// Arguments are stored as pointer-sized words (32 bits on the chip, 64 on
+// the linux host), so a %s pointer survives the round trip. Formats may only
+// use integer conversions (%d, %u, %x, %lu, %c...) and %s with strings that
+// outlive the drain (literals, static tables). Scale floats to integers at
+// the call site. When the ring is full new records are dropped and counted.
+//
+// Call sites above BINLOG_LEVEL compile to nothing.
+#define BINLOG_LEVEL           ESP_LOG_INFO
+#define BINLOG_RING_ENTRIES    128     // 32 bytes each on the chip
+#define BINLOG_MAX_ARGS        4
+
+typedef struct {
+    uint32_t timestamp_ms;  // esp_log_timestamp() when logged
+    const char *tag;
+    const char *format;
+    uint8_t level;          // esp_log_level_t
+    uint8_t arg_count;
+    uint16_t reserved;
+    uintptr_t args[BINLOG_MAX_ARGS];
+} binlog_record_t;
+
+typedef struct {
+    uint32_t written;
+    uint32_t dropped;       // ring full
+    uint32_t high_water;    // most records waiting at once
+} binlog_stats_t;
+
+// Starts the drain task; records written before are kept until it runs
+void binlog_init(void);
+
+void binlog_write(esp_log_level_t level, const char *tag, const char *format, int arg_count,
+                  uintptr_t arg0, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3);
+
+void binlog_get_stats(binlog_stats_t *stats);
+
+// Type-checks the call like ESP_LOGx does; never called
+static inline void binlog_check_format(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void binlog_check_format(const char *format, ...) {}
+
+#define BINLOG_ARG(x)                   ((uintptr_t)(x))
+#define BINLOG_NARGS_(_0, _1, _2, _3, _4, _5, n, ...) n
+#define BINLOG_NARGS(...)               BINLOG_NARGS_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define BINLOG_ARGS_(_0, a, b, c, d, ...) BINLOG_ARG(a), BINLOG_ARG(b), BINLOG_ARG(c), BINLOG_ARG(d)
+#define BINLOG_ARGS(...)                BINLOG_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0)
+
+#define BINLOG_WRITE(level, tag, format, ...) do {                                          \
+        if (BINLOG_LEVEL >= (level)) {                                                      \
+            if (0) binlog_check_format(format, ##__VA_ARGS__);                              \
+            (void)sizeof(char[BINLOG_NARGS(__VA_ARGS__) <= BINLOG_MAX_ARGS ? 1 : -1]);      \
+            binlog_write((level), (tag), (format), BINLOG_NARGS(__VA_ARGS__),               \
+                         BINLOG_ARGS(__VA_ARGS__));                                         \
+        }                                                                                   \
+    } while (0)
+
+#define BINLOG_E(tag, format, ...) BINLOG_WRITE(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define BINLOG_W(tag, format, ...) BINLOG_WRITE(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define BINLOG_I(tag, format, ...) BINLOG_WRITE(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define BINLOG_D(tag, format, ...) BINLOG_WRITE(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
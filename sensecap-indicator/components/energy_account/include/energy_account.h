@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+// Software energy estimate per subsystem. Subsystems report how long their
+// hardware was active, either as bursts (energy_account_add_us: an HTTP
+// exchange, a screen of SPI writes) or as a duty level held until changed
+// (energy_account_set_duty: BLE event rate, backlight level). A per-board
+// model gives each rail's current on top of the awake floor, and the
+// report turns active time into average mA, which is also mAh per hour.
+//
+// These are estimates for comparing optimizations against each other, not
+// measurements; check the model against a meter on the real board.
+    
+// WiFi TX airtime is estimated from bytes sent: the effective 802.11n rate
+// at typical signal after ACKs and contention, plus TCP/TLS/HTTP framing
+// per exchange
+#define ENERGY_WIFI_TX_KBPS            11000
+#define ENERGY_WIFI_TX_OVERHEAD_BYTES  400
+    
+typedef enum {
+    ENERGY_RAIL_AWAKE,      // board floor while not in light sleep (duty,
+                            // less the reported light sleep)
+    ENERGY_RAIL_CPU0,       // busy time above idle, per core
+    ENERGY_RAIL_CPU1,
+    ENERGY_RAIL_WIFI_RX,    // radio on: exchanges plus the power-save tail
+    ENERGY_RAIL_WIFI_TX,    // estimated airtime, on top of WIFI_RX
+    ENERGY_RAIL_BLE,        // advertising and connection events (duty)
+    ENERGY_RAIL_PANEL,      // panel transfers: SPI writes or frame copies
+    ENERGY_RAIL_BACKLIGHT,  // weighted by level (duty)
+    ENERGY_RAIL_COUNT
+} energy_rail_t;
+    
+// Currents in mA. rail_ma is added while the rail is active, the backlight
+// at full level; sleep_ma replaces the awake floor while in light sleep.
+typedef struct {
+    const char *board;
+    float sleep_ma;
+    float rail_ma[ENERGY_RAIL_COUNT];
+} energy_model_t;
+    
+typedef struct {
+    uint64_t active_us;     // weighted by duty level
+    uint64_t on_us;         // at any level; same as active_us for bursts
+    uint32_t events;        // bursts, or switches on for duty rails
+    bool duty;              // driven by energy_account_set_duty
+    float ma;               // average over the elapsed time
+} energy_rail_stats_t;
+    
+typedef struct {
+    const char *board;
+    uint64_t elapsed_us;    // since energy_account_init, time-scaled
+    energy_rail_stats_t rails[ENERGY_RAIL_COUNT];
+    uint64_t sleep_us;      // in light sleep, time-scaled
+    float sleep_ma;         // light-sleep floor, averaged the same way
+    float total_ma;         // everything: mAh per hour
+} energy_stats_t;
+    
+// Starts the clock with the awake rail on. The model must outlive the
+// component. Bursts reported before init are kept.
+void energy_account_init(const energy_model_t *model);
+    
+// The simulated host build runs faster than real time; duty rails and the
+// elapsed time are multiplied by this, bursts are taken as reported
+void energy_account_set_time_scale(float scale);
+    
+void energy_account_add_us(energy_rail_t rail, uint32_t active_us);
+    
+// permille of the rail's full current from now on; 0 switches it off
+void energy_account_set_duty(energy_rail_t rail, uint16_t permille);
+    
+// Automatic light sleep leaves the awake rail on; the PM exit callback
+// reports each nap here and it moves from the awake floor to sleep_ma.
+// Runs in the idle task with interrupts off, so it only adds.
+void energy_account_add_sleep_us(uint64_t slept_us);
+    
+const char *energy_account_rail_name(energy_rail_t rail);
+void energy_account_get_stats(energy_stats_t *stats);
+void energy_account_log(void);
+    
+// Airtime of one exchange that sent this many payload bytes
+static inline uint32_t energy_wifi_tx_airtime_us(size_t bytes)
+{
+    return (uint32_t)(((uint64_t)bytes + ENERGY_WIFI_TX_OVERHEAD_BYTES) * 8000 / ENERGY_WIFI_TX_KBPS);
+}
+    
+#ifdef __cplusplus
+}
+#endif
@@ -19,6 +19,21 @@ bool gps_handler_is_connected(void);
 void gps_handler_start_scan(void);
 void gps_handler_stop_scan(void);
 
+// Called with every new fix, on the BLE (or replay) task: copy and hand off only
+typedef void (*gps_fix_callback_t)(const gps_data_t *fix);
+void gps_handler_set_fix_callback(gps_fix_callback_t callback);
+
+// Counters since boot
+typedef struct {
+    uint32_t connects;
+    uint32_t writes;      // BLE writes (replay lines on the linux target)
+    uint32_t bytes;
+    uint32_t sentences;
+    uint32_t fixes;       // sentences that updated the position
+} gps_handler_stats_t;
+
+void gps_handler_get_stats(gps_handler_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
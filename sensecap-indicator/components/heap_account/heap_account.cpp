@@ -0,0 +1,339 @@
+#include "heap_account.h"
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#if HEAP_ACCOUNT_ASSERT_NO_ALLOC
+#include "esp_rom_sys.h"
+#endif
+
+static const char *TAG = "HEAP_ACCOUNT";
+
+#define BLOCK_MASK (HEAP_ACCOUNT_TRACKED_BLOCKS - 1)
+
+// A task inside a tag scope or a no-alloc region; free when task is NULL
+typedef struct {
+    TaskHandle_t task;
+    uint8_t tag;
+    uint8_t no_alloc_depth;
+    heap_account_region_t *region;  // outermost no-alloc region
+} task_entry_t;
+
+// A live block charged to a tagged subsystem; free when ptr is NULL
+typedef struct {
+    void *ptr;
+    uint32_t size;
+    uint8_t tag;
+} block_t;
+
+// Log names, in heap_account_tag_t order
+static const char *tag_names[HEAP_ACCOUNT_TAG_COUNT] = {
+    "other",
+    "gps",
+    "network",
+    "display",
+    "app",
+    "touch",
+};
+
+// The allocator hooks run on every task of both cores; everything below is
+// protected by account_lock, which is never held across an allocation
+static portMUX_TYPE account_lock = portMUX_INITIALIZER_UNLOCKED;
+static task_entry_t task_entries[HEAP_ACCOUNT_MAX_TASKS];
+static heap_account_stats_t stats = {};
+#if CONFIG_HEAP_USE_HOOKS
+static block_t blocks[HEAP_ACCOUNT_TRACKED_BLOCKS];
+#endif
+
+static task_entry_t *find_entry_locked(TaskHandle_t task);
+static task_entry_t *claim_entry_locked(TaskHandle_t task);
+static void release_if_idle_locked(task_entry_t *entry);
+#if CONFIG_HEAP_USE_HOOKS
+static uint32_t block_home(const void *ptr);
+static void block_insert_locked(void *ptr, uint32_t size, uint8_t tag);
+static block_t *block_find_locked(const void *ptr);
+static void block_remove_locked(block_t *block);
+#endif
+
+heap_account_tag_t heap_account_enter(heap_account_tag_t tag)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    heap_account_tag_t previous = HEAP_ACCOUNT_OTHER;
+    bool full = false;
+    
+    portENTER_CRITICAL(&account_lock);
+    task_entry_t *entry = claim_entry_locked(task);
+    if (entry) {
+        previous = (heap_account_tag_t)entry->tag;
+        entry->tag = (uint8_t)tag;
+        release_if_idle_locked(entry);
+    } else {
+        full = true;
+    }
+    portEXIT_CRITICAL(&account_lock);
+    
+    if (full) {
+        ESP_LOGW(TAG, "More than %d tasks tagged, %s not charged to %s", HEAP_ACCOUNT_MAX_TASKS,
+                 pcTaskGetName(task), tag_names[tag]);
+    }
+    return previous;
+}
+
+void heap_account_exit(heap_account_tag_t previous)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    
+    portENTER_CRITICAL(&account_lock);
+    task_entry_t *entry = find_entry_locked(task);
+    if (entry) {
+        entry->tag = (uint8_t)previous;
+        release_if_idle_locked(entry);
+    }
+    portEXIT_CRITICAL(&account_lock);
+}
+
+void heap_account_no_alloc_begin(heap_account_region_t *region)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    
+    portENTER_CRITICAL(&account_lock);
+    task_entry_t *entry = claim_entry_locked(task);
+    if (entry) {
+        if (entry->no_alloc_depth++ == 0) {
+            entry->region = region;
+        }
+    }
+    portEXIT_CRITICAL(&account_lock);
+}
+
+void heap_account_no_alloc_end(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    
+    portENTER_CRITICAL(&account_lock);
+    task_entry_t *entry = find_entry_locked(task);
+    if (entry && entry->no_alloc_depth > 0) {
+        if (--entry->no_alloc_depth == 0) {
+            entry->region->passes++;
+        }
+        release_if_idle_locked(entry);
+    }
+    portEXIT_CRITICAL(&account_lock);
+}
+
+const char *heap_account_tag_name(heap_account_tag_t tag)
+{
+    return tag < HEAP_ACCOUNT_TAG_COUNT ? tag_names[tag] : "?";
+}
+
+void heap_account_get_stats(heap_account_stats_t *out)
+{
+    portENTER_CRITICAL(&account_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&account_lock);
+#if CONFIG_HEAP_USE_HOOKS
+    out->hooks_enabled = true;
+#else
+    out->hooks_enabled = false;
+#endif
+}
+
+void heap_account_log(void)
+{
+    heap_account_stats_t snap;
+    heap_account_get_stats(&snap);
+    
+    if (!snap.hooks_enabled) {
+        ESP_LOGI(TAG, "Heap accounting off (CONFIG_HEAP_USE_HOOKS not set)");
+        return;
+    }
+    
+    ESP_LOGI(TAG, "Heap by subsystem (in use and peak count tagged blocks only):");
+    for (int i = 0; i < HEAP_ACCOUNT_TAG_COUNT; i++) {
+        const heap_account_counters_t *c = &snap.tags[i];
+        ESP_LOGI(TAG, "  %-8s allocs %7lu, frees %7lu, %9lu bytes, in use %6lu, peak %6lu", tag_names[i],
+                 (unsigned long)c->allocs, (unsigned long)c->frees, (unsigned long)c->bytes,
+                 (unsigned long)c->in_use, (unsigned long)c->peak);
+    }
+    if (snap.untracked) {
+        ESP_LOGW(TAG, "  %lu tagged blocks not tracked, raise HEAP_ACCOUNT_TRACKED_BLOCKS",
+                 (unsigned long)snap.untracked);
+    }
+    if (snap.no_alloc_violations) {
+        ESP_LOGW(TAG, "  %lu allocations in no-alloc regions, last %lu bytes in %s",
+                 (unsigned long)snap.no_alloc_violations, (unsigned long)snap.last_violation_size,
+                 snap.last_violation_region ? snap.last_violation_region : "?");
+    }
+}
+
+#if CONFIG_HEAP_USE_HOOKS
+// Called by heap_caps for every allocation and free. They must not allocate,
+// log or block, and stay in IRAM like the allocator itself.
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    if (!ptr || xPortInIsrContext()) return;
+    
+    // NULL before the scheduler starts
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    const char *violation = NULL;
+    
+    portENTER_CRITICAL(&account_lock);
+    task_entry_t *entry = task ? find_entry_locked(task) : NULL;
+    uint8_t tag = entry ? entry->tag : (uint8_t)HEAP_ACCOUNT_OTHER;
+    if (entry && entry->no_alloc_depth > 0 && entry->region->passes >= HEAP_ACCOUNT_WARMUP_PASSES) {
+        violation = entry->region->name;
+        entry->region->violations++;
+        stats.no_alloc_violations++;
+        stats.last_violation_region = violation;
+        stats.last_violation_size = size;
+    }
+    
+    heap_account_counters_t *c = &stats.tags[tag];
+    c->allocs++;
+    c->bytes += size;
+    if (tag != HEAP_ACCOUNT_OTHER) {
+        block_insert_locked(ptr, size, tag);
+    }
+    portEXIT_CRITICAL(&account_lock);
+    
+#if HEAP_ACCOUNT_ASSERT_NO_ALLOC
+    if (violation) {
+        esp_rom_printf("heap_account: %u-byte allocation in no-alloc region %s\n", (unsigned)size, violation);
+        abort();
+    }
+#else
+    (void)violation;
+#endif
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+    if (!ptr) return;
+    
+    portENTER_CRITICAL(&account_lock);
+    block_t *block = block_find_locked(ptr);
+    if (block) {
+        heap_account_counters_t *c = &stats.tags[block->tag];
+        c->frees++;
+        c->in_use -= block->size;
+        block_remove_locked(block);
+    } else {
+        stats.tags[HEAP_ACCOUNT_OTHER].frees++;
+    }
+    portEXIT_CRITICAL(&account_lock);
+}
+#endif
+
+static IRAM_ATTR task_entry_t *find_entry_locked(TaskHandle_t task)
+{
+    if (!task) {
+        return NULL;
+    }
+    for (int i = 0; i < HEAP_ACCOUNT_MAX_TASKS; i++) {
+        if (task_entries[i].task == task) {
+            return &task_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static task_entry_t *claim_entry_locked(TaskHandle_t task)
+{
+    task_entry_t *entry = find_entry_locked(task);
+    if (entry || !task) {
+        return entry;
+    }
+    
+    for (int i = 0; i < HEAP_ACCOUNT_MAX_TASKS; i++) {
+        if (!task_entries[i].task) {
+            entry = &task_entries[i];
+            entry->task = task;
+            entry->tag = HEAP_ACCOUNT_OTHER;
+            entry->no_alloc_depth = 0;
+            entry->region = NULL;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Keeps the table to the tasks that are inside a tag or region right now
+static void release_if_idle_locked(task_entry_t *entry)
+{
+    if (entry->tag == HEAP_ACCOUNT_OTHER && entry->no_alloc_depth == 0) {
+        entry->task = NULL;
+    }
+}
+
+#if CONFIG_HEAP_USE_HOOKS
+// Open addressing with linear probing; heap blocks are at least 4-byte aligned
+static IRAM_ATTR uint32_t block_home(const void *ptr)
+{
+    return ((uint32_t)(uintptr_t)ptr >> 3) & BLOCK_MASK;
+}
+
+static IRAM_ATTR void block_insert_locked(void *ptr, uint32_t size, uint8_t tag)
+{
+    uint32_t i = block_home(ptr);
+    for (int probes = 0; probes < HEAP_ACCOUNT_TRACKED_BLOCKS; probes++, i = (i + 1) & BLOCK_MASK) {
+        block_t *block = &blocks[i];
+        if (block->ptr == ptr) {
+            // A block that was resized in place; charge it afresh
+            stats.tags[block->tag].in_use -= block->size;
+        } else if (block->ptr) {
+            continue;
+        }
+        block->ptr = ptr;
+        block->size = size;
+        block->tag = tag;
+        heap_account_counters_t *c = &stats.tags[tag];
+        c->in_use += size;
+        if (c->in_use > c->peak) {
+            c->peak = c->in_use;
+        }
+        return;
+    }
+    stats.untracked++;
+}
+
+static IRAM_ATTR block_t *block_find_locked(const void *ptr)
+{
+    uint32_t i = block_home(ptr);
+    for (int probes = 0; probes < HEAP_ACCOUNT_TRACKED_BLOCKS; probes++, i = (i + 1) & BLOCK_MASK) {
+        if (!blocks[i].ptr) {
+            return NULL;
+        }
+        if (blocks[i].ptr == ptr) {
+            return &blocks[i];
+        }
+    }
+    return NULL;
+}
+
+// Shifts later entries of the probe run back so lookups never stop early
+static IRAM_ATTR void block_remove_locked(block_t *block)
+{
+    uint32_t hole = block - blocks;
+    uint32_t next = hole;
+    
+    blocks[hole].ptr = NULL;
+    while (1) {
+        next = (next + 1) & BLOCK_MASK;
+        if (!blocks[next].ptr) {
+            return;
+        }
+        uint32_t home = block_home(blocks[next].ptr);
+        bool reachable = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (reachable) {
+            continue;
+        }
+        blocks[hole] = blocks[next];
+        blocks[next].ptr = NULL;
+        hole = next;
+    }
+}
+#endif
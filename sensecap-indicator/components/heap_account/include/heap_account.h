@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Heap use per subsystem. A task declares which subsystem it is working for
+// with heap_account_enter(); the allocator hooks (CONFIG_HEAP_USE_HOOKS,
+// from the sdkconfig.debug overlay) charge every allocation it makes to that subsystem, and remember the
+// block so its free is credited back to the same subsystem wherever it
+// happens. Untagged work is charged to HEAP_ACCOUNT_OTHER.
+//
+// No-alloc regions mark code that must not touch the heap in steady state
+// (GPS parse, compass draw). The first HEAP_ACCOUNT_WARMUP_PASSES through a
+// region may allocate, since newlib sets up per-task buffers (strtod's
+// bignums, stdio) on first use. After that an allocation inside the region
+// is counted as a violation, or aborts with the region name when
+// HEAP_ACCOUNT_ASSERT_NO_ALLOC is 1, which is meant for debug builds.
+#define HEAP_ACCOUNT_ASSERT_NO_ALLOC  0
+#define HEAP_ACCOUNT_WARMUP_PASSES    8
+#define HEAP_ACCOUNT_MAX_TASKS        16      // tasks inside a tag or region at once
+#define HEAP_ACCOUNT_TRACKED_BLOCKS   512     // live tagged blocks, power of two
+
+typedef enum {
+    HEAP_ACCOUNT_OTHER,     // untagged: IDF stacks, logging, boot
+    HEAP_ACCOUNT_GPS,
+    HEAP_ACCOUNT_NETWORK,
+    HEAP_ACCOUNT_DISPLAY,
+    HEAP_ACCOUNT_APP,
+    HEAP_ACCOUNT_TOUCH,
+    HEAP_ACCOUNT_TAG_COUNT
+} heap_account_tag_t;
+
+typedef struct {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t bytes;         // allocated since boot
+    uint32_t in_use;        // bytes still allocated; tagged subsystems only
+    uint32_t peak;          // highest in_use since boot
+} heap_account_counters_t;
+
+// A no-alloc region; define one static per call site with HEAP_ACCOUNT_REGION
+typedef struct {
+    const char *name;
+    uint32_t passes;        // completed since boot
+    uint32_t violations;
+} heap_account_region_t;
+
+#define HEAP_ACCOUNT_REGION(name) { (name), 0, 0 }
+
+typedef struct {
+    bool hooks_enabled;     // false without CONFIG_HEAP_USE_HOOKS: all zero
+    heap_account_counters_t tags[HEAP_ACCOUNT_TAG_COUNT];
+    uint32_t untracked;     // tagged blocks not remembered, table full
+    uint32_t no_alloc_violations;
+    const char *last_violation_region;
+    uint32_t last_violation_size;
+} heap_account_stats_t;
+
+// Charges the calling task's allocations to tag until heap_account_exit()
+// restores the previous tag returned here. Scopes nest.
+heap_account_tag_t heap_account_enter(heap_account_tag_t tag);
+void heap_account_exit(heap_account_tag_t previous);
+
+// The calling task must not allocate until the matching end. Regions nest;
+// the outermost one is charged.
+void heap_account_no_alloc_begin(heap_account_region_t *region);
+void heap_account_no_alloc_end(void);
+
+const char *heap_account_tag_name(heap_account_tag_t tag);
+void heap_account_get_stats(heap_account_stats_t *stats);
+void heap_account_log(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Boot steps run concurrently, each on its own short-lived task, as soon as
+// the steps it depends on have finished. A step that fails still counts as
+// finished so nothing waits forever; its error shows up in the boot log.
+#define INIT_SCHEDULER_MAX_STEPS    16
+#define INIT_SCHEDULER_STACK_SIZE   4096
+
+#define INIT_STEP(index) (1u << (index))
+
+typedef esp_err_t (*init_step_fn_t)(void);
+
+typedef struct {
+    const char *name;
+    init_step_fn_t run;
+    uint32_t depends_on;  // INIT_STEP() mask of steps that must finish first
+    uint32_t stack_size;  // 0 for INIT_SCHEDULER_STACK_SIZE
+    BaseType_t core;      // core for the step's task (drivers put their interrupts there), or tskNO_AFFINITY
+} init_step_t;
+
+// Starts every step in the table (which must outlive the boot); returns at once
+bool init_scheduler_start(const init_step_t *steps, int count);
+
+// Waits until every step in mask has finished; false on timeout
+bool init_scheduler_wait(uint32_t mask, uint32_t timeout_ms);
+bool init_scheduler_is_done(uint32_t mask);
+
+// Milliseconds since init_scheduler_start()
+uint32_t init_scheduler_elapsed_ms(void);
+
+// One line per step: start offset, duration and result
+void init_scheduler_log(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// GPS-to-pixel latency budget. Every fix is stamped when its BLE write
+// arrives and when it is parsed (gps_data_t.received_us / parsed_us); the
+// app task marks the later stages as it handles the fix. Each stage's time
+// since the previous one, and the total from receipt, go into a window of
+// the last LATENCY_BUDGET_WINDOW fixes for percentiles, and any fix over a
+// stage or total budget counts as a violation (logged, rate limited).
+#define LATENCY_BUDGET_WINDOW          128
+#define LATENCY_VIOLATION_LOG_MS       10000
+
+typedef enum {
+    LATENCY_STAGE_PARSE,        // BLE write received -> NMEA parsed
+    LATENCY_STAGE_DISPATCH,     // parsed -> app task picks the fix up
+    LATENCY_STAGE_BEARING,      // -> distance and bearing computed
+    LATENCY_STAGE_DRAW_ISSUED,  // -> compass draw started
+    LATENCY_STAGE_PIXELS,       // -> last SPI byte of the frame sent
+    LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+// Default budgets (microseconds) per stage and from receipt to pixels; the
+// phone-to-ESP32 hop before receipt isn't visible to the firmware
+#define LATENCY_BUDGET_PARSE_US        5000
+#define LATENCY_BUDGET_DISPATCH_US     20000
+#define LATENCY_BUDGET_BEARING_US      1000
+#define LATENCY_BUDGET_DRAW_ISSUED_US  2000
+#define LATENCY_BUDGET_PIXELS_US       60000
+#define LATENCY_BUDGET_TOTAL_US        80000
+
+typedef struct {
+    uint32_t count;         // samples in the window
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t budget_us;
+    uint32_t violations;    // since boot
+} latency_stage_stats_t;
+
+typedef struct {
+    uint32_t fixes;         // fixes tracked since boot
+    latency_stage_stats_t stages[LATENCY_STAGE_COUNT];
+    latency_stage_stats_t total;
+} latency_budget_stats_t;
+
+// Budgets in microseconds; 0 turns the check off
+void latency_budget_set(latency_stage_t stage, uint32_t budget_us);
+void latency_budget_set_total(uint32_t budget_us);
+
+// Everything below runs on the app task only.
+//
+// Start tracking a fix from its receipt and parse stamps, mark each later
+// stage as it completes, then record the fix. A fix with no receipt stamp
+// (bench or simulated) is ignored; a fix whose draw stages are never marked
+// (not on the compass screen) records only the stages it reached, and no total.
+void latency_budget_begin(uint32_t received_us, uint32_t parsed_us);
+void latency_budget_mark(latency_stage_t stage);
+void latency_budget_end(void);
+
+// The statistics may be read from any task
+const char *latency_budget_stage_name(latency_stage_t stage);
+void latency_budget_get_stats(latency_budget_stats_t *stats);
+void latency_budget_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,215 @@
+#include "latency_budget.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "LATENCY";
+
+// Window slot for the receipt-to-pixels total, after the stages
+#define TOTAL_SLOT LATENCY_STAGE_COUNT
+
+// Log names, in latency_stage_t order
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    "parse",
+    "dispatch",
+    "bearing",
+    "draw",
+    "pixels",
+};
+
+static uint32_t budgets_us[LATENCY_STAGE_COUNT + 1] = {
+    LATENCY_BUDGET_PARSE_US,
+    LATENCY_BUDGET_DISPATCH_US,
+    LATENCY_BUDGET_BEARING_US,
+    LATENCY_BUDGET_DRAW_ISSUED_US,
+    LATENCY_BUDGET_PIXELS_US,
+    LATENCY_BUDGET_TOTAL_US,
+};
+
+// All state belongs to the app task; the windows and counters are also read
+// by whoever asks for the statistics, under window_lock
+static portMUX_TYPE window_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t window[LATENCY_STAGE_COUNT + 1][LATENCY_BUDGET_WINDOW];
+static uint32_t window_count[LATENCY_STAGE_COUNT + 1];
+static uint32_t window_head[LATENCY_STAGE_COUNT + 1];
+static uint32_t violations[LATENCY_STAGE_COUNT + 1];
+static uint32_t fixes = 0;
+
+// The fix being tracked
+static bool tracking = false;
+static uint32_t fix_received_us = 0;
+static uint32_t marks_us[LATENCY_STAGE_COUNT];
+static bool marked[LATENCY_STAGE_COUNT];
+
+static int64_t last_warning_us = 0;
+static uint32_t warnings_suppressed = 0;
+
+static void record(int slot, uint32_t elapsed_us);
+static void fill_stats(int slot, latency_stage_stats_t *stats);
+static int compare_u32(const void *a, const void *b);
+
+void latency_budget_set(latency_stage_t stage, uint32_t budget_us)
+{
+    if (stage < 0 || stage >= LATENCY_STAGE_COUNT) return;
+    budgets_us[stage] = budget_us;
+}
+
+void latency_budget_set_total(uint32_t budget_us)
+{
+    budgets_us[TOTAL_SLOT] = budget_us;
+}
+
+void latency_budget_begin(uint32_t received_us, uint32_t parsed_us)
+{
+    tracking = received_us != 0;
+    if (!tracking) return;
+    
+    fix_received_us = received_us;
+    memset(marked, 0, sizeof(marked));
+    marks_us[LATENCY_STAGE_PARSE] = parsed_us;
+    marked[LATENCY_STAGE_PARSE] = true;
+}
+
+void latency_budget_mark(latency_stage_t stage)
+{
+    if (!tracking || stage < 0 || stage >= LATENCY_STAGE_COUNT) return;
+    marks_us[stage] = (uint32_t)esp_timer_get_time();
+    marked[stage] = true;
+}
+
+void latency_budget_end(void)
+{
+    if (!tracking) return;
+    tracking = false;
+    portENTER_CRITICAL(&window_lock);
+    fixes++;
+    portEXIT_CRITICAL(&window_lock);
+    
+    // Each stage runs from the previous one reached; unsigned differences
+    // stay right across the 32-bit wrap
+    uint32_t elapsed_us[LATENCY_STAGE_COUNT + 1] = {};
+    bool over[LATENCY_STAGE_COUNT + 1] = {};
+    bool any_over = false;
+    uint32_t previous_us = fix_received_us;
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        if (!marked[i]) continue;
+        elapsed_us[i] = marks_us[i] - previous_us;
+        previous_us = marks_us[i];
+        record(i, elapsed_us[i]);
+        over[i] = budgets_us[i] && elapsed_us[i] > budgets_us[i];
+        any_over |= over[i];
+    }
+    if (marked[LATENCY_STAGE_PIXELS]) {
+        elapsed_us[TOTAL_SLOT] = marks_us[LATENCY_STAGE_PIXELS] - fix_received_us;
+        record(TOTAL_SLOT, elapsed_us[TOTAL_SLOT]);
+        over[TOTAL_SLOT] = budgets_us[TOTAL_SLOT] && elapsed_us[TOTAL_SLOT] > budgets_us[TOTAL_SLOT];
+        any_over |= over[TOTAL_SLOT];
+    }
+    if (!any_over) return;
+    
+    portENTER_CRITICAL(&window_lock);
+    for (int i = 0; i <= LATENCY_STAGE_COUNT; i++) {
+        if (over[i]) violations[i]++;
+    }
+    portEXIT_CRITICAL(&window_lock);
+    
+    // One line per fix would flood the log while the system is struggling
+    int64_t now = esp_timer_get_time();
+    if (last_warning_us && now - last_warning_us < (int64_t)LATENCY_VIOLATION_LOG_MS * 1000) {
+        warnings_suppressed++;
+        return;
+    }
+    last_warning_us = now;
+    
+    char detail[128];
+    int len = 0;
+    for (int i = 0; i < LATENCY_STAGE_COUNT && len < (int)sizeof(detail); i++) {
+        if (!marked[i]) continue;
+        len += snprintf(detail + len, sizeof(detail) - len, " %s %lu%s", stage_names[i],
+                        (unsigned long)elapsed_us[i], over[i] ? "!" : "");
+    }
+    ESP_LOGW(TAG, "Fix over budget: total %lu/%lu us,%s (%lu more since last warning)",
+             (unsigned long)elapsed_us[TOTAL_SLOT], (unsigned long)budgets_us[TOTAL_SLOT], detail,
+             (unsigned long)warnings_suppressed);
+    warnings_suppressed = 0;
+}
+
+const char *latency_budget_stage_name(latency_stage_t stage)
+{
+    return stage >= 0 && stage < LATENCY_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+void latency_budget_get_stats(latency_budget_stats_t *stats)
+{
+    if (!stats) return;
+    
+    portENTER_CRITICAL(&window_lock);
+    stats->fixes = fixes;
+    portEXIT_CRITICAL(&window_lock);
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        fill_stats(i, &stats->stages[i]);
+    }
+    fill_stats(TOTAL_SLOT, &stats->total);
+}
+
+void latency_budget_log_stats(void)
+{
+    latency_budget_stats_t stats;
+    latency_budget_get_stats(&stats);
+    
+    ESP_LOGI(TAG, "GPS-to-pixel latency over the last %lu of %lu fixes (us, p50/p95/p99/max, budget, over):",
+             (unsigned long)stats.total.count, (unsigned long)stats.fixes);
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const latency_stage_stats_t *s = &stats.stages[i];
+        ESP_LOGI(TAG, "  %-8s %lu/%lu/%lu/%lu  %lu  %lu", stage_names[i],
+                 (unsigned long)s->p50_us, (unsigned long)s->p95_us, (unsigned long)s->p99_us,
+                 (unsigned long)s->max_us, (unsigned long)s->budget_us, (unsigned long)s->violations);
+    }
+    const latency_stage_stats_t *t = &stats.total;
+    ESP_LOGI(TAG, "  %-8s %lu/%lu/%lu/%lu  %lu  %lu", "total",
+             (unsigned long)t->p50_us, (unsigned long)t->p95_us, (unsigned long)t->p99_us,
+             (unsigned long)t->max_us, (unsigned long)t->budget_us, (unsigned long)t->violations);
+}
+
+static void record(int slot, uint32_t elapsed_us)
+{
+    portENTER_CRITICAL(&window_lock);
+    window[slot][window_head[slot]] = elapsed_us;
+    window_head[slot] = (window_head[slot] + 1) % LATENCY_BUDGET_WINDOW;
+    if (window_count[slot] < LATENCY_BUDGET_WINDOW) {
+        window_count[slot]++;
+    }
+    portEXIT_CRITICAL(&window_lock);
+}
+
+// Nearest-rank percentiles over a sorted copy of the window
+static void fill_stats(int slot, latency_stage_stats_t *stats)
+{
+    uint32_t sorted[LATENCY_BUDGET_WINDOW];
+    
+    memset(stats, 0, sizeof(*stats));
+    portENTER_CRITICAL(&window_lock);
+    uint32_t count = window_count[slot];
+    stats->count = count;
+    stats->budget_us = budgets_us[slot];
+    stats->violations = violations[slot];
+    memcpy(sorted, window[slot], count * sizeof(sorted[0]));
+    portEXIT_CRITICAL(&window_lock);
+    if (count == 0) return;
+    
+    qsort(sorted, count, sizeof(sorted[0]), compare_u32);
+    stats->p50_us = sorted[(count * 50 + 99) / 100 - 1];
+    stats->p95_us = sorted[(count * 95 + 99) / 100 - 1];
+    stats->p99_us = sorted[(count * 99 + 99) / 100 - 1];
+    stats->max_us = sorted[count - 1];
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
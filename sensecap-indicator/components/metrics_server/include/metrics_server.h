@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Metrics endpoint for scraping bench units over WiFi. GET /metrics serves
+// every counter in the Prometheus text format, GET /metrics.json the same
+// figures as compact JSON: {"name":value,"labeled_name":{"k=v,k2=v2":value}}.
+//
+// A low-priority task on the protocol core formats both into fixed buffers
+// every METRICS_REFRESH_MS; the HTTP handlers only send what is there, so a
+// scrape never formats, allocates or waits on the app task. Refreshing
+// pauses when nobody scraped for METRICS_IDLE_MS; the next scrape gets the
+// last figures and restarts it.
+#define METRICS_REFRESH_MS      5000
+#define METRICS_IDLE_MS         60000
+#define METRICS_PROM_BUFFER     16384
+#define METRICS_JSON_BUFFER     8192
+#define METRICS_STACK_SIZE      4096
+
+typedef struct metrics_writer metrics_writer_t;
+
+// Application metrics appended to every refresh, on the metrics task
+typedef void (*metrics_extra_fn_t)(metrics_writer_t *writer);
+
+// Needs the network stack up; idempotent. Buffers come from PSRAM when
+// there is any.
+bool metrics_server_start(uint16_t port);
+void metrics_server_set_extra(metrics_extra_fn_t fn);
+
+// For metrics_extra_fn_t: a family (Prometheus type "counter" or "gauge"),
+// then its samples. Labels are in Prometheus form, e.g. core="%d".
+void metrics_family(metrics_writer_t *writer, const char *name, const char *type, const char *help);
+void metrics_value(metrics_writer_t *writer, double value);
+void metrics_sample(metrics_writer_t *writer, double value, const char *labels_format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
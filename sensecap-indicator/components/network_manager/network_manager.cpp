@@ -1,9 +1,37 @@
 #include "network_manager.h"
+#include "navigation_calc.h"
+#include "radio_scheduler.h"
+#include "trace.h"
+#include "binlog.h"
+#include "energy_account.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
 #include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#else
+#include "rom/miniz.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#endif
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#include "esp_websocket_client.h"
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 static const char *TAG = "NETWORK_MANAGER";
 
@@ -12,19 +40,271 @@ static char backend_base_url[256] = {0};
 static char http_response_buffer[4096] = {0};
 static int http_response_len = 0;
 
+// The response buffer is shared by every request, so requests are serialized
+static SemaphoreHandle_t http_mutex = NULL;
+
+#if CONFIG_PM_ENABLE
+// Full speed and no light sleep from DNS to the last byte of a request
+// (TLS is CPU-bound); released between retries and while idle
+static esp_pm_lock_handle_t http_pm_lock = NULL;
+#endif
+
+// Sidequest prefetch state. The prefetch runs as a deferred radio job.
+#define SIDEQUEST_PREFETCH_RETRY_MS     30000
+#define SIDEQUEST_PREFETCH_MAX_DELAY_MS 30000
+
+static SemaphoreHandle_t prefetch_mutex = NULL;
+static int prefetch_job = -1;
+static bool prefetch_failed = false;
+static uint32_t prefetch_failed_ms = 0;
+static float prefetch_regen_distance_m = SIDEQUEST_PREFETCH_DEFAULT_DISTANCE_M;
+static gps_data_t prefetch_position = {0};
+static sidequest_data_t prefetch_sidequest = {0};
+static bool prefetch_ready = false;
+static double prefetch_origin_lat = 0;
+static double prefetch_origin_lng = 0;
+
+// Per-endpoint adaptive timeouts (RFC 6298 style). Until the first sample
+// an endpoint uses its max timeout; afterwards SRTT + 4 * RTTVAR, clamped.
+// Idempotent GETs are retried with jittered backoff inside the deadline.
+#define RTT_MAX_ATTEMPTS      3
+#define RTT_RETRY_BASE_MS     250
+#define RTT_CLOCK_GRANULARITY 10
+
+typedef struct {
+    const char *name;
+    uint32_t min_timeout_ms;
+    uint32_t max_timeout_ms;
+    bool idempotent;
+} endpoint_config_t;
+
+static const endpoint_config_t endpoint_configs[NM_ENDPOINT_COUNT] = {
+    [NM_ENDPOINT_HEALTH]        = { "health",        1500,  5000, true  },
+    [NM_ENDPOINT_GPS]           = { "gps",           2000, 10000, false },
+    [NM_ENDPOINT_LOCATION_SAVE] = { "location_save", 3000, 10000, false },
+    [NM_ENDPOINT_LOCATION_LIST] = { "location_list", 2000, 10000, true  },
+    [NM_ENDPOINT_SAFETY]        = { "safety",        4000, 15000, true  },
+    [NM_ENDPOINT_SIDEQUEST]     = { "sidequest",     6000, 15000, false },
+};
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static nm_endpoint_stats_t endpoint_stats[NM_ENDPOINT_COUNT] = {};
+
+// Backend health, derived from the outcome of every request; a call and its
+// retries count once. After HEALTH_FAILURE_THRESHOLD consecutive failed calls
+// the circuit opens and requests fail fast until an exponentially backed-off,
+// jittered retry time.
+#define HEALTH_FAILURE_THRESHOLD   3
+#define HEALTH_IDLE_PROBE_MS       120000
+#define HEALTH_LINK_DOWN_POLL_MS   5000
+#define HEALTH_BACKOFF_BASE_MS     2000
+#define HEALTH_BACKOFF_MAX_MS      300000
+
+// Probes go out in the next radio window; while the backend is down the
+// window may not wait as long. The backend task checks again this long
+// after the window, once the probe has had time to finish.
+#define HEALTH_PROBE_MAX_DELAY_MS  30000
+#define HEALTH_RETRY_MAX_DELAY_MS  5000
+#define HEALTH_PROBE_SETTLE_MS     1000
+
+typedef enum {
+    CIRCUIT_CLOSED,
+    CIRCUIT_OPEN,
+    CIRCUIT_HALF_OPEN
+} circuit_state_t;
+
+static portMUX_TYPE health_lock = portMUX_INITIALIZER_UNLOCKED;
+static circuit_state_t circuit_state = CIRCUIT_CLOSED;
+static int consecutive_failures = 0;
+static uint32_t backoff_ms = HEALTH_BACKOFF_BASE_MS;
+static uint32_t retry_at_ms = 0;
+static uint32_t last_outcome_ms = 0;
+static bool backend_seen_up = false;
+static int health_probe_job = -1;
+
+// GPS upload governor state
+#define GPS_UPLOAD_MAX_REJECTIONS 3
+
+// A fix the governor passed waits at most this long for a radio window
+#define GPS_UPLOAD_MAX_DELAY_MS   30000
+
+static SemaphoreHandle_t governor_mutex = NULL;
+static gps_upload_policy_t upload_policy = GPS_UPLOAD_POLICY_DEFAULT;
+static gps_upload_stats_t upload_stats = {0};
+static gps_data_t last_plausible_fix = {0};
+static gps_data_t last_sent_fix = {0};
+static float last_sent_heading = -1.0f;
+static uint32_t last_seen_timestamp = 0;
+static int consecutive_rejections = 0;
+static int gps_upload_job = -1;
+static bool upload_pending = false;
+static gps_data_t pending_fix = {0};
+static uint32_t pending_fix_ms = 0;
+static float pending_heading = -1.0f;
+
+// Body compression. Responses are requested with Accept-Encoding: gzip and
+// inflated straight into http_response_buffer as they arrive; the buffer is
+// the whole output, so it doubles as the inflate window. Request bodies of
+// at least DEFLATE_MIN_BODY_BYTES are sent zlib-deflated.
+#define DEFLATE_MIN_BODY_BYTES 512
+#define DEFLATE_PROBES         16
+
+// The linux target has no ROM miniz, so bodies go uncompressed there
+#if CONFIG_IDF_TARGET_LINUX
+#define COMPRESSION_SUPPORTED  0
+#else
+#define COMPRESSION_SUPPORTED  1
+#endif
+
+// The deflate compressor state is ~300 KB, which only fits in PSRAM; boards
+// without it (the ESP32 TFT) still inflate responses but send bodies raw
+#if COMPRESSION_SUPPORTED && CONFIG_SPIRAM
+#define DEFLATE_REQUESTS_SUPPORTED 1
+#else
+#define DEFLATE_REQUESTS_SUPPORTED 0
+#endif
+
+typedef enum {
+    GZIP_HEADER_FIXED,
+    GZIP_HEADER_EXTRA_LEN,
+    GZIP_HEADER_EXTRA,
+    GZIP_HEADER_NAME,
+    GZIP_HEADER_COMMENT,
+    GZIP_HEADER_CRC,
+    GZIP_BODY,
+    GZIP_DONE
+} gzip_stage_t;
+
+typedef struct {
+#if COMPRESSION_SUPPORTED
+    tinfl_decompressor inflator;
+#endif
+    gzip_stage_t stage;
+    uint8_t flags;
+    uint32_t field_pos;
+    uint32_t field_len;
+} gzip_stream_t;
+
+// State of the response currently being received (caller holds http_mutex).
+// Phase timestamps are esp_timer_get_time() values, 0 when not reached.
+typedef struct {
+    gzip_stream_t *gzip;
+    bool truncated;
+    uint32_t wire_bytes;
+    int64_t start_us;
+    int64_t dns_done_us;
+    int64_t connected_us;
+    int64_t first_header_us;
+    int64_t first_data_us;
+    int64_t end_us;
+} http_rx_state_t;
+
+typedef struct {
+    const char *data;
+    size_t len;
+    bool deflated;
+} http_body_t;
+
+static bool compression_enabled = COMPRESSION_SUPPORTED;
+static http_rx_state_t http_rx = {};
+static nm_first_byte_callback_t first_byte_callback = NULL;
+
+// Response bodies are only dumped at debug level, and at most once per interval
+#define BODY_DUMP_INTERVAL_MS 5000
+#define BODY_DUMP_MAX_CHARS   512
+
+static uint32_t last_body_dump_ms = 0;
+
+// Push channel: a WebSocket to the backend that delivers target changes,
+// safety alerts and sidequest results as they happen, and carries GPS fixes
+// upstream instead of one HTTP POST each
+#define PUSH_BUFFER_SIZE      2048
+#define PUSH_RECONNECT_MS     10000
+#define PUSH_NETWORK_TIMEOUT_MS 10000
+#define PUSH_PING_INTERVAL_S  30
+#define PUSH_SEND_TIMEOUT_MS  1000
+
+static esp_websocket_client_handle_t push_client = NULL;
+static nm_push_handlers_t push_handlers = {};
+static volatile bool push_connected = false;
+static char push_buffer[PUSH_BUFFER_SIZE];
+static nm_push_stats_t push_stats = {};  // protected by stats_lock
+
+// Request implementations, called with http_mutex held
+static bool test_connectivity_locked(void);
+static bool send_gps_data_locked(const gps_data_t *gps_data);
+static bool save_location_locked(const gps_data_t *gps_data);
+static bool select_target_location_locked(target_data_t *target, uint32_t deadline_ms);
+static bool check_location_safety_locked(const gps_data_t *gps_data, safety_data_t *safety, uint32_t deadline_ms);
+static bool generate_sidequest_locked(const gps_data_t *gps_data, sidequest_data_t *sidequest);
+static void sidequest_prefetch_job(void *arg);
+static void gps_upload_job_run(void *arg);
+static void gps_upload_flush(bool http_locked);
+static void health_probe_job_run(void *arg);
+static uint32_t health_probe_due_ms(uint32_t now_ms);
+static esp_err_t http_request(nm_endpoint_t endpoint, const char *url, esp_http_client_method_t method,
+                              const char *body, uint32_t deadline_ms, int *status_code);
+static esp_err_t http_attempt(const char *url, esp_http_client_method_t method, const http_body_t *body,
+                              int timeout_ms, int *status_code);
+static char *deflate_body(const char *body, size_t len, size_t *out_len);
+static void gzip_feed(gzip_stream_t *gz, const uint8_t *data, size_t len);
+static void response_append(const uint8_t *data, size_t len);
+static void dns_resolve(const char *url);
+static void stats_record_attempt(nm_endpoint_t endpoint, esp_err_t err, int status_code,
+                                 size_t bytes_sent, size_t bytes_sent_raw);
+static uint32_t rtt_timeout_ms(nm_endpoint_t endpoint);
+static void rtt_record_sample(nm_endpoint_t endpoint, uint32_t rtt_ms);
+static void rtt_record_timeout(nm_endpoint_t endpoint);
+static bool circuit_allows_request(void);
+static void health_record_outcome(bool reached_backend);
+static bool parse_target(const cJSON *item, target_data_t *target);
+static void parse_safety(const cJSON *data, safety_data_t *safety);
+static void parse_sidequest(const cJSON *data, sidequest_data_t *sidequest);
+static void push_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static void push_dispatch(const char *message);
+
 // HTTP event handler
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
     switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            // TCP connect plus TLS handshake for https
+            http_rx.connected_us = esp_timer_get_time();
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            if (http_rx.first_header_us == 0) {
+                http_rx.first_header_us = esp_timer_get_time();
+                if (first_byte_callback) first_byte_callback(http_rx.first_header_us);
+            }
+            if (strcasecmp(evt->header_key, "Content-Encoding") == 0 && strstr(evt->header_value, "gzip") &&
+                !http_rx.gzip) {
+                http_rx.gzip = (gzip_stream_t *)calloc(1, sizeof(gzip_stream_t));
+                if (!http_rx.gzip) {
+                    ESP_LOGE(TAG, "No memory for gzip inflater");
+                    http_rx.truncated = true;
+                    break;
+                }
+#if COMPRESSION_SUPPORTED
+                tinfl_init(&http_rx.gzip->inflator);
+#endif
+                http_rx.gzip->stage = GZIP_HEADER_FIXED;
+            }
+            break;
         case HTTP_EVENT_ON_DATA:
-            if (http_response_len + evt->data_len < sizeof(http_response_buffer)) {
-                memcpy(http_response_buffer + http_response_len, evt->data, evt->data_len);
-                http_response_len += evt->data_len;
-                http_response_buffer[http_response_len] = '\0';
+            http_rx.wire_bytes += evt->data_len;
+            if (http_rx.gzip) {
+                gzip_feed(http_rx.gzip, (const uint8_t *)evt->data, evt->data_len);
+            } else if (!http_rx.truncated) {
+                response_append((const uint8_t *)evt->data, evt->data_len);
             }
             break;
         case HTTP_EVENT_ON_FINISH:
-            ESP_LOGI(TAG, "HTTP Response: %s", http_response_buffer);
+            if (esp_log_level_get(TAG) >= ESP_LOG_DEBUG &&
+                esp_log_timestamp() - last_body_dump_ms >= BODY_DUMP_INTERVAL_MS) {
+                last_body_dump_ms = esp_log_timestamp();
+                ESP_LOGD(TAG, "HTTP Response (%d bytes): %.*s", http_response_len, BODY_DUMP_MAX_CHARS,
+                         http_response_buffer);
+            }
             break;
         default:
             break;
@@ -32,8 +312,737 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
+// Copies plain response data, dropping everything once the buffer is full
+static void response_append(const uint8_t *data, size_t len)
+{
+    if (http_response_len + len >= sizeof(http_response_buffer)) {
+        ESP_LOGW(TAG, "Response larger than %d bytes, truncated", (int)sizeof(http_response_buffer) - 1);
+        http_rx.truncated = true;
+        return;
+    }
+    
+    if (len > 0 && http_rx.first_data_us == 0) {
+        http_rx.first_data_us = esp_timer_get_time();
+    }
+    memcpy(http_response_buffer + http_response_len, data, len);
+    http_response_len += len;
+    http_response_buffer[http_response_len] = '\0';
+}
+
+// Skips the gzip member header (RFC 1952) and inflates the deflate stream
+// that follows into http_response_buffer. The trailer is ignored; the TCP
+// and TLS layers already protect the payload.
+static void gzip_feed(gzip_stream_t *gz, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        switch (gz->stage) {
+            case GZIP_HEADER_FIXED: {
+                uint8_t b = *data++;
+                len--;
+                if ((gz->field_pos == 0 && b != 0x1f) || (gz->field_pos == 1 && b != 0x8b) ||
+                    (gz->field_pos == 2 && b != 8)) {
+                    ESP_LOGE(TAG, "Response is not a gzip stream");
+                    http_rx.truncated = true;
+                    gz->stage = GZIP_DONE;
+                    return;
+                }
+                if (gz->field_pos == 3) {
+                    gz->flags = b;
+                }
+                if (++gz->field_pos == 10) {
+                    gz->field_pos = 0;
+                    gz->stage = GZIP_HEADER_EXTRA_LEN;
+                }
+                break;
+            }
+            case GZIP_HEADER_EXTRA_LEN:
+                if (!(gz->flags & 0x04)) {
+                    gz->stage = GZIP_HEADER_NAME;
+                    break;
+                }
+                gz->field_len |= (uint32_t)*data++ << (8 * gz->field_pos);
+                len--;
+                if (++gz->field_pos == 2) {
+                    gz->field_pos = 0;
+                    gz->stage = GZIP_HEADER_EXTRA;
+                }
+                break;
+            case GZIP_HEADER_EXTRA: {
+                size_t skip = gz->field_len - gz->field_pos;
+                if (skip > len) skip = len;
+                data += skip;
+                len -= skip;
+                gz->field_pos += skip;
+                if (gz->field_pos == gz->field_len) {
+                    gz->field_pos = 0;
+                    gz->stage = GZIP_HEADER_NAME;
+                }
+                break;
+            }
+            case GZIP_HEADER_NAME:
+            case GZIP_HEADER_COMMENT: {
+                uint8_t flag = gz->stage == GZIP_HEADER_NAME ? 0x08 : 0x10;
+                if (gz->flags & flag) {
+                    // Zero-terminated string
+                    uint8_t b = *data++;
+                    len--;
+                    if (b != 0) {
+                        break;
+                    }
+                }
+                gz->stage = gz->stage == GZIP_HEADER_NAME ? GZIP_HEADER_COMMENT : GZIP_HEADER_CRC;
+                break;
+            }
+            case GZIP_HEADER_CRC:
+                if (gz->flags & 0x02) {
+                    data++;
+                    len--;
+                    if (++gz->field_pos < 2) {
+                        break;
+                    }
+                }
+                gz->stage = GZIP_BODY;
+                break;
+            case GZIP_BODY: {
+#if COMPRESSION_SUPPORTED
+                uint8_t *out = (uint8_t *)http_response_buffer;
+                size_t in_size = len;
+                // Keep one byte for the terminator
+                size_t out_size = sizeof(http_response_buffer) - 1 - http_response_len;
+                tinfl_status status = tinfl_decompress(&gz->inflator, data, &in_size, out, out + http_response_len,
+                                                       &out_size,
+                                                       TINFL_FLAG_HAS_MORE_INPUT |
+                                                       TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+                data += in_size;
+                len -= in_size;
+                
+                if (out_size > 0 && http_rx.first_data_us == 0) {
+                    http_rx.first_data_us = esp_timer_get_time();
+                }
+                http_response_len += out_size;
+                http_response_buffer[http_response_len] = '\0';
+                
+                if (status == TINFL_STATUS_DONE) {
+                    gz->stage = GZIP_DONE;
+                } else if (status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+                    ESP_LOGW(TAG, "Inflated response larger than %d bytes, truncated",
+                             (int)sizeof(http_response_buffer) - 1);
+                    http_rx.truncated = true;
+                    gz->stage = GZIP_DONE;
+                } else if (status < 0) {
+                    ESP_LOGE(TAG, "Corrupt gzip response (%d)", status);
+                    http_rx.truncated = true;
+                    gz->stage = GZIP_DONE;
+                }
+#else
+                // Never requested without an inflater; drop it if sent anyway
+                http_rx.truncated = true;
+                gz->stage = GZIP_DONE;
+#endif
+                break;
+            }
+            case GZIP_DONE:
+                // Trailer (CRC32 + ISIZE) or data after an error
+                return;
+        }
+    }
+}
+
+// zlib-deflates a request body. Returns NULL when the compressor can't be
+// allocated or the body doesn't shrink, in which case it is sent as is.
+static char *deflate_body(const char *body, size_t len, size_t *out_len)
+{
+#if !DEFLATE_REQUESTS_SUPPORTED
+    return NULL;
+#else
+    // The compressor state lives in PSRAM for the call only
+    tdefl_compressor *comp = (tdefl_compressor *)heap_caps_malloc(sizeof(tdefl_compressor),
+                                                                  MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!comp) {
+        return NULL;
+    }
+    
+    char *out = (char *)malloc(len);
+    if (!out) {
+        heap_caps_free(comp);
+        return NULL;
+    }
+    
+    size_t in_size = len;
+    size_t out_size = len;
+    tdefl_init(comp, NULL, NULL, TDEFL_WRITE_ZLIB_HEADER | DEFLATE_PROBES);
+    tdefl_status status = tdefl_compress(comp, body, &in_size, out, &out_size, TDEFL_FINISH);
+    heap_caps_free(comp);
+    
+    if (status != TDEFL_STATUS_DONE) {
+        free(out);
+        return NULL;
+    }
+    
+    *out_len = out_size;
+    return out;
+#endif
+}
+
+// Runs a request with adaptive per-attempt timeouts, retrying idempotent
+// requests until deadline_ms (0 = endpoint default). Caller holds http_mutex.
+static esp_err_t http_request(nm_endpoint_t endpoint, const char *url, esp_http_client_method_t method,
+                              const char *body, uint32_t deadline_ms, int *status_code)
+{
+    const endpoint_config_t *cfg = &endpoint_configs[endpoint];
+    uint32_t start_ms = esp_log_timestamp();
+    if (deadline_ms == 0) {
+        deadline_ms = cfg->max_timeout_ms;
+    }
+    
+    // Deflate once, retries reuse the compressed body
+    size_t raw_len = body ? strlen(body) : 0;
+    http_body_t request_body = { body, raw_len, false };
+    char *deflated = NULL;
+    if (DEFLATE_REQUESTS_SUPPORTED && body && compression_enabled && raw_len >= DEFLATE_MIN_BODY_BYTES) {
+        size_t deflated_len = 0;
+        deflated = deflate_body(body, raw_len, &deflated_len);
+        if (deflated) {
+            request_body.data = deflated;
+            request_body.len = deflated_len;
+            request_body.deflated = true;
+        }
+    }
+    
+    int max_attempts = cfg->idempotent ? RTT_MAX_ATTEMPTS : 1;
+    esp_err_t err = ESP_FAIL;
+    bool success = false;
+    bool attempted = false;
+    
+    for (int attempt = 0; attempt < max_attempts; attempt++) {
+        uint32_t elapsed_ms = esp_log_timestamp() - start_ms;
+        if (elapsed_ms >= deadline_ms) {
+            break;
+        }
+        
+        if (attempt > 0) {
+            // Full jitter, never sleeping past the deadline
+            uint32_t backoff_ms = esp_random() % (RTT_RETRY_BASE_MS << attempt);
+            if (elapsed_ms + backoff_ms >= deadline_ms) {
+                break;
+            }
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+            elapsed_ms = esp_log_timestamp() - start_ms;
+            
+            portENTER_CRITICAL(&stats_lock);
+            endpoint_stats[endpoint].retries++;
+            portEXIT_CRITICAL(&stats_lock);
+            ESP_LOGW(TAG, "Retrying %s (attempt %d)", cfg->name, attempt + 1);
+        }
+        
+        uint32_t timeout_ms = rtt_timeout_ms(endpoint);
+        if (timeout_ms > deadline_ms - elapsed_ms) {
+            timeout_ms = deadline_ms - elapsed_ms;
+        }
+        
+        uint32_t attempt_start_ms = esp_log_timestamp();
+        err = http_attempt(url, method, body ? &request_body : NULL, timeout_ms, status_code);
+        uint32_t rtt_ms = esp_log_timestamp() - attempt_start_ms;
+        
+        stats_record_attempt(endpoint, err, *status_code, request_body.len, raw_len);
+        
+        if (err == ESP_ERR_INVALID_STATE) {
+            // Circuit open; retrying would fail fast as well
+            break;
+        }
+        attempted = true;
+        
+        if (err == ESP_OK && *status_code > 0) {
+            rtt_record_sample(endpoint, rtt_ms);
+            if (*status_code < 500) {
+                success = true;
+                break;
+            }
+        } else if (rtt_ms >= timeout_ms) {
+            rtt_record_timeout(endpoint);
+        }
+    }
+    
+    free(deflated);
+    
+    // Any HTTP answer below 500 means the backend itself is up
+    if (attempted) {
+        health_record_outcome(success);
+    }
+    
+    if (success) {
+        return ESP_OK;
+    }
+    
+    // Refused before any I/O: not a request outcome
+    portENTER_CRITICAL(&stats_lock);
+    if (attempted) {
+        endpoint_stats[endpoint].failures++;
+    } else {
+        endpoint_stats[endpoint].skipped++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    
+    return err == ESP_OK ? ESP_FAIL : err;
+}
+
+// One HTTP exchange against the shared response buffer
+static esp_err_t http_attempt(const char *url, esp_http_client_method_t method, const http_body_t *body,
+                              int timeout_ms, int *status_code)
+{
+    *status_code = 0;
+    
+    http_rx.wire_bytes = 0;
+    http_rx.start_us = esp_timer_get_time();
+    http_rx.dns_done_us = 0;
+    http_rx.connected_us = 0;
+    http_rx.first_header_us = 0;
+    http_rx.first_data_us = 0;
+    http_rx.end_us = 0;
+    
+    if (!circuit_allows_request()) {
+        ESP_LOGW(TAG, "Backend unavailable, failing fast");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    http_response_len = 0;
+    memset(http_response_buffer, 0, sizeof(http_response_buffer));
+    http_rx.truncated = false;
+    
+    TRACE_BEGIN(TRACE_HTTP_REQUEST, method);
+#if CONFIG_PM_ENABLE
+    if (http_pm_lock) esp_pm_lock_acquire(http_pm_lock);
+#endif
+    dns_resolve(url);
+    
+    esp_http_client_config_t config = {};
+    config.url = url;
+    config.method = method;
+    config.timeout_ms = timeout_ms;
+    config.event_handler = http_event_handler;
+    
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+#if CONFIG_PM_ENABLE
+        if (http_pm_lock) esp_pm_lock_release(http_pm_lock);
+#endif
+        TRACE_END(TRACE_HTTP_REQUEST);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    if (compression_enabled) {
+        esp_http_client_set_header(client, "Accept-Encoding", "gzip");
+    }
+    
+    if (body) {
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+        if (body->deflated) {
+            esp_http_client_set_header(client, "Content-Encoding", "deflate");
+        }
+        esp_http_client_set_post_field(client, body->data, body->len);
+    }
+    
+    esp_err_t err = esp_http_client_perform(client);
+    http_rx.end_us = esp_timer_get_time();
+    *status_code = esp_http_client_get_status_code(client);
+    esp_http_client_cleanup(client);
+#if CONFIG_PM_ENABLE
+    if (http_pm_lock) esp_pm_lock_release(http_pm_lock);
+#endif
+    radio_scheduler_note_traffic(http_rx.start_us, http_rx.end_us);
+    TRACE_END(TRACE_HTTP_REQUEST);
+    
+    free(http_rx.gzip);
+    http_rx.gzip = NULL;
+    
+    return err;
+}
+
+// Resolves the URL's host up front so the lookup can be timed on its own;
+// the answer lands in the lwIP DNS cache that esp_http_client then hits
+static void dns_resolve(const char *url)
+{
+    const char *host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    
+    char hostname[128];
+    size_t len = strcspn(host, ":/?");
+    if (len == 0 || len >= sizeof(hostname)) {
+        return;
+    }
+    memcpy(hostname, host, len);
+    hostname[len] = '\0';
+    
+    struct in_addr addr;
+    if (inet_pton(AF_INET, hostname, &addr) == 1) {
+        // IP literal, nothing to resolve
+        http_rx.dns_done_us = esp_timer_get_time();
+        return;
+    }
+    
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(hostname, NULL, &hints, &res) == 0) {
+        http_rx.dns_done_us = esp_timer_get_time();
+        freeaddrinfo(res);
+    } else {
+        ESP_LOGW(TAG, "DNS lookup failed for %s", hostname);
+    }
+}
+
+static inline uint32_t phase_ms(int64_t from_us, int64_t to_us)
+{
+    return (from_us && to_us > from_us) ? (uint32_t)((to_us - from_us) / 1000) : 0;
+}
+
+static inline void phase_smooth(uint32_t *avg_ms, uint32_t sample_ms)
+{
+    *avg_ms = *avg_ms ? (7 * *avg_ms + sample_ms) / 8 : sample_ms;
+}
+
+static void stats_record_attempt(nm_endpoint_t endpoint, esp_err_t err, int status_code,
+                                 size_t bytes_sent, size_t bytes_sent_raw)
+{
+    if (err == ESP_ERR_INVALID_STATE) {
+        // Circuit open, nothing was sent; http_request counts the call as skipped
+        return;
+    }
+    
+    // Phases: DNS | connect (TCP + TLS) | first response byte | rest of the body
+    int64_t dns_end_us = http_rx.dns_done_us ? http_rx.dns_done_us : http_rx.start_us;
+    uint32_t dns_ms = phase_ms(http_rx.start_us, http_rx.dns_done_us);
+    uint32_t connect_ms = phase_ms(dns_end_us, http_rx.connected_us);
+    uint32_t ttfb_ms = phase_ms(http_rx.start_us, http_rx.first_header_us);
+    uint32_t first_data_ms = phase_ms(http_rx.start_us, http_rx.first_data_us);
+    uint32_t total_ms = phase_ms(http_rx.start_us, http_rx.end_us);
+    
+    // Bucket i counts latencies in [2^i, 2^(i+1)) ms, the last one everything above
+    int bucket = 0;
+    while (bucket < NM_LATENCY_BUCKETS - 1 && (total_ms >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    
+    portENTER_CRITICAL(&stats_lock);
+    nm_endpoint_stats_t *st = &endpoint_stats[endpoint];
+    st->requests++;
+    st->bytes_sent += bytes_sent;
+    st->bytes_sent_raw += bytes_sent_raw;
+    st->bytes_received += http_rx.wire_bytes;
+    st->bytes_decoded += http_response_len;
+    st->latency_hist[bucket]++;
+    st->latency_sum_ms += total_ms;
+    phase_smooth(&st->total_ms, total_ms);
+    if (http_rx.dns_done_us) phase_smooth(&st->dns_ms, dns_ms);
+    if (http_rx.connected_us) phase_smooth(&st->connect_ms, connect_ms);
+    if (http_rx.first_header_us) phase_smooth(&st->ttfb_ms, ttfb_ms);
+    if (http_rx.first_data_us) phase_smooth(&st->first_data_ms, first_data_ms);
+    
+    if (err == ESP_OK && status_code >= 100 && status_code < 600) {
+        st->status_classes[status_code / 100 - 1]++;
+    } else {
+        st->transport_errors++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    
+    energy_account_add_us(ENERGY_RAIL_WIFI_TX, energy_wifi_tx_airtime_us(bytes_sent));
+    
+    ESP_LOGD(TAG, "%s: status %d, dns %lu, connect %lu, ttfb %lu, total %lu ms, %lu/%lu bytes out/in",
+             endpoint_configs[endpoint].name, status_code, (unsigned long)dns_ms, (unsigned long)connect_ms,
+             (unsigned long)ttfb_ms, (unsigned long)total_ms, (unsigned long)bytes_sent,
+             (unsigned long)http_rx.wire_bytes);
+}
+
+static uint32_t rtt_timeout_ms(nm_endpoint_t endpoint)
+{
+    portENTER_CRITICAL(&stats_lock);
+    uint32_t timeout_ms = endpoint_stats[endpoint].timeout_ms;
+    portEXIT_CRITICAL(&stats_lock);
+    
+    return timeout_ms ? timeout_ms : endpoint_configs[endpoint].max_timeout_ms;
+}
+
+static void rtt_record_sample(nm_endpoint_t endpoint, uint32_t rtt_ms)
+{
+    const endpoint_config_t *cfg = &endpoint_configs[endpoint];
+    
+    portENTER_CRITICAL(&stats_lock);
+    nm_endpoint_stats_t *st = &endpoint_stats[endpoint];
+    if (st->srtt_ms == 0) {
+        st->srtt_ms = rtt_ms ? rtt_ms : 1;
+        st->rttvar_ms = rtt_ms / 2;
+    } else {
+        uint32_t delta = st->srtt_ms > rtt_ms ? st->srtt_ms - rtt_ms : rtt_ms - st->srtt_ms;
+        st->rttvar_ms = (3 * st->rttvar_ms + delta) / 4;
+        st->srtt_ms = (7 * st->srtt_ms + rtt_ms) / 8;
+    }
+    
+    uint32_t variance = 4 * st->rttvar_ms > RTT_CLOCK_GRANULARITY ? 4 * st->rttvar_ms : RTT_CLOCK_GRANULARITY;
+    uint32_t timeout_ms = st->srtt_ms + variance;
+    if (timeout_ms < cfg->min_timeout_ms) timeout_ms = cfg->min_timeout_ms;
+    if (timeout_ms > cfg->max_timeout_ms) timeout_ms = cfg->max_timeout_ms;
+    st->timeout_ms = timeout_ms;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void rtt_record_timeout(nm_endpoint_t endpoint)
+{
+    const endpoint_config_t *cfg = &endpoint_configs[endpoint];
+    
+    // Back off the timeout (Karn); the timed out attempt gives no sample
+    portENTER_CRITICAL(&stats_lock);
+    nm_endpoint_stats_t *st = &endpoint_stats[endpoint];
+    st->timeouts++;
+    uint32_t timeout_ms = (st->timeout_ms ? st->timeout_ms : cfg->max_timeout_ms) * 2;
+    st->timeout_ms = timeout_ms > cfg->max_timeout_ms ? cfg->max_timeout_ms : timeout_ms;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+bool network_manager_get_endpoint_stats(nm_endpoint_t endpoint, nm_endpoint_stats_t *stats)
+{
+    if (endpoint >= NM_ENDPOINT_COUNT || !stats) {
+        return false;
+    }
+    
+    portENTER_CRITICAL(&stats_lock);
+    *stats = endpoint_stats[endpoint];
+    portEXIT_CRITICAL(&stats_lock);
+    
+    if (stats->timeout_ms == 0) {
+        stats->timeout_ms = endpoint_configs[endpoint].max_timeout_ms;
+    }
+    return true;
+}
+
+const char *network_manager_endpoint_name(nm_endpoint_t endpoint)
+{
+    return endpoint < NM_ENDPOINT_COUNT ? endpoint_configs[endpoint].name : "?";
+}
+
+// Upper bound of the bucket holding the pct-th percentile, 0 without samples
+static uint32_t latency_percentile_ms(const nm_endpoint_stats_t *st, int pct)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < NM_LATENCY_BUCKETS; i++) {
+        count += st->latency_hist[i];
+    }
+    if (count == 0) {
+        return 0;
+    }
+    
+    uint32_t rank = (count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < NM_LATENCY_BUCKETS; i++) {
+        seen += st->latency_hist[i];
+        if (seen >= rank) {
+            return 1UL << (i + 1);
+        }
+    }
+    return 1UL << NM_LATENCY_BUCKETS;
+}
+
+void network_manager_log_diagnostics(void)
+{
+    ESP_LOGI(TAG, "%-14s %6s %6s %7s %6s %6s %6s %6s %6s", "endpoint", "srtt", "rttvar", "timeout",
+             "reqs", "tmo", "retry", "fail", "skip");
+    
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        nm_endpoint_stats_t st;
+        network_manager_get_endpoint_stats((nm_endpoint_t)i, &st);
+        ESP_LOGI(TAG, "%-14s %6lu %6lu %7lu %6lu %6lu %6lu %6lu %6lu", endpoint_configs[i].name,
+                 (unsigned long)st.srtt_ms, (unsigned long)st.rttvar_ms, (unsigned long)st.timeout_ms,
+                 (unsigned long)st.requests, (unsigned long)st.timeouts, (unsigned long)st.retries,
+                 (unsigned long)st.failures, (unsigned long)st.skipped);
+    }
+    
+    ESP_LOGI(TAG, "%-14s %5s %5s %5s %5s %5s %6s %6s %6s", "endpoint", "dns", "conn", "ttfb", "ttfd",
+             "total", "p50<", "p90<", "p99<");
+    
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        nm_endpoint_stats_t st;
+        network_manager_get_endpoint_stats((nm_endpoint_t)i, &st);
+        ESP_LOGI(TAG, "%-14s %5lu %5lu %5lu %5lu %5lu %6lu %6lu %6lu", endpoint_configs[i].name,
+                 (unsigned long)st.dns_ms, (unsigned long)st.connect_ms, (unsigned long)st.ttfb_ms,
+                 (unsigned long)st.first_data_ms, (unsigned long)st.total_ms,
+                 (unsigned long)latency_percentile_ms(&st, 50), (unsigned long)latency_percentile_ms(&st, 90),
+                 (unsigned long)latency_percentile_ms(&st, 99));
+    }
+    
+    ESP_LOGI(TAG, "%-14s %8s %8s %8s %8s %5s %5s %5s %5s (compression %s)", "endpoint", "tx", "tx_raw",
+             "rx", "rx_dec", "2xx", "4xx", "5xx", "err", compression_enabled ? "on" : "off");
+    
+    for (int i = 0; i < NM_ENDPOINT_COUNT; i++) {
+        nm_endpoint_stats_t st;
+        network_manager_get_endpoint_stats((nm_endpoint_t)i, &st);
+        ESP_LOGI(TAG, "%-14s %8lu %8lu %8lu %8lu %5lu %5lu %5lu %5lu", endpoint_configs[i].name,
+                 (unsigned long)st.bytes_sent, (unsigned long)st.bytes_sent_raw,
+                 (unsigned long)st.bytes_received, (unsigned long)st.bytes_decoded,
+                 (unsigned long)st.status_classes[1], (unsigned long)st.status_classes[3],
+                 (unsigned long)st.status_classes[4], (unsigned long)st.transport_errors);
+    }
+    
+    nm_push_stats_t push;
+    network_manager_get_push_stats(&push);
+    ESP_LOGI(TAG, "push channel %s: %lu connects, %lu drops, %lu pushes, %lu/%lu frames in/out, %lu/%lu bytes in/out",
+             push_connected ? "up" : "down", (unsigned long)push.connects, (unsigned long)push.disconnects,
+             (unsigned long)push.pushes, (unsigned long)push.frames_in, (unsigned long)push.frames_out,
+             (unsigned long)push.bytes_in, (unsigned long)push.bytes_out);
+}
+
+void network_manager_set_first_byte_callback(nm_first_byte_callback_t callback)
+{
+    first_byte_callback = callback;
+}
+
+void network_manager_set_compression(bool enabled)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    compression_enabled = enabled && COMPRESSION_SUPPORTED;
+    xSemaphoreGive(http_mutex);
+    ESP_LOGI(TAG, "Body compression %s", enabled ? "enabled" : "disabled");
+}
+
+static bool circuit_allows_request(void)
+{
+    bool allowed = true;
+    uint32_t now_ms = esp_log_timestamp();
+    
+    portENTER_CRITICAL(&health_lock);
+    if (circuit_state == CIRCUIT_OPEN) {
+        if ((int32_t)(now_ms - retry_at_ms) >= 0) {
+            // Let one trial request through
+            circuit_state = CIRCUIT_HALF_OPEN;
+        } else {
+            allowed = false;
+        }
+    }
+    portEXIT_CRITICAL(&health_lock);
+    
+    return allowed;
+}
+
+static void health_record_outcome(bool reached_backend)
+{
+    uint32_t now_ms = esp_log_timestamp();
+    circuit_state_t previous;
+    circuit_state_t current;
+    uint32_t retry_in_ms = 0;
+    
+    portENTER_CRITICAL(&health_lock);
+    previous = circuit_state;
+    last_outcome_ms = now_ms;
+    
+    if (reached_backend) {
+        consecutive_failures = 0;
+        backoff_ms = HEALTH_BACKOFF_BASE_MS;
+        circuit_state = CIRCUIT_CLOSED;
+        backend_seen_up = true;
+    } else {
+        consecutive_failures++;
+        if (circuit_state == CIRCUIT_HALF_OPEN || consecutive_failures >= HEALTH_FAILURE_THRESHOLD) {
+            if (circuit_state == CIRCUIT_HALF_OPEN) {
+                backoff_ms = backoff_ms * 2 > HEALTH_BACKOFF_MAX_MS ? HEALTH_BACKOFF_MAX_MS : backoff_ms * 2;
+            }
+            // Equal jitter: wait between half and all of the backoff
+            retry_in_ms = backoff_ms / 2 + esp_random() % (backoff_ms / 2 + 1);
+            retry_at_ms = now_ms + retry_in_ms;
+            circuit_state = CIRCUIT_OPEN;
+        }
+    }
+    current = circuit_state;
+    portEXIT_CRITICAL(&health_lock);
+    
+    if (current == CIRCUIT_OPEN && previous != CIRCUIT_OPEN) {
+        ESP_LOGW(TAG, "Backend marked down, retrying in %lu ms", (unsigned long)retry_in_ms);
+    } else if (current == CIRCUIT_CLOSED && previous != CIRCUIT_CLOSED) {
+        ESP_LOGI(TAG, "Backend is back up");
+    }
+}
+
+backend_health_t network_manager_get_backend_health(void)
+{
+    backend_health_t health;
+    
+    portENTER_CRITICAL(&health_lock);
+    if (circuit_state != CIRCUIT_CLOSED) {
+        health = BACKEND_HEALTH_DOWN;
+    } else if (consecutive_failures > 0) {
+        health = BACKEND_HEALTH_DEGRADED;
+    } else if (backend_seen_up) {
+        health = BACKEND_HEALTH_UP;
+    } else {
+        health = BACKEND_HEALTH_UNKNOWN;
+    }
+    portEXIT_CRITICAL(&health_lock);
+    
+    return health;
+}
+
+bool network_manager_backend_available(void)
+{
+    return network_manager_get_backend_health() != BACKEND_HEALTH_DOWN;
+}
+
+uint32_t network_manager_health_poll(bool link_up)
+{
+    if (!link_up) {
+        return HEALTH_LINK_DOWN_POLL_MS;
+    }
+    
+    uint32_t now_ms = esp_log_timestamp();
+    uint32_t due_ms = health_probe_due_ms(now_ms);
+    if ((int32_t)(due_ms - now_ms) > 0) {
+        return due_ms - now_ms;
+    }
+    
+    // Idle (or due for a retry): probe in the next radio window
+    uint32_t max_delay_ms = network_manager_get_backend_health() == BACKEND_HEALTH_DOWN ? HEALTH_RETRY_MAX_DELAY_MS
+                                                                                         : HEALTH_PROBE_MAX_DELAY_MS;
+    return radio_scheduler_defer(health_probe_job, max_delay_ms) + HEALTH_PROBE_SETTLE_MS;
+}
+
+static uint32_t health_probe_due_ms(uint32_t now_ms)
+{
+    uint32_t due_ms;
+    
+    portENTER_CRITICAL(&health_lock);
+    if (circuit_state == CIRCUIT_OPEN) {
+        due_ms = retry_at_ms;
+    } else if (!backend_seen_up && consecutive_failures == 0) {
+        // Nothing known yet; probe right away
+        due_ms = now_ms;
+    } else {
+        due_ms = last_outcome_ms + HEALTH_IDLE_PROBE_MS;
+    }
+    portEXIT_CRITICAL(&health_lock);
+    
+    return due_ms;
+}
+
+static void health_probe_job_run(void *arg)
+{
+    // Traffic since the probe was deferred may have answered it already
+    uint32_t now_ms = esp_log_timestamp();
+    if ((int32_t)(health_probe_due_ms(now_ms) - now_ms) > 0) {
+        return;
+    }
+    network_manager_test_connectivity();
+}
+
 void network_manager_init(const char *backend_url)
 {
+    if (!http_mutex) {
+        http_mutex = xSemaphoreCreateMutex();
+        governor_mutex = xSemaphoreCreateMutex();
+#if CONFIG_PM_ENABLE
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "http", &http_pm_lock);
+#endif
+        radio_scheduler_init();
+        gps_upload_job = radio_scheduler_register("gps_upload", gps_upload_job_run, NULL);
+        health_probe_job = radio_scheduler_register("health_probe", health_probe_job_run, NULL);
+    }
+    
     if (backend_url) {
         strncpy(backend_base_url, backend_url, sizeof(backend_base_url) - 1);
         backend_base_url[sizeof(backend_base_url) - 1] = '\0';
@@ -42,6 +1051,68 @@ void network_manager_init(const char *backend_url)
 }
 
 bool network_manager_test_connectivity(void)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    bool success = test_connectivity_locked();
+    xSemaphoreGive(http_mutex);
+    return success;
+}
+
+bool network_manager_send_gps_data(const gps_data_t *gps_data)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    bool success = send_gps_data_locked(gps_data);
+    xSemaphoreGive(http_mutex);
+    return success;
+}
+
+bool network_manager_save_location(const gps_data_t *gps_data)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    bool success = save_location_locked(gps_data);
+    xSemaphoreGive(http_mutex);
+    return success;
+}
+
+bool network_manager_select_target_location(target_data_t *target)
+{
+    return network_manager_select_target_location_within(target, 0);
+}
+
+bool network_manager_select_target_location_within(target_data_t *target, uint32_t deadline_ms)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    // The backend picks the target from the latest uploaded position, so a
+    // fix still waiting for its radio window goes out first
+    gps_upload_flush(true);
+    bool success = select_target_location_locked(target, deadline_ms);
+    xSemaphoreGive(http_mutex);
+    return success;
+}
+
+bool network_manager_check_location_safety(const gps_data_t *gps_data, safety_data_t *safety)
+{
+    return network_manager_check_location_safety_within(gps_data, safety, 0);
+}
+
+bool network_manager_check_location_safety_within(const gps_data_t *gps_data, safety_data_t *safety,
+                                                  uint32_t deadline_ms)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    bool success = check_location_safety_locked(gps_data, safety, deadline_ms);
+    xSemaphoreGive(http_mutex);
+    return success;
+}
+
+bool network_manager_generate_sidequest(const gps_data_t *gps_data, sidequest_data_t *sidequest)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    bool success = generate_sidequest_locked(gps_data, sidequest);
+    xSemaphoreGive(http_mutex);
+    return success;
+}
+
+static bool test_connectivity_locked(void)
 {
     if (strlen(backend_base_url) == 0) {
         ESP_LOGE(TAG, "Backend URL not configured");
@@ -51,19 +1122,8 @@ bool network_manager_test_connectivity(void)
     char url[512];
     snprintf(url, sizeof(url), "%s/health", backend_base_url);
     
-    http_response_len = 0;
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 5000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    int status_code = 0;
+    esp_err_t err = http_request(NM_ENDPOINT_HEALTH, url, HTTP_METHOD_GET, NULL, 0, &status_code);
     
     bool success = (err == ESP_OK && status_code == 200);
     ESP_LOGI(TAG, "Backend connectivity test: %s (status: %d)", success ? "OK" : "FAILED", status_code);
@@ -71,7 +1131,7 @@ bool network_manager_test_connectivity(void)
     return success;
 }
 
-bool network_manager_send_gps_data(const gps_data_t *gps_data)
+static bool send_gps_data_locked(const gps_data_t *gps_data)
 {
     if (!gps_data || !gps_data->valid) {
         ESP_LOGE(TAG, "Invalid GPS data");
@@ -97,7 +1157,7 @@ bool network_manager_send_gps_data(const gps_data_t *gps_data)
     cJSON_AddItemToObject(json, "source", source);
     cJSON_AddItemToObject(json, "deviceId", device_id);
     
-    char *json_string = cJSON_Print(json);
+    char *json_string = cJSON_PrintUnformatted(json);
     cJSON_Delete(json);
     
     if (!json_string) {
@@ -105,33 +1165,18 @@ bool network_manager_send_gps_data(const gps_data_t *gps_data)
         return false;
     }
     
-    http_response_len = 0;
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 10000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_string, strlen(json_string));
-    
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    int status_code = 0;
+    esp_err_t err = http_request(NM_ENDPOINT_GPS, url, HTTP_METHOD_POST, json_string, 0, &status_code);
     
     free(json_string);
     
     bool success = (err == ESP_OK && (status_code == 200 || status_code == 201));
-    ESP_LOGI(TAG, "GPS data send: %s (status: %d)", success ? "OK" : "FAILED", status_code);
+    BINLOG_I(TAG, "GPS data send: %s (status: %d)", success ? "OK" : "FAILED", status_code);
     
     return success;
 }
 
-bool network_manager_save_location(const gps_data_t *gps_data)
+static bool save_location_locked(const gps_data_t *gps_data)
 {
     if (!gps_data || !gps_data->valid) {
         ESP_LOGE(TAG, "Invalid GPS data for location save");
@@ -154,31 +1199,16 @@ bool network_manager_save_location(const gps_data_t *gps_data)
     cJSON_AddItemToObject(json, "source", cJSON_CreateString("esp32"));
     cJSON_AddItemToObject(json, "deviceId", cJSON_CreateString(gps_data->device_id));
     
-    char *json_string = cJSON_Print(json);
+    char *json_string = cJSON_PrintUnformatted(json);
     cJSON_Delete(json);
     
     if (!json_string) {
-        ESP_LOGE(TAG, "Failed to create location JSON payload");
-        return false;
-    }
-    
-    http_response_len = 0;
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 10000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_string, strlen(json_string));
+        ESP_LOGE(TAG, "Failed to create location JSON payload");
+        return false;
+    }
     
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    int status_code = 0;
+    esp_err_t err = http_request(NM_ENDPOINT_LOCATION_SAVE, url, HTTP_METHOD_POST, json_string, 0, &status_code);
     
     free(json_string);
     
@@ -188,7 +1218,7 @@ bool network_manager_save_location(const gps_data_t *gps_data)
     return success;
 }
 
-bool network_manager_select_target_location(target_data_t *target)
+static bool select_target_location_locked(target_data_t *target, uint32_t deadline_ms)
 {
     if (!target) {
         ESP_LOGE(TAG, "Invalid target pointer");
@@ -198,19 +1228,8 @@ bool network_manager_select_target_location(target_data_t *target)
     char url[512];
     snprintf(url, sizeof(url), "%s/api/locations", backend_base_url);
     
-    http_response_len = 0;
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 10000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    int status_code = 0;
+    esp_err_t err = http_request(NM_ENDPOINT_LOCATION_LIST, url, HTTP_METHOD_GET, NULL, deadline_ms, &status_code);
     
     if (err != ESP_OK || status_code != 200) {
         ESP_LOGE(TAG, "Failed to fetch locations (status: %d)", status_code);
@@ -238,31 +1257,16 @@ bool network_manager_select_target_location(target_data_t *target)
     }
     
     // Use the first location (TODO: implement location selection screen)
-    cJSON *first_location = cJSON_GetArrayItem(locations, 0);
-    if (first_location) {
-        cJSON *name = cJSON_GetObjectItem(first_location, "name");
-        cJSON *id = cJSON_GetObjectItem(first_location, "_id");
-        cJSON *lat = cJSON_GetObjectItem(first_location, "latitude");
-        cJSON *lng = cJSON_GetObjectItem(first_location, "longitude");
-        
-        if (name && id && lat && lng) {
-            strncpy(target->name, cJSON_GetStringValue(name), sizeof(target->name) - 1);
-            strncpy(target->id, cJSON_GetStringValue(id), sizeof(target->id) - 1);
-            target->latitude = cJSON_GetNumberValue(lat);
-            target->longitude = cJSON_GetNumberValue(lng);
-            target->active = true;
-            
-            ESP_LOGI(TAG, "Selected target: %s at %.6f, %.6f", target->name, target->latitude, target->longitude);
-            cJSON_Delete(json);
-            return true;
-        }
+    bool success = parse_target(cJSON_GetArrayItem(locations, 0), target);
+    if (success) {
+        ESP_LOGI(TAG, "Selected target: %s at %.6f, %.6f", target->name, target->latitude, target->longitude);
     }
     
     cJSON_Delete(json);
-    return false;
+    return success;
 }
 
-bool network_manager_check_location_safety(const gps_data_t *gps_data, safety_data_t *safety)
+static bool check_location_safety_locked(const gps_data_t *gps_data, safety_data_t *safety, uint32_t deadline_ms)
 {
     if (!gps_data || !gps_data->valid || !safety) {
         ESP_LOGE(TAG, "Invalid parameters for safety check");
@@ -273,19 +1277,8 @@ bool network_manager_check_location_safety(const gps_data_t *gps_data, safety_da
     snprintf(url, sizeof(url), "%s/api/safety/analyze-location?lat=%.6f&lng=%.6f", 
              backend_base_url, gps_data->latitude, gps_data->longitude);
     
-    http_response_len = 0;
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 15000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    int status_code = 0;
+    esp_err_t err = http_request(NM_ENDPOINT_SAFETY, url, HTTP_METHOD_GET, NULL, deadline_ms, &status_code);
     
     if (err != ESP_OK || status_code != 200) {
         ESP_LOGE(TAG, "Safety check failed (status: %d)", status_code);
@@ -301,24 +1294,7 @@ bool network_manager_check_location_safety(const gps_data_t *gps_data, safety_da
     
     cJSON *data = cJSON_GetObjectItem(json, "data");
     if (data) {
-        cJSON *risk_score = cJSON_GetObjectItem(data, "riskScore");
-        cJSON *time_risk = cJSON_GetObjectItem(data, "timeRisk");
-        cJSON *warnings = cJSON_GetObjectItem(data, "warnings");
-        cJSON *hazards = cJSON_GetObjectItem(data, "hazards");
-        cJSON *emergency_services = cJSON_GetObjectItem(data, "emergencyServices");
-        
-        if (risk_score) safety->risk_score = cJSON_GetNumberValue(risk_score);
-        if (time_risk) strncpy(safety->time_risk, cJSON_GetStringValue(time_risk), sizeof(safety->time_risk) - 1);
-        if (warnings) strncpy(safety->warnings, cJSON_GetStringValue(warnings), sizeof(safety->warnings) - 1);
-        if (hazards) strncpy(safety->hazards, cJSON_GetStringValue(hazards), sizeof(safety->hazards) - 1);
-        
-        if (emergency_services) {
-            cJSON *nearby = cJSON_GetObjectItem(emergency_services, "nearby");
-            if (nearby) safety->has_emergency_services = cJSON_IsTrue(nearby);
-        }
-        
-        safety->last_check = esp_log_timestamp();
-        
+        parse_safety(data, safety);
         ESP_LOGI(TAG, "Safety analysis complete: risk=%.1f", safety->risk_score);
         cJSON_Delete(json);
         return true;
@@ -328,50 +1304,20 @@ bool network_manager_check_location_safety(const gps_data_t *gps_data, safety_da
     return false;
 }
 
-bool network_manager_generate_sidequest(const gps_data_t *gps_data, sidequest_data_t *sidequest)
+static bool generate_sidequest_locked(const gps_data_t *gps_data, sidequest_data_t *sidequest)
 {
     if (!gps_data || !gps_data->valid || !sidequest) {
         ESP_LOGE(TAG, "Invalid parameters for sidequest generation");
         return false;
     }
     
+    // The backend takes the position as query parameters, no body
     char url[512];
-    snprintf(url, sizeof(url), "%s/api/locations/sidequest", backend_base_url);
-    
-    // Create JSON payload
-    cJSON *json = cJSON_CreateObject();
-    cJSON_AddItemToObject(json, "latitude", cJSON_CreateNumber(gps_data->latitude));
-    cJSON_AddItemToObject(json, "longitude", cJSON_CreateNumber(gps_data->longitude));
-    cJSON_AddItemToObject(json, "radius", cJSON_CreateNumber(2000)); // 2km radius
-    cJSON_AddItemToObject(json, "difficulty", cJSON_CreateString("moderate"));
-    
-    char *json_string = cJSON_Print(json);
-    cJSON_Delete(json);
-    
-    if (!json_string) {
-        ESP_LOGE(TAG, "Failed to create sidequest JSON payload");
-        return false;
-    }
-    
-    http_response_len = 0;
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 15000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_string, strlen(json_string));
-    
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    snprintf(url, sizeof(url), "%s/api/sidequest/start?lat=%.6f&lng=%.6f",
+             backend_base_url, gps_data->latitude, gps_data->longitude);
     
-    free(json_string);
+    int status_code = 0;
+    esp_err_t err = http_request(NM_ENDPOINT_SIDEQUEST, url, HTTP_METHOD_POST, NULL, 0, &status_code);
     
     if (err != ESP_OK || status_code != 200) {
         ESP_LOGE(TAG, "Sidequest generation failed (status: %d)", status_code);
@@ -387,32 +1333,544 @@ bool network_manager_generate_sidequest(const gps_data_t *gps_data, sidequest_da
     
     cJSON *data = cJSON_GetObjectItem(response_json, "data");
     if (data) {
-        cJSON *title = cJSON_GetObjectItem(data, "title");
-        cJSON *description = cJSON_GetObjectItem(data, "description");
-        cJSON *difficulty = cJSON_GetObjectItem(data, "difficulty");
-        cJSON *location = cJSON_GetObjectItem(data, "location");
+        parse_sidequest(data, sidequest);
+        ESP_LOGI(TAG, "Sidequest generated: %s", sidequest->title);
+        cJSON_Delete(response_json);
+        return true;
+    }
+    
+    cJSON_Delete(response_json);
+    return false;
+}
+
+// Response parsers shared by the HTTP requests and the push channel
+
+static bool parse_target(const cJSON *item, target_data_t *target)
+{
+    cJSON *name = cJSON_GetObjectItem(item, "name");
+    cJSON *id = cJSON_GetObjectItem(item, "_id");
+    cJSON *lat = cJSON_GetObjectItem(item, "latitude");
+    cJSON *lng = cJSON_GetObjectItem(item, "longitude");
+    
+    if (!cJSON_IsString(name) || !cJSON_IsString(id) || !lat || !lng) {
+        return false;
+    }
+    
+    strncpy(target->name, cJSON_GetStringValue(name), sizeof(target->name) - 1);
+    strncpy(target->id, cJSON_GetStringValue(id), sizeof(target->id) - 1);
+    target->latitude = cJSON_GetNumberValue(lat);
+    target->longitude = cJSON_GetNumberValue(lng);
+    target->active = true;
+    return true;
+}
+
+static void parse_safety(const cJSON *data, safety_data_t *safety)
+{
+    cJSON *risk_score = cJSON_GetObjectItem(data, "riskScore");
+    cJSON *time_risk = cJSON_GetObjectItem(data, "timeRisk");
+    cJSON *warnings = cJSON_GetObjectItem(data, "warnings");
+    cJSON *hazards = cJSON_GetObjectItem(data, "hazards");
+    cJSON *emergency_services = cJSON_GetObjectItem(data, "emergencyServices");
+    
+    if (risk_score) safety->risk_score = cJSON_GetNumberValue(risk_score);
+    if (cJSON_IsString(time_risk)) strncpy(safety->time_risk, cJSON_GetStringValue(time_risk), sizeof(safety->time_risk) - 1);
+    if (cJSON_IsString(warnings)) strncpy(safety->warnings, cJSON_GetStringValue(warnings), sizeof(safety->warnings) - 1);
+    if (cJSON_IsString(hazards)) strncpy(safety->hazards, cJSON_GetStringValue(hazards), sizeof(safety->hazards) - 1);
+    
+    if (emergency_services) {
+        cJSON *nearby = cJSON_GetObjectItem(emergency_services, "nearby");
+        if (nearby) safety->has_emergency_services = cJSON_IsTrue(nearby);
+    }
+    
+    safety->last_check = esp_log_timestamp();
+}
+
+static void parse_sidequest(const cJSON *data, sidequest_data_t *sidequest)
+{
+    cJSON *title = cJSON_GetObjectItem(data, "title");
+    cJSON *description = cJSON_GetObjectItem(data, "description");
+    cJSON *difficulty = cJSON_GetObjectItem(data, "difficulty");
+    cJSON *location = cJSON_GetObjectItem(data, "location");
+    
+    if (cJSON_IsString(title)) strncpy(sidequest->title, cJSON_GetStringValue(title), sizeof(sidequest->title) - 1);
+    if (cJSON_IsString(description)) strncpy(sidequest->description, cJSON_GetStringValue(description), sizeof(sidequest->description) - 1);
+    if (cJSON_IsString(difficulty)) strncpy(sidequest->difficulty, cJSON_GetStringValue(difficulty), sizeof(sidequest->difficulty) - 1);
+    
+    if (location) {
+        cJSON *loc_name = cJSON_GetObjectItem(location, "name");
+        cJSON *loc_lat = cJSON_GetObjectItem(location, "latitude");
+        cJSON *loc_lng = cJSON_GetObjectItem(location, "longitude");
         
-        if (title) strncpy(sidequest->title, cJSON_GetStringValue(title), sizeof(sidequest->title) - 1);
-        if (description) strncpy(sidequest->description, cJSON_GetStringValue(description), sizeof(sidequest->description) - 1);
-        if (difficulty) strncpy(sidequest->difficulty, cJSON_GetStringValue(difficulty), sizeof(sidequest->difficulty) - 1);
+        if (cJSON_IsString(loc_name)) strncpy(sidequest->location, cJSON_GetStringValue(loc_name), sizeof(sidequest->location) - 1);
+        if (loc_lat) sidequest->target_lat = cJSON_GetNumberValue(loc_lat);
+        if (loc_lng) sidequest->target_lng = cJSON_GetNumberValue(loc_lng);
+    }
+    
+    sidequest->active = true;
+}
+
+void network_manager_gps_upload_configure(const gps_upload_policy_t *policy)
+{
+    if (!policy) {
+        return;
+    }
+    
+    xSemaphoreTake(governor_mutex, portMAX_DELAY);
+    upload_policy = *policy;
+    xSemaphoreGive(governor_mutex);
+}
+
+bool network_manager_submit_gps_fix(const gps_data_t *gps_data)
+{
+    if (!gps_data || !gps_data->valid) {
+        return false;
+    }
+    
+    uint32_t now_ms = gps_data->timestamp ? gps_data->timestamp : esp_log_timestamp();
+    
+    xSemaphoreTake(governor_mutex, portMAX_DELAY);
+    
+    // Callers poll the latest fix; only evaluate each fix once
+    if (gps_data->timestamp && gps_data->timestamp == last_seen_timestamp) {
+        xSemaphoreGive(governor_mutex);
+        return false;
+    }
+    last_seen_timestamp = gps_data->timestamp;
+    
+    // Reject jumps that imply an impossible speed. A run of rejections means
+    // the reference fix itself was the outlier, so start over from this one.
+    if (last_plausible_fix.valid) {
+        uint32_t dt_ms = now_ms - last_plausible_fix.timestamp;
+        float jump_m = navigation_calc_distance(last_plausible_fix.latitude, last_plausible_fix.longitude,
+                                                gps_data->latitude, gps_data->longitude) * 1000.0f;
+        if (dt_ms > 0 && jump_m * 1000.0f / dt_ms > upload_policy.max_speed_mps &&
+            consecutive_rejections < GPS_UPLOAD_MAX_REJECTIONS) {
+            consecutive_rejections++;
+            upload_stats.rejected++;
+            xSemaphoreGive(governor_mutex);
+            ESP_LOGW(TAG, "Rejected GPS fix: %.0f m in %lu ms", jump_m, (unsigned long)dt_ms);
+            return false;
+        }
+    }
+    consecutive_rejections = 0;
+    last_plausible_fix = *gps_data;
+    last_plausible_fix.timestamp = now_ms;
+    
+    bool should_send = !last_sent_fix.valid;
+    float heading = -1.0f;
+    if (!should_send) {
+        float moved_m = navigation_calc_distance(last_sent_fix.latitude, last_sent_fix.longitude,
+                                                 gps_data->latitude, gps_data->longitude) * 1000.0f;
+        float threshold_m = fmaxf(upload_policy.min_distance_m, gps_data->accuracy * upload_policy.accuracy_scale);
         
-        if (location) {
-            cJSON *loc_name = cJSON_GetObjectItem(location, "name");
-            cJSON *loc_lat = cJSON_GetObjectItem(location, "latitude");
-            cJSON *loc_lng = cJSON_GetObjectItem(location, "longitude");
-            
-            if (loc_name) strncpy(sidequest->location, cJSON_GetStringValue(loc_name), sizeof(sidequest->location) - 1);
-            if (loc_lat) sidequest->target_lat = cJSON_GetNumberValue(loc_lat);
-            if (loc_lng) sidequest->target_lng = cJSON_GetNumberValue(loc_lng);
+        if (moved_m > upload_policy.min_distance_m / 2) {
+            heading = navigation_calc_bearing(last_sent_fix.latitude, last_sent_fix.longitude,
+                                              gps_data->latitude, gps_data->longitude);
         }
         
-        sidequest->active = true;
+        float turn_deg = 0;
+        if (heading >= 0 && last_sent_heading >= 0) {
+            turn_deg = fabsf(heading - last_sent_heading);
+            if (turn_deg > 180.0f) turn_deg = 360.0f - turn_deg;
+        }
         
-        ESP_LOGI(TAG, "Sidequest generated: %s", sidequest->title);
-        cJSON_Delete(response_json);
+        should_send = moved_m > threshold_m ||
+                      turn_deg > upload_policy.heading_change_deg ||
+                      now_ms - last_sent_fix.timestamp >= upload_policy.heartbeat_ms;
+    }
+    
+    // A fix still waiting for its window is replaced by the newer one
+    if (!should_send && !upload_pending) {
+        upload_stats.suppressed++;
+        xSemaphoreGive(governor_mutex);
+        return false;
+    }
+    if (upload_pending) {
+        upload_stats.coalesced++;
+    }
+    pending_fix = *gps_data;
+    pending_fix_ms = now_ms;
+    pending_heading = heading;
+    upload_pending = true;
+    xSemaphoreGive(governor_mutex);
+    
+    radio_scheduler_defer(gps_upload_job, GPS_UPLOAD_MAX_DELAY_MS);
+    return true;
+}
+
+static void gps_upload_job_run(void *arg)
+{
+    gps_upload_flush(false);
+}
+
+// Sends the queued fix, if any; http_locked when the caller holds http_mutex
+static void gps_upload_flush(bool http_locked)
+{
+    xSemaphoreTake(governor_mutex, portMAX_DELAY);
+    if (!upload_pending) {
+        xSemaphoreGive(governor_mutex);
+        return;
+    }
+    gps_data_t fix = pending_fix;
+    uint32_t fix_ms = pending_fix_ms;
+    float heading = pending_heading;
+    upload_pending = false;
+    xSemaphoreGive(governor_mutex);
+    
+    TRACE_BEGIN(TRACE_GPS_UPLOAD, fix.trace_flow);
+    TRACE_FLOW_END(TRACE_GPS_FLOW, fix.trace_flow);
+    // With the circuit open the POST would fail fast without any I/O
+    bool sent = network_manager_push_send_gps(&fix);
+    bool skipped = !sent && !network_manager_backend_available();
+    if (!sent && !skipped) {
+        sent = http_locked ? send_gps_data_locked(&fix) : network_manager_send_gps_data(&fix);
+    }
+    TRACE_END(TRACE_GPS_UPLOAD);
+    
+    xSemaphoreTake(governor_mutex, portMAX_DELAY);
+    if (sent) {
+        upload_stats.sent++;
+        last_sent_fix = fix;
+        last_sent_fix.timestamp = fix_ms;
+        if (heading >= 0) {
+            last_sent_heading = heading;
+        }
+    } else if (skipped) {
+        // Keep the old reference so the next fix retries
+        upload_stats.skipped++;
+    } else {
+        upload_stats.failed++;
+    }
+    ESP_LOGD(TAG, "GPS uploads: %lu sent, %lu suppressed, %lu coalesced, %lu rejected, %lu failed, %lu skipped",
+             (unsigned long)upload_stats.sent, (unsigned long)upload_stats.suppressed,
+             (unsigned long)upload_stats.coalesced, (unsigned long)upload_stats.rejected,
+             (unsigned long)upload_stats.failed, (unsigned long)upload_stats.skipped);
+    xSemaphoreGive(governor_mutex);
+}
+
+void network_manager_get_gps_upload_stats(gps_upload_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    
+    xSemaphoreTake(governor_mutex, portMAX_DELAY);
+    *stats = upload_stats;
+    xSemaphoreGive(governor_mutex);
+}
+
+void network_manager_sidequest_prefetch_start(float regen_distance_m)
+{
+    if (prefetch_job >= 0) {
+        return;
+    }
+    
+    prefetch_mutex = xSemaphoreCreateMutex();
+    if (regen_distance_m > 0) {
+        prefetch_regen_distance_m = regen_distance_m;
+    }
+    
+    prefetch_job = radio_scheduler_register("sq_prefetch", sidequest_prefetch_job, NULL);
+    ESP_LOGI(TAG, "Sidequest prefetch started (regenerate after %.0f m)", prefetch_regen_distance_m);
+}
+
+void network_manager_sidequest_prefetch_update(const gps_data_t *gps_data)
+{
+    if (prefetch_job < 0 || !gps_data || !gps_data->valid) {
+        return;
+    }
+    
+    bool needs_refresh = false;
+    xSemaphoreTake(prefetch_mutex, portMAX_DELAY);
+    prefetch_position = *gps_data;
+    if (!prefetch_ready) {
+        needs_refresh = true;
+    } else {
+        float moved_m = navigation_calc_distance(prefetch_origin_lat, prefetch_origin_lng,
+                                                 gps_data->latitude, gps_data->longitude) * 1000.0f;
+        needs_refresh = moved_m > prefetch_regen_distance_m;
+    }
+    xSemaphoreGive(prefetch_mutex);
+    
+    if (needs_refresh) {
+        radio_scheduler_defer(prefetch_job, SIDEQUEST_PREFETCH_MAX_DELAY_MS);
+    }
+}
+
+bool network_manager_sidequest_prefetch_take(const gps_data_t *gps_data, sidequest_data_t *sidequest)
+{
+    if (prefetch_job < 0 || !gps_data || !gps_data->valid || !sidequest) {
+        return false;
+    }
+    
+    bool taken = false;
+    xSemaphoreTake(prefetch_mutex, portMAX_DELAY);
+    if (prefetch_ready) {
+        float moved_m = navigation_calc_distance(prefetch_origin_lat, prefetch_origin_lng,
+                                                 gps_data->latitude, gps_data->longitude) * 1000.0f;
+        if (moved_m <= prefetch_regen_distance_m) {
+            *sidequest = prefetch_sidequest;
+            taken = true;
+        }
+        // Either consumed or stale; the next one is generated for the current area
+        prefetch_ready = false;
+    }
+    xSemaphoreGive(prefetch_mutex);
+    
+    if (taken) {
+        ESP_LOGI(TAG, "Using prefetched sidequest: %s", sidequest->title);
+    }
+    radio_scheduler_defer(prefetch_job, SIDEQUEST_PREFETCH_MAX_DELAY_MS);
+    
+    return taken;
+}
+
+// Runs in a radio window; the next fix re-defers it after a failure
+static void sidequest_prefetch_job(void *arg)
+{
+    // Don't hammer the backend while it keeps failing
+    if (prefetch_failed && esp_log_timestamp() - prefetch_failed_ms < SIDEQUEST_PREFETCH_RETRY_MS) {
+        return;
+    }
+    
+    xSemaphoreTake(prefetch_mutex, portMAX_DELAY);
+    gps_data_t position = prefetch_position;
+    bool needs_refresh = !prefetch_ready;
+    if (prefetch_ready && position.valid) {
+        float moved_m = navigation_calc_distance(prefetch_origin_lat, prefetch_origin_lng,
+                                                 position.latitude, position.longitude) * 1000.0f;
+        needs_refresh = moved_m > prefetch_regen_distance_m;
+    }
+    xSemaphoreGive(prefetch_mutex);
+    
+    if (!needs_refresh || !position.valid) {
+        return;
+    }
+    
+    sidequest_data_t sidequest = {0};
+    if (!network_manager_generate_sidequest(&position, &sidequest)) {
+        ESP_LOGW(TAG, "Sidequest prefetch failed, retrying in %d s", SIDEQUEST_PREFETCH_RETRY_MS / 1000);
+        prefetch_failed_ms = esp_log_timestamp();
+        prefetch_failed = true;
+        return;
+    }
+    prefetch_failed = false;
+    
+    xSemaphoreTake(prefetch_mutex, portMAX_DELAY);
+    prefetch_sidequest = sidequest;
+    prefetch_origin_lat = position.latitude;
+    prefetch_origin_lng = position.longitude;
+    prefetch_ready = true;
+    xSemaphoreGive(prefetch_mutex);
+    
+    ESP_LOGI(TAG, "Sidequest prefetched for %.6f, %.6f", position.latitude, position.longitude);
+}
+
+bool network_manager_push_start(const char *device_id, const nm_push_handlers_t *handlers)
+{
+    if (push_client) {
         return true;
     }
     
-    cJSON_Delete(response_json);
-    return false;
-}
\ No newline at end of file
+    // http(s)://host -> ws(s)://host/ws/device
+    const char *host = strstr(backend_base_url, "://");
+    if (!host) {
+        ESP_LOGE(TAG, "Backend URL not configured");
+        return false;
+    }
+    bool secure = strncmp(backend_base_url, "https", 5) == 0;
+    
+    char uri[384];
+    snprintf(uri, sizeof(uri), "%s://%s/ws/device?deviceId=%s", secure ? "wss" : "ws", host + 3,
+             device_id ? device_id : "unknown");
+    
+    if (handlers) {
+        push_handlers = *handlers;
+    }
+    
+    esp_websocket_client_config_t config = {};
+    config.uri = uri;
+    config.reconnect_timeout_ms = PUSH_RECONNECT_MS;
+    config.network_timeout_ms = PUSH_NETWORK_TIMEOUT_MS;
+    config.ping_interval_sec = PUSH_PING_INTERVAL_S;
+    
+    push_client = esp_websocket_client_init(&config);
+    if (!push_client) {
+        ESP_LOGE(TAG, "Failed to create push channel client");
+        return false;
+    }
+    
+    esp_websocket_register_events(push_client, WEBSOCKET_EVENT_ANY, push_event_handler, NULL);
+    if (esp_websocket_client_start(push_client) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start push channel");
+        esp_websocket_client_destroy(push_client);
+        push_client = NULL;
+        return false;
+    }
+    
+    ESP_LOGI(TAG, "Push channel started: %s", uri);
+    return true;
+}
+
+void network_manager_push_stop(void)
+{
+    if (!push_client) {
+        return;
+    }
+    
+    esp_websocket_client_stop(push_client);
+    esp_websocket_client_destroy(push_client);
+    push_client = NULL;
+    push_connected = false;
+}
+
+bool network_manager_push_connected(void)
+{
+    return push_connected;
+}
+
+bool network_manager_push_send_gps(const gps_data_t *gps_data)
+{
+    if (!push_connected || !gps_data || !gps_data->valid) {
+        return false;
+    }
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddItemToObject(json, "type", cJSON_CreateString("gps"));
+    cJSON_AddItemToObject(json, "latitude", cJSON_CreateNumber(gps_data->latitude));
+    cJSON_AddItemToObject(json, "longitude", cJSON_CreateNumber(gps_data->longitude));
+    cJSON_AddItemToObject(json, "altitude", cJSON_CreateNumber(gps_data->altitude));
+    cJSON_AddItemToObject(json, "accuracy", cJSON_CreateNumber(gps_data->accuracy));
+    cJSON_AddItemToObject(json, "deviceId", cJSON_CreateString(gps_data->device_id));
+    
+    char *json_string = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    
+    if (!json_string) {
+        return false;
+    }
+    
+    int len = strlen(json_string);
+    int64_t start_us = esp_timer_get_time();
+    int sent = esp_websocket_client_send_text(push_client, json_string, len, pdMS_TO_TICKS(PUSH_SEND_TIMEOUT_MS));
+    radio_scheduler_note_traffic(start_us, esp_timer_get_time());
+    energy_account_add_us(ENERGY_RAIL_WIFI_TX, energy_wifi_tx_airtime_us(len));
+    free(json_string);
+    
+    if (sent != len) {
+        ESP_LOGW(TAG, "Push channel GPS send failed, falling back to HTTP");
+        return false;
+    }
+    
+    portENTER_CRITICAL(&stats_lock);
+    push_stats.frames_out++;
+    push_stats.bytes_out += len;
+    portEXIT_CRITICAL(&stats_lock);
+    return true;
+}
+
+void network_manager_get_push_stats(nm_push_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&stats_lock);
+    *stats = push_stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void push_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+    
+    switch (event_id) {
+        case WEBSOCKET_EVENT_CONNECTED:
+            push_connected = true;
+            portENTER_CRITICAL(&stats_lock);
+            push_stats.connects++;
+            portEXIT_CRITICAL(&stats_lock);
+            health_record_outcome(true);
+            ESP_LOGI(TAG, "Push channel connected");
+            break;
+        case WEBSOCKET_EVENT_DISCONNECTED:
+            if (push_connected) {
+                portENTER_CRITICAL(&stats_lock);
+                push_stats.disconnects++;
+                portEXIT_CRITICAL(&stats_lock);
+                ESP_LOGW(TAG, "Push channel disconnected, falling back to HTTP");
+            }
+            push_connected = false;
+            break;
+        case WEBSOCKET_EVENT_DATA:
+            // Pings and pushes alike show the backend is up, so idle probes stay off
+            health_record_outcome(true);
+            radio_scheduler_note_traffic(esp_timer_get_time(), esp_timer_get_time());
+            if (data->op_code != 0x01) {
+                break;
+            }
+        
+            // A frame can arrive in several pieces
+            if (data->payload_len >= (int)sizeof(push_buffer)) {
+                if (data->payload_offset == 0) {
+                    ESP_LOGW(TAG, "Push message of %d bytes dropped", data->payload_len);
+                }
+                break;
+            }
+            memcpy(push_buffer + data->payload_offset, data->data_ptr, data->data_len);
+            if (data->payload_offset + data->data_len >= data->payload_len) {
+                push_buffer[data->payload_len] = '\0';
+                portENTER_CRITICAL(&stats_lock);
+                push_stats.frames_in++;
+                push_stats.bytes_in += data->payload_len;
+                portEXIT_CRITICAL(&stats_lock);
+                push_dispatch(push_buffer);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Decodes { "type": ..., "data": ... } and hands it to the registered handler
+static void push_dispatch(const char *message)
+{
+    cJSON *json = cJSON_Parse(message);
+    if (!json) {
+        ESP_LOGW(TAG, "Invalid push message");
+        return;
+    }
+    
+    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
+    cJSON *data = cJSON_GetObjectItem(json, "data");
+    
+    if (type && data) {
+        if (strcmp(type, "target") == 0) {
+            target_data_t target = {};
+            if (parse_target(data, &target) && push_handlers.on_target) {
+                ESP_LOGI(TAG, "Pushed target: %s", target.name);
+                push_handlers.on_target(&target);
+            }
+        } else if (strcmp(type, "safety") == 0) {
+            safety_data_t safety = {};
+            parse_safety(data, &safety);
+            ESP_LOGI(TAG, "Pushed safety alert: risk=%.1f", safety.risk_score);
+            if (push_handlers.on_safety) {
+                push_handlers.on_safety(&safety);
+            }
+        } else if (strcmp(type, "sidequest") == 0) {
+            sidequest_data_t sidequest = {};
+            parse_sidequest(data, &sidequest);
+            ESP_LOGI(TAG, "Pushed sidequest: %s", sidequest.title);
+            if (push_handlers.on_sidequest) {
+                push_handlers.on_sidequest(&sidequest);
+            }
+        }
+        
+        portENTER_CRITICAL(&stats_lock);
+        push_stats.pushes++;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+    
+    cJSON_Delete(json);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Power management profiles. Each one sets the esp_pm frequency range and
+// whether the idle task may enter automatic light sleep (needs
+// CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE); the app picks one
+// from its state. Drivers hold their own PM locks while SPI, BLE or HTTP
+// work is in flight, so the low bounds only apply between bursts.
+typedef enum {
+    POWER_PROFILE_NAVIGATING,  // compass redraws on every fix
+    POWER_PROFILE_MENU,        // user at the screen, waiting for a touch
+    POWER_PROFILE_IDLE,        // nobody looking, background work only
+    POWER_PROFILE_COUNT
+} power_profile_t;
+
+// Nominal board current per profile (mA) for the average-current estimate,
+// backlight included. Calibrate these against a meter on real hardware.
+#define POWER_PROFILE_NAVIGATING_MA 105.0f
+#define POWER_PROFILE_MENU_MA       70.0f
+#define POWER_PROFILE_IDLE_MA       38.0f
+
+typedef struct {
+    uint32_t entries;
+    uint64_t residency_ms;
+    uint32_t ui_events;         // inputs handled while in the profile
+    uint32_t ui_latency_total_ms;
+    uint32_t ui_latency_max_ms;
+} power_profile_stats_t;
+
+void power_profile_init(power_profile_t initial);
+void power_profile_set(power_profile_t profile);
+power_profile_t power_profile_get(void);
+
+// Input to frame on screen, charged to the current profile
+void power_profile_record_ui_latency(uint32_t latency_ms);
+
+void power_profile_get_stats(power_profile_stats_t stats[POWER_PROFILE_COUNT]);
+void power_profile_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
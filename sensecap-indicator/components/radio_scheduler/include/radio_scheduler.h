@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared radio wake windows for deferrable network work (GPS uploads, idle
+// health probes, prefetches). Deferred jobs wait for the next window, which
+// opens every RADIO_SCHEDULER_WINDOW_MS on a DTIM boundary counted from the
+// association, or earlier when a job's deadline comes first. Any traffic
+// outside a window (a user request, a push) also runs the pending jobs,
+// since the radio is awake anyway. User-initiated requests never wait.
+#define RADIO_SCHEDULER_MAX_JOBS     6
+#define RADIO_SCHEDULER_WINDOW_MS    30000
+
+// Modem sleep wakes the radio every DTIM; the window period is a whole number
+// of DTIM intervals. The driver doesn't expose the AP's DTIM period, so it is
+// assumed here (100 TU beacons, DTIM 1 as on most access points).
+#define RADIO_SCHEDULER_BEACON_US    102400
+#define RADIO_SCHEDULER_DTIM_PERIOD  1
+
+// How long the radio is counted as on after the last frame of an exchange,
+// before modem sleep takes it down again
+#define RADIO_SCHEDULER_TAIL_MS      200
+
+typedef void (*radio_job_fn_t)(void *arg);
+
+// Batched runs deferred jobs in windows; immediate runs each one as soon as
+// it is deferred, i.e. every job on its own timer as before
+typedef enum {
+    RADIO_MODE_IMMEDIATE,
+    RADIO_MODE_BATCHED,
+    RADIO_MODE_COUNT
+} radio_mode_t;
+
+// Radio time beyond the DTIM beacons, per mode
+typedef struct {
+    uint64_t elapsed_ms;
+    uint64_t radio_on_ms;
+    uint32_t wakes;       // separate radio-on periods
+    uint32_t windows;     // times pending jobs were run
+    uint32_t jobs_run;
+} radio_mode_stats_t;
+
+// Idempotent; register jobs after it
+void radio_scheduler_init(void);
+
+// Returns the job id, or -1 when RADIO_SCHEDULER_MAX_JOBS are registered.
+// Jobs run one at a time on the scheduler task.
+int radio_scheduler_register(const char *name, radio_job_fn_t fn, void *arg);
+
+// Runs the job once in the next window, at the latest after max_delay_ms.
+// Deferring a pending job again keeps the earlier deadline. Returns the
+// number of milliseconds until the window that will run it.
+uint32_t radio_scheduler_defer(int job, uint32_t max_delay_ms);
+
+// Windows only open while the link is up; a new link restarts the DTIM count
+void radio_scheduler_set_link(bool up);
+
+// Reports an exchange on the radio (esp_timer_get_time() timestamps)
+void radio_scheduler_note_traffic(int64_t start_us, int64_t end_us);
+
+// On by default. Turning it off gives the unbatched baseline for the radio-on
+// statistics; both modes are kept so the two can be compared.
+void radio_scheduler_set_batching(bool enabled);
+
+void radio_scheduler_get_stats(radio_mode_stats_t stats[RADIO_MODE_COUNT]);
+void radio_scheduler_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
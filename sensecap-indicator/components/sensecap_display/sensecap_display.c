@@ -3,6 +3,8 @@
 #include "esp_lcd_panel_rgb.h"
 #include "esp_lcd_panel_ops.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "energy_account.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -133,7 +135,9 @@ void sensecap_display_show_startup(void)
 void sensecap_display_set_backlight(uint8_t brightness)
 {
     // Simple on/off control (PWM would be better for dimming)
-    gpio_set_level(SENSECAP_LCD_BL_GPIO, brightness > 128 ? 1 : 0);
+    bool on = brightness > 128;
+    gpio_set_level(SENSECAP_LCD_BL_GPIO, on ? 1 : 0);
+    energy_account_set_duty(ENERGY_RAIL_BACKLIGHT, on ? 1000 : 0);
 }
 
 void sensecap_display_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
@@ -144,8 +148,10 @@ void sensecap_display_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_c
     int offsetx2 = area->x2;
     int offsety2 = area->y2;
     
-    // Draw bitmap to panel
+    // Draw bitmap to panel; the copy into the frame buffer is the panel's active time
+    int64_t start_us = esp_timer_get_time();
     esp_lcd_panel_draw_bitmap(panel, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_p);
+    energy_account_add_us(ENERGY_RAIL_PANEL, (uint32_t)(esp_timer_get_time() - start_us));
     
     // Inform LVGL that flushing is done
     lv_disp_flush_ready(disp_drv);
@@ -23,6 +23,9 @@ extern "C" {
 void sensecap_touch_init(void);
 void sensecap_touch_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
 
+// Polls the panel directly, outside LVGL (e.g. between light sleeps)
+bool sensecap_touch_is_touched(void);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -107,6 +107,12 @@ void sensecap_touch_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
     }
 }
 
+bool sensecap_touch_is_touched(void)
+{
+    uint8_t touch_count = 0;
+    return ft6336u_read_reg(FT6336U_REG_NUM_TOUCHES, &touch_count, 1) == ESP_OK && touch_count > 0;
+}
+
 static esp_err_t ft6336u_read_reg(uint8_t reg_addr, uint8_t *data, size_t len)
 {
     return i2c_master_write_read_device(I2C_MASTER_NUM, SENSECAP_TOUCH_I2C_ADDR, 
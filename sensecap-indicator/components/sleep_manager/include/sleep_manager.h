@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Idle sleep with a state snapshot kept in RTC memory. The app decides when
+// to sleep; this component tracks screen-off idle, enters deep sleep, keeps the snapshot
+// (an opaque blob checked by a CRC) across deep sleep so the app can redraw
+// its last screen instead of cold booting, and accounts time per mode.
+#define SLEEP_SNAPSHOT_MAX_BYTES 2048
+
+// Nominal board current per mode (mA) for the average-current estimate:
+// ESP32 with WiFi and BLE up and the backlight on; "light" with the panel
+// asleep and the chip in automatic light sleep, radios in modem sleep; deep
+// sleep with the RTC IO wake source powered.
+// Calibrate these against a meter on real hardware.
+#define SLEEP_CURRENT_ACTIVE_MA 135.0f
+#define SLEEP_CURRENT_LIGHT_MA  2.5f
+#define SLEEP_CURRENT_DEEP_MA   0.35f
+
+typedef enum {
+    SLEEP_MODE_ACTIVE,
+    SLEEP_MODE_LIGHT,
+    SLEEP_MODE_DEEP,
+    SLEEP_MODE_COUNT
+} sleep_mode_t;
+
+// Wake-to-first-frame for one sleep mode. From deep sleep this is measured
+// from app start, so the ROM and bootloader time are not included.
+typedef struct {
+    uint32_t entries;
+    uint64_t residency_ms;
+    uint32_t frames;          // wakes that reached sleep_manager_frame_shown()
+    uint32_t frame_total_ms;
+    uint32_t frame_max_ms;
+} sleep_mode_stats_t;
+
+typedef struct {
+    sleep_mode_stats_t modes[SLEEP_MODE_COUNT];
+    float avg_current_ma;     // residency-weighted SLEEP_CURRENT_*_MA
+} sleep_stats_t;
+
+// Call first thing in app_main. wake_gpio is the touch IRQ (active low) used
+// to wake from deep sleep; with -1 only a reset wakes it.
+void sleep_manager_init(int wake_gpio);
+bool sleep_manager_woke_from_deep_sleep(void);
+
+// Only a deep-sleep wake keeps the snapshot; any other boot clears it
+bool sleep_manager_save_snapshot(const void *data, size_t len);
+bool sleep_manager_load_snapshot(void *data, size_t len);
+
+// Idle time is measured from the last call (or from boot)
+void sleep_manager_note_activity(void);
+uint32_t sleep_manager_idle_ms(void);
+
+// Screen-off idle, accounted as SLEEP_MODE_LIGHT. The caller turns the
+// panel off; the chip then naps in automatic light sleep (power_profile's
+// idle profile) with WiFi and BLE kept associated by modem sleep, which a
+// manual esp_light_sleep_start() would drop. screen_on counts as activity
+// and starts the wake-to-frame measurement.
+void sleep_manager_screen_off(void);
+void sleep_manager_screen_on(void);
+bool sleep_manager_screen_is_off(void);
+
+// Saves the time and enters deep sleep until the wake GPIO; does not return
+void sleep_manager_deep_sleep(void);
+
+// Call when the first frame after a wake is on screen; measured from the
+// latest wake, so a caller polling in short light sleeps gets the last one
+void sleep_manager_frame_shown(void);
+
+void sleep_manager_get_stats(sleep_stats_t *stats);
+void sleep_manager_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
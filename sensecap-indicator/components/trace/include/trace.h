@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cross-task event trace. Each core records into its own ring of 16-byte
+// events (oldest overwritten), claimed with one atomic add, so recording
+// takes no lock and a task never waits on another core. trace_dump() prints
+// the rings as text lines; trace-to-chrome.js in the repo root turns a
+// captured log into Chrome/Perfetto trace JSON.
+//
+// Set TRACE_ENABLED to 0 to compile every TRACE_* macro out.
+#define TRACE_ENABLED            1
+#define TRACE_EVENTS_PER_CORE    512     // power of two, 8 KB per core
+#define TRACE_MAX_CORES          2
+
+// Trace points; trace_dump() prints the names, so add new ones to both
+typedef enum {
+    TRACE_GPS_BLE_WRITE,       // span: GATTS write handled
+    TRACE_GPS_PARSE,           // span: NMEA sentences parsed
+    TRACE_APP_EVENT,           // span: app task handling one bus event (arg: event type)
+    TRACE_APP_GPS_FIX,         // span: app task handling a fix
+    TRACE_NAV_BEARING,         // span: distance and bearing computed
+    TRACE_DISPLAY_DRAW,        // span: a screen drawn and flushed over SPI
+    TRACE_DISPLAY_BYTES,       // counter: bytes sent to the panel by the last draw
+    TRACE_HTTP_REQUEST,        // span: one HTTP attempt
+    TRACE_GPS_UPLOAD,          // span: fix upload
+    TRACE_GPS_FLOW,            // flow: BLE write -> parse -> app -> draw -> upload
+    TRACE_POINT_COUNT
+} trace_point_t;
+
+typedef enum {
+    TRACE_TYPE_BEGIN,
+    TRACE_TYPE_END,
+    TRACE_TYPE_COUNTER,
+    TRACE_TYPE_FLOW_START,
+    TRACE_TYPE_FLOW_STEP,
+    TRACE_TYPE_FLOW_END,
+} trace_type_t;
+
+typedef struct {
+    uint32_t timestamp_us;  // esp_timer_get_time(), wraps every 71 minutes
+    uint32_t arg;           // span argument, counter value or flow id
+    uint32_t task;          // task handle (low 32 bits), named in the dump
+    uint8_t point;          // trace_point_t
+    uint8_t type;           // trace_type_t
+    uint16_t reserved;
+} trace_event_t;
+
+void trace_record(trace_point_t point, trace_type_t type, uint32_t arg);
+
+// New flow id (never 0), to carry with the data through each step
+uint32_t trace_new_flow(void);
+
+// Recording stops while the rings are printed
+void trace_dump(void);
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(point, arg)      trace_record((point), TRACE_TYPE_BEGIN, (arg))
+#define TRACE_END(point)             trace_record((point), TRACE_TYPE_END, 0)
+#define TRACE_COUNTER(point, value)  trace_record((point), TRACE_TYPE_COUNTER, (value))
+#define TRACE_FLOW_START(point, id)  trace_record((point), TRACE_TYPE_FLOW_START, (id))
+#define TRACE_FLOW_STEP(point, id)   trace_record((point), TRACE_TYPE_FLOW_STEP, (id))
+#define TRACE_FLOW_END(point, id)    trace_record((point), TRACE_TYPE_FLOW_END, (id))
+#define TRACE_NEW_FLOW()             trace_new_flow()
+#else
+#define TRACE_BEGIN(point, arg)      ((void)0)
+#define TRACE_END(point)             ((void)0)
+#define TRACE_COUNTER(point, value)  ((void)0)
+#define TRACE_FLOW_START(point, id)  ((void)0)
+#define TRACE_FLOW_STEP(point, id)   ((void)0)
+#define TRACE_FLOW_END(point, id)    ((void)0)
+#define TRACE_NEW_FLOW()             0u
+#endif
+
+#ifdef __cplusplus
+}
+#endif
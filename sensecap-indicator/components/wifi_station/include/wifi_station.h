@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Station mode with a fast reconnect path. The channel and BSSID of the last
+// good association are kept in NVS and tried first, so the connect skips the
+// full scan; after WIFI_STATION_FAST_ATTEMPTS failures it falls back to a
+// normal scan. The IP lease is restored by lwIP (CONFIG_LWIP_DHCP_RESTORE_LAST_IP),
+// which asks for the previous address instead of going through DHCP discovery.
+// Failed attempts retry after a jittered backoff between half and all of a
+// delay that doubles from WIFI_STATION_BACKOFF_BASE_MS to _MAX_MS.
+#define WIFI_STATION_FAST_ATTEMPTS   2
+#define WIFI_STATION_BACKOFF_BASE_MS 250
+#define WIFI_STATION_BACKOFF_MAX_MS  30000
+
+// Called on the event loop task when the station gets an IP or loses the link
+typedef void (*wifi_link_callback_t)(bool up);
+
+typedef struct {
+    uint32_t connects;        // associations that got an IP
+    uint32_t fast_connects;   // of those, through the cached channel and BSSID
+    uint32_t disconnects;
+    uint32_t retries;         // connect attempts after a failure
+    uint32_t last_connect_ms; // link lost (or boot) to IP, latest connect
+    uint32_t last_ttfb_ms;    // link lost (or boot) to first HTTP response byte, 0 until seen
+    uint32_t boot_ttfb_ms;    // the same for the first connect after boot
+} wifi_station_stats_t;
+
+// Needs NVS; creates the default event loop and STA netif, and starts connecting
+void wifi_station_init(const char *ssid, const char *password, wifi_link_callback_t on_link);
+bool wifi_station_is_connected(void);
+
+// Hook for network_manager_set_first_byte_callback(): the first response
+// after each connect gives the time to first byte
+void wifi_station_record_first_byte(int64_t first_byte_us);
+
+void wifi_station_get_stats(wifi_station_stats_t *stats);
+void wifi_station_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
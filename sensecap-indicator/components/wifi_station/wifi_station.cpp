@@ -0,0 +1,280 @@
+#include "wifi_station.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "nvs.h"
+
+static const char *TAG = "WIFI_STATION";
+
+#define CACHE_NAMESPACE "wifi_cache"
+#define CACHE_KEY       "ap"
+
+// Backoff retries come back through the default event loop, so only its
+// task ever touches the connection state
+ESP_EVENT_DEFINE_BASE(WIFI_STATION_EVENT);
+enum {
+    WIFI_STATION_EVENT_RETRY
+};
+
+// Last good association, persisted in NVS
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t valid;
+} ap_cache_t;
+
+static ap_cache_t ap_cache = {};
+static wifi_config_t sta_config = {};
+static wifi_link_callback_t link_callback = NULL;
+static esp_timer_handle_t retry_timer = NULL;
+
+// Connection state, owned by the event loop task
+static bool connected = false;
+static bool config_uses_cache = false;
+static uint32_t failed_attempts = 0;
+static uint32_t backoff_ms = WIFI_STATION_BACKOFF_BASE_MS;
+static int64_t link_lost_us = 0;  // start of the current connect, 0 at boot
+static int64_t connected_us = 0;
+static bool ttfb_pending = false;
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static wifi_station_stats_t stats = {};
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+static void retry_timer_callback(void *arg);
+static void connect_now(void);
+static void cache_load(void);
+static void cache_save(void);
+
+void wifi_station_init(const char *ssid, const char *password, wifi_link_callback_t on_link)
+{
+    link_callback = on_link;
+    cache_load();
+    
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_create_default_wifi_sta();
+    
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    
+    // The cache lives in NVS already; keeping the driver's copy in RAM saves a flash write per connect
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_STATION_EVENT, WIFI_STATION_EVENT_RETRY, &event_handler,
+                                                        NULL, NULL));
+    
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = retry_timer_callback;
+    timer_args.name = "wifi_retry";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &retry_timer));
+    
+    strncpy((char *)sta_config.sta.ssid, ssid, sizeof(sta_config.sta.ssid));
+    strncpy((char *)sta_config.sta.password, password, sizeof(sta_config.sta.password));
+    sta_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    
+    ESP_LOGI(TAG, "WiFi initialization finished (%s)",
+             ap_cache.valid ? "cached channel and BSSID" : "no cache, full scan");
+}
+
+bool wifi_station_is_connected(void)
+{
+    return connected;
+}
+
+void wifi_station_record_first_byte(int64_t first_byte_us)
+{
+    bool boot = false;
+    uint32_t ttfb_ms = 0;
+    
+    portENTER_CRITICAL(&stats_lock);
+    if (ttfb_pending && first_byte_us > connected_us) {
+        ttfb_pending = false;
+        ttfb_ms = (first_byte_us - link_lost_us) / 1000;
+        stats.last_ttfb_ms = ttfb_ms;
+        if (stats.boot_ttfb_ms == 0 && link_lost_us == 0) {
+            stats.boot_ttfb_ms = ttfb_ms;
+            boot = true;
+        }
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    
+    if (ttfb_ms) {
+        ESP_LOGI(TAG, "First HTTP byte %lu ms after %s", (unsigned long)ttfb_ms, boot ? "boot" : "the link dropped");
+    }
+}
+
+void wifi_station_get_stats(wifi_station_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void wifi_station_log_stats(void)
+{
+    wifi_station_stats_t st;
+    wifi_station_get_stats(&st);
+    
+    ESP_LOGI(TAG, "wifi: %lu connects (%lu fast), %lu drops, %lu retries, last connect %lu ms, "
+             "first byte %lu ms (boot %lu ms)",
+             (unsigned long)st.connects, (unsigned long)st.fast_connects, (unsigned long)st.disconnects,
+             (unsigned long)st.retries, (unsigned long)st.last_connect_ms, (unsigned long)st.last_ttfb_ms,
+             (unsigned long)st.boot_ttfb_ms);
+}
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        connect_now();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+        
+        if (connected) {
+            // Link dropped (or we roamed): retry at once, fast path first
+            connected = false;
+            link_lost_us = esp_timer_get_time();
+            failed_attempts = 0;
+            backoff_ms = WIFI_STATION_BACKOFF_BASE_MS;
+            portENTER_CRITICAL(&stats_lock);
+            stats.disconnects++;
+            ttfb_pending = false;
+            portEXIT_CRITICAL(&stats_lock);
+            ESP_LOGI(TAG, "WiFi disconnected (reason %d), reconnecting...", event->reason);
+            if (link_callback) link_callback(false);
+            connect_now();
+            return;
+        }
+        
+        // A cached AP that isn't there any more won't come back on a retry
+        failed_attempts++;
+        if (config_uses_cache && event->reason == WIFI_REASON_NO_AP_FOUND) {
+            failed_attempts = WIFI_STATION_FAST_ATTEMPTS;
+        }
+        
+        // Jittered so a roomful of devices dropped by one AP doesn't retry in lockstep
+        uint32_t retry_in_ms = backoff_ms / 2 + esp_random() % (backoff_ms / 2 + 1);
+        ESP_LOGI(TAG, "Connect attempt %lu failed (reason %d), retrying in %lu ms", (unsigned long)failed_attempts,
+                 event->reason, (unsigned long)retry_in_ms);
+        esp_timer_start_once(retry_timer, (uint64_t)retry_in_ms * 1000);
+        backoff_ms = backoff_ms * 2 > WIFI_STATION_BACKOFF_MAX_MS ? WIFI_STATION_BACKOFF_MAX_MS : backoff_ms * 2;
+        
+        portENTER_CRITICAL(&stats_lock);
+        stats.retries++;
+        portEXIT_CRITICAL(&stats_lock);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        int64_t now_us = esp_timer_get_time();
+        uint32_t connect_ms = (now_us - link_lost_us) / 1000;
+        
+        connected = true;
+        failed_attempts = 0;
+        backoff_ms = WIFI_STATION_BACKOFF_BASE_MS;
+        
+        portENTER_CRITICAL(&stats_lock);
+        stats.connects++;
+        if (config_uses_cache) stats.fast_connects++;
+        stats.last_connect_ms = connect_ms;
+        connected_us = now_us;
+        ttfb_pending = true;
+        portEXIT_CRITICAL(&stats_lock);
+        
+        ESP_LOGI(TAG, "Got IP: " IPSTR " after %lu ms (%s)", IP2STR(&event->ip_info.ip), (unsigned long)connect_ms,
+                 config_uses_cache ? "fast connect" : "full scan");
+        cache_save();
+        if (link_callback) link_callback(true);
+    } else if (event_base == WIFI_STATION_EVENT && event_id == WIFI_STATION_EVENT_RETRY) {
+        if (!connected) {
+            connect_now();
+        }
+    }
+}
+
+// Runs on the esp_timer task: hand the retry to the event loop task
+static void retry_timer_callback(void *arg)
+{
+    if (esp_event_post(WIFI_STATION_EVENT, WIFI_STATION_EVENT_RETRY, NULL, 0, 0) != ESP_OK) {
+        // Queue full: try again shortly rather than stall the backoff
+        esp_timer_start_once(retry_timer, (uint64_t)WIFI_STATION_BACKOFF_BASE_MS * 1000);
+    }
+}
+
+// Tries the cached channel and BSSID until they fail WIFI_STATION_FAST_ATTEMPTS
+// times in a row, then scans
+static void connect_now(void)
+{
+    bool use_cache = ap_cache.valid && failed_attempts < WIFI_STATION_FAST_ATTEMPTS;
+    
+    if (use_cache) {
+        sta_config.sta.channel = ap_cache.channel;
+        sta_config.sta.bssid_set = true;
+        memcpy(sta_config.sta.bssid, ap_cache.bssid, sizeof(ap_cache.bssid));
+        sta_config.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        if (config_uses_cache) {
+            ESP_LOGW(TAG, "Cached AP not reachable, falling back to a full scan");
+        }
+        sta_config.sta.channel = 0;
+        sta_config.sta.bssid_set = false;
+        sta_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        sta_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    config_uses_cache = use_cache;
+    
+    esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+    esp_wifi_connect();
+}
+
+static void cache_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    
+    size_t size = sizeof(ap_cache);
+    if (nvs_get_blob(handle, CACHE_KEY, &ap_cache, &size) != ESP_OK || size != sizeof(ap_cache)) {
+        memset(&ap_cache, 0, sizeof(ap_cache));
+    }
+    nvs_close(handle);
+}
+
+// Writes only when the AP changed, so a stable network costs no flash wear
+static void cache_save(void)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return;
+    }
+    
+    ap_cache_t fresh = {};
+    memcpy(fresh.bssid, ap.bssid, sizeof(fresh.bssid));
+    fresh.channel = ap.primary;
+    fresh.valid = 1;
+    if (memcmp(&fresh, &ap_cache, sizeof(fresh)) == 0) {
+        return;
+    }
+    
+    nvs_handle_t handle;
+    if (nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(handle, CACHE_KEY, &fresh, sizeof(fresh)) == ESP_OK && nvs_commit(handle) == ESP_OK) {
+        ap_cache = fresh;
+        ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %d", MAC2STR(fresh.bssid), fresh.channel);
+    }
+    nvs_close(handle);
+}
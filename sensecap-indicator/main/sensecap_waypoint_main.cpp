@@ -3,11 +3,12 @@
 #include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_mac.h"
 #include "nvs_flash.h"
 #include "esp_bt.h"
 #include "esp_gap_ble_api.h"
@@ -26,6 +27,20 @@
 #include "gps_handler.h"
 #include "network_manager.h"
 #include "navigation_calc.h"
+#include "event_bus.h"
+#include "init_scheduler.h"
+#include "wifi_station.h"
+#include "sleep_manager.h"
+#include "power_profile.h"
+#include "radio_scheduler.h"
+#include "task_plan.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "binlog.h"
+#include "heap_account.h"
+#include "latency_budget.h"
+#include "energy_account.h"
+#include "metrics_server.h"
 
 static const char *TAG = "SENSECAP_WAYPOINT";
 
@@ -39,7 +54,8 @@ typedef enum {
     STATE_MENU,
     STATE_POINTING,
     STATE_SAFETY_WARNING,
-    STATE_SIDEQUEST
+    STATE_SIDEQUEST,
+    STATE_DIAGNOSTICS
 } app_state_t;
 
 // Data structures (same as ESP-IDF version)
@@ -50,6 +66,10 @@ typedef struct {
     float accuracy;
     bool valid;
     char device_id[32];
+    uint32_t timestamp;  // esp_log_timestamp() when the fix was parsed
+    uint32_t trace_flow; // trace flow from the BLE write to the upload, 0 if untraced
+    uint32_t received_us; // esp_timer when the BLE write arrived, 0 if synthesized
+    uint32_t parsed_us;   // esp_timer when the fix was parsed
 } gps_data_t;
 
 typedef struct {
@@ -94,17 +114,107 @@ static safety_data_t safety_data = {0};
 static sidequest_data_t sidequest_data = {0};
 static bool wifi_connected = false;
 static bool backend_reachable = false;
+static volatile uint32_t wake_touch_until_ms = 0;
+static volatile bool screen_wake_requested = false;  // app task -> LVGL task
 
 // Task handles
 static TaskHandle_t main_task_handle = NULL;
 static TaskHandle_t lvgl_task_handle = NULL;
+static TaskHandle_t network_task_handle = NULL;
 
-// Event group for synchronization
-static EventGroupHandle_t app_event_group;
-#define WIFI_CONNECTED_BIT    BIT0
-#define GPS_DATA_READY_BIT    BIT1
-#define TOUCH_EVENT_BIT       BIT2
-#define BACKEND_READY_BIT     BIT3
+// Event bus subscribers: the state machine, the blocking backend calls and
+// the health poller each drain their own queue
+static bus_subscriber_t *app_sub = NULL;
+static bus_subscriber_t *network_sub = NULL;
+static bus_subscriber_t *backend_sub = NULL;
+
+#define APP_EVENTS (BUS_EVENT_MASK(BUS_EVENT_GPS_FIX) | BUS_EVENT_MASK(BUS_EVENT_TOUCH) | \
+                    BUS_EVENT_MASK(BUS_EVENT_NET_RESULT) | BUS_EVENT_MASK(BUS_EVENT_TIMER))
+
+// Boot steps, in init_scheduler order; the values double as INIT_STEP() indexes
+enum {
+    BOOT_NVS,
+    BOOT_DISPLAY,
+    BOOT_TOUCH,
+    BOOT_GPS,
+    BOOT_WIFI,
+    BOOT_NETWORK,
+    BOOT_STEP_COUNT
+};
+
+// The menu needs only these; WiFi and the backend come up behind it
+#define BOOT_UI_STEPS  (INIT_STEP(BOOT_DISPLAY) | INIT_STEP(BOOT_TOUCH))
+#define BOOT_ALL_STEPS (INIT_STEP(BOOT_STEP_COUNT) - 1)
+
+// Power-on to interactive menu budget, checked in the boot log
+#define BOOT_TARGET_MS 1500
+
+// SenseCAP Indicator D1: ESP32-S3 with the 480x480 RGB panel and RP2040.
+// The RGB panel rescans its PSRAM frame buffer continuously, so its refresh
+// is in the awake floor and the panel rail is LVGL's copies into it.
+static const energy_model_t board_energy_model = {
+    .board = "SenseCAP Indicator",
+    .sleep_ma = SLEEP_CURRENT_LIGHT_MA,
+    .rail_ma = {
+        90.0f,      // awake
+        18.0f,      // cpu0 busy
+        18.0f,      // cpu1 busy
+        70.0f,      // wifi rx / radio on
+        110.0f,     // wifi tx, over rx
+        75.0f,      // ble radio
+        25.0f,      // panel frame copies
+        120.0f,     // backlight at full
+    },
+};
+
+// Menu button ids, carried in bus_touch_t.button
+#define BUTTON_SAVE      1
+#define BUTTON_NAVIGATE  2
+#define BUTTON_SAFETY    3
+#define BUTTON_SIDEQUEST 4
+#define BUTTON_DIAGNOSTICS 5  // long press on the menu title
+
+#define DIAG_MAX_LINES 24
+
+// Typed on the serial console: print the event trace for trace-to-chrome.js
+#define TRACE_DUMP_KEY 'd'
+
+// Bus timers
+#define APP_TIMER_DIAGNOSTICS 1
+#define APP_TIMER_SLEEP       2
+
+// Idle sleep: backlight off after SLEEP_LIGHT_IDLE_MS without a button press,
+// with the chip napping in automatic light sleep and the radios still
+// associated. While pointing every fix counts as activity. The FT6336U
+// interrupt doesn't reach a wake-capable pin on this board, so the LVGL task
+// polls the panel every SLEEP_TOUCH_POLL_MS while the screen is off.
+#define SLEEP_LIGHT_IDLE_MS       30000
+#define SLEEP_TOUCH_POLL_MS       200
+#define SLEEP_CHECK_INTERVAL_MS   10000
+
+// Presses this soon after a wake only woke the device
+#define SLEEP_WAKE_TOUCH_GUARD_MS 500
+
+// Drop to the idle power profile after this long without a press (not while pointing)
+#define POWER_IDLE_AFTER_MS 10000
+
+// How often backend_reachable is refreshed from the passive health state;
+// link changes cut the wait short, so the idle profile can wait much longer
+#define BACKEND_STATE_REFRESH_MS      5000
+#define BACKEND_STATE_REFRESH_IDLE_MS 60000
+
+// LVGL handler period bounds: the handler says when its next timer is due,
+// clamped so input is still read promptly and animations don't spin the CPU
+#define LVGL_MIN_DELAY_MS 5
+#define LVGL_MAX_DELAY_MS 100
+
+// How often network timeout/retry and event bus statistics are logged
+#define NETWORK_DIAG_INTERVAL_MS 600000
+
+// Metrics endpoint for fleet scraping, off by default. Set to 1 to serve
+// GET /metrics (Prometheus) and /metrics.json on METRICS_SERVER_PORT
+#define METRICS_SERVER      0
+#define METRICS_SERVER_PORT 8080
 
 // LVGL objects
 static lv_obj_t *main_screen;
@@ -112,172 +222,363 @@ static lv_obj_t *menu_screen;
 static lv_obj_t *compass_screen;
 static lv_obj_t *safety_screen;
 static lv_obj_t *sidequest_screen;
+static lv_obj_t *diagnostics_screen;
+static lv_obj_t *compass_label;
+
+// The app task draws screens and the LVGL task renders them, both on the UI
+// core with the app task preempting; each holds this while it touches LVGL
+static SemaphoreHandle_t lvgl_mutex = NULL;
 
 // Function prototypes
 static void app_main_task(void *pvParameters);
+static esp_err_t boot_nvs(void);
+static esp_err_t boot_display(void);
+static esp_err_t boot_touch(void);
+static esp_err_t boot_gps(void);
+static esp_err_t boot_wifi(void);
+static esp_err_t boot_network(void);
+static bool network_ready(void);
+static bool backend_usable(void);
 static void lvgl_tick_task(void *pvParameters);
-static void wifi_init_sta(void);
-static void wifi_event_handler(void* arg, esp_event_base_t event_base,
-                              int32_t event_id, void* event_data);
+static void lvgl_lock(void);
+static void lvgl_unlock(void);
+static void update_power_profile(void);
+static void on_wifi_link(bool up);
 static void create_ui_screens(void);
 static void show_menu_screen(void);
 static void show_compass_screen(void);
 static void show_safety_screen(void);
 static void show_sidequest_screen(void);
+static void show_diagnostics_screen(void);
+static void on_console_key(uint8_t key);
 static void handle_button_events(lv_event_t *e);
+static void publish_link(bus_link_kind_t kind, bool up);
+static void on_gps_fix(const gps_data_t *fix);
+static void handle_gps_fix(const gps_data_t *fix);
+static void handle_button(int button_id);
+static void handle_net_result(const bus_net_result_t *result);
+static void handle_timer_event(uint32_t timer_id);
+static void check_idle_sleep(void);
+static void wake_screen(void);
+static void request_network(bus_net_kind_t kind);
 static void update_compass_display(void);
+static void network_task(void *pvParameters);
 static void backend_connectivity_task(void *pvParameters);
+static void start_push_channel(void);
+static void publish_pushed(bus_msg_t *msg, bus_net_kind_t kind);
+static void on_pushed_target(const target_data_t *target);
+static void on_pushed_safety(const safety_data_t *safety);
+static void on_pushed_sidequest(const sidequest_data_t *sidequest);
+
+static const init_step_t boot_steps[BOOT_STEP_COUNT] = {
+    { "nvs", boot_nvs, 0, 0, tskNO_AFFINITY },
+    { "display", boot_display, 0, 0, TASK_CORE_UI },
+    { "touch", boot_touch, INIT_STEP(BOOT_DISPLAY), 0, TASK_CORE_UI },    // registers an LVGL input device
+    { "ble_gps", boot_gps, INIT_STEP(BOOT_NVS), 0, TASK_CORE_PROTOCOL },  // BT controller reads its calibration from NVS
+    { "wifi", boot_wifi, INIT_STEP(BOOT_NVS), 0, TASK_CORE_PROTOCOL },
+    { "network", boot_network, INIT_STEP(BOOT_WIFI), 6144, TASK_CORE_PROTOCOL },
+};
 
 extern "C" void app_main(void)
 {
     ESP_LOGI(TAG, "SenseCAP WaypointCompass starting...");
     
-    // Initialize NVS
+    // No RTC wake pin for the touch panel, so no deep sleep (see check_idle_sleep)
+    sleep_manager_init(-1);
+    
+    // Hot-path logs print from the drain task from here on
+    binlog_init();
+    energy_account_init(&board_energy_model);
+    
+    // Event bus and its subscribers, before anything can publish
+    event_bus_init();
+    app_sub = event_bus_subscribe("app", APP_EVENTS, 8);
+    network_sub = event_bus_subscribe("network", BUS_EVENT_MASK(BUS_EVENT_NET_REQUEST), 4);
+    backend_sub = event_bus_subscribe("backend_check", BUS_EVENT_MASK(BUS_EVENT_LINK), 4);
+
+    // Sampling from here on sees every boot step's task
+    telemetry_init();
+    telemetry_set_key_handler(on_console_key);
+    
+    // Independent subsystems come up concurrently; see boot_steps
+    init_scheduler_start(boot_steps, BOOT_STEP_COUNT);
+
+    lvgl_mutex = xSemaphoreCreateRecursiveMutex();
+    
+    // Create tasks per task_plan.h; each waits for the boot steps it needs
+    xTaskCreatePinnedToCore(app_main_task, "app_main", 8192, NULL, TASK_PRIO_APP, &main_task_handle, TASK_CORE_UI);
+    xTaskCreatePinnedToCore(lvgl_tick_task, "lvgl_tick", 4096, NULL, TASK_PRIO_LVGL, &lvgl_task_handle, TASK_CORE_UI);
+    xTaskCreatePinnedToCore(network_task, "network", 8192, NULL, TASK_PRIO_NETWORK, &network_task_handle,
+                            TASK_CORE_PROTOCOL);
+    xTaskCreatePinnedToCore(backend_connectivity_task, "backend_check", 4096, NULL, TASK_PRIO_BACKEND, NULL,
+                            TASK_CORE_PROTOCOL);
+    event_bus_timer_start(APP_TIMER_DIAGNOSTICS, NETWORK_DIAG_INTERVAL_MS);
+    event_bus_timer_start(APP_TIMER_SLEEP, SLEEP_CHECK_INTERVAL_MS);
+}
+
+static esp_err_t boot_nvs(void)
+{
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
-    ESP_ERROR_CHECK(ret);
-
-    // Create event group
-    app_event_group = xEventGroupCreate();
+    return ret;
+}
 
-    // Initialize LVGL
+static esp_err_t boot_display(void)
+{
     lv_init();
-    
-    // Initialize SenseCAP display
-    ESP_LOGI(TAG, "Initializing SenseCAP display...");
     sensecap_display_init();
-    
-    // Initialize SenseCAP touch
-    ESP_LOGI(TAG, "Initializing SenseCAP touch...");
+    create_ui_screens();
+    sensecap_display_show_startup();
+    return ESP_OK;
+}
+
+static esp_err_t boot_touch(void)
+{
     sensecap_touch_init();
-    
-    // Initialize BLE GPS handler
-    ESP_LOGI(TAG, "Initializing BLE GPS handler...");
+    return ESP_OK;
+}
+
+static esp_err_t boot_gps(void)
+{
     gps_handler_init();
-    
-    // Initialize WiFi
-    ESP_LOGI(TAG, "Initializing WiFi...");
-    wifi_init_sta();
-    
-    // Initialize network manager
-    ESP_LOGI(TAG, "Initializing network manager...");
+    gps_handler_set_fix_callback(on_gps_fix);
+    return ESP_OK;
+}
+
+static esp_err_t boot_wifi(void)
+{
+    wifi_station_init(WIFI_SSID, WIFI_PASS, on_wifi_link);
+    return ESP_OK;
+}
+
+static esp_err_t boot_network(void)
+{
     network_manager_init(BACKEND_URL);
+    network_manager_set_first_byte_callback(wifi_station_record_first_byte);
+    network_manager_sidequest_prefetch_start(SIDEQUEST_PREFETCH_DEFAULT_DISTANCE_M);
+    start_push_channel();
+#if METRICS_SERVER
+    metrics_server_start(METRICS_SERVER_PORT);
+#endif
+    return ESP_OK;
+}
 
-    // Create UI screens
-    create_ui_screens();
-    
-    // Show startup animation
-    sensecap_display_show_startup();
-    vTaskDelay(pdMS_TO_TICKS(3000));
+static bool network_ready(void)
+{
+    return init_scheduler_is_done(INIT_STEP(BOOT_NETWORK));
+}
 
-    // Create tasks
-    xTaskCreate(app_main_task, "app_main", 8192, NULL, 5, &main_task_handle);
-    xTaskCreate(lvgl_tick_task, "lvgl_tick", 4096, NULL, 4, &lvgl_task_handle);
-    xTaskCreate(backend_connectivity_task, "backend_check", 4096, NULL, 3, NULL);
-    
-    ESP_LOGI(TAG, "SenseCAP WaypointCompass started!");
+// The menu is up before WiFi; backend actions wait for all three
+static bool backend_usable(void)
+{
+    return wifi_connected && network_ready() && network_manager_backend_available();
 }
 
+// The state machine: every input arrives as a bus event and nothing here
+// blocks on the network, so a button or fix is handled as soon as it lands
 static void app_main_task(void *pvParameters)
 {
-    EventBits_t bits;
-    
-    // Wait for initial WiFi connection
-    ESP_LOGI(TAG, "Waiting for WiFi connection...");
-    xEventGroupWaitBits(app_event_group, WIFI_CONNECTED_BIT, false, true, portMAX_DELAY);
+    heap_account_enter(HEAP_ACCOUNT_APP);
     
-    // Show main menu
-    show_menu_screen();
+    // Interactive as soon as the screen and touch are up, online or not
+    init_scheduler_wait(BOOT_UI_STEPS, portMAX_DELAY);
     current_state = STATE_MENU;
+    show_menu_screen();
+    
+    uint32_t menu_ms = esp_log_timestamp();
+    if (menu_ms > BOOT_TARGET_MS) {
+        ESP_LOGW(TAG, "Menu interactive at %lu ms, over the %d ms boot target", (unsigned long)menu_ms, BOOT_TARGET_MS);
+    } else {
+        ESP_LOGI(TAG, "Menu interactive at %lu ms", (unsigned long)menu_ms);
+    }
     
     while (1) {
-        // Wait for events
-        bits = xEventGroupWaitBits(app_event_group,
-                                  GPS_DATA_READY_BIT | TOUCH_EVENT_BIT,
-                                  true, // Clear bits on exit
-                                  false, // Wait for any bit
-                                  pdMS_TO_TICKS(1000));
+        bus_msg_t *msg = event_bus_receive(app_sub, portMAX_DELAY);
+        if (!msg) continue;
+        TRACE_BEGIN(TRACE_APP_EVENT, msg->type);
+        lvgl_lock();
         
-        if (bits & GPS_DATA_READY_BIT) {
-            // Get latest GPS data
-            current_gps = gps_handler_get_data();
-            
-            // Update compass if in pointing mode
-            if (current_state == STATE_POINTING && current_target.active) {
-                update_compass_display();
-            }
+        switch (msg->type) {
+            case BUS_EVENT_GPS_FIX:
+                handle_gps_fix(&msg->data.fix);
+                break;
+            case BUS_EVENT_TOUCH:
+                handle_button(msg->data.touch.button);
+                // Press to handled; LVGL draws the result on its next pass
+                power_profile_record_ui_latency(esp_log_timestamp() - msg->published_ms);
+                break;
+            case BUS_EVENT_NET_RESULT:
+                handle_net_result(&msg->data.result);
+                break;
+            case BUS_EVENT_TIMER:
+                handle_timer_event(msg->data.timer_id);
+                break;
+            default:
+                break;
         }
-        
-        // Periodic updates
-        if (current_state == STATE_POINTING && current_target.active) {
-            update_compass_display();
+        lvgl_unlock();
+        event_bus_release(msg);
+        // Activity other than a press (a pushed alert or target) turns the screen on too
+        if (sleep_manager_screen_is_off() && sleep_manager_idle_ms() < SLEEP_LIGHT_IDLE_MS) {
+            screen_wake_requested = true;
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(100));
+        update_power_profile();
+        TRACE_END(TRACE_APP_EVENT);
     }
 }
 
+static void handle_gps_fix(const gps_data_t *fix)
+{
+    TRACE_BEGIN(TRACE_APP_GPS_FIX, 0);
+    TRACE_FLOW_STEP(TRACE_GPS_FLOW, fix->trace_flow);
+    latency_budget_begin(fix->received_us, fix->parsed_us);
+    latency_budget_mark(LATENCY_STAGE_DISPATCH);
+    current_gps = *fix;
+    
+    // Fixes before the network step finishes still move the compass
+    if (network_ready()) {
+        network_manager_sidequest_prefetch_update(&current_gps);
+        if (wifi_connected) {
+            network_manager_submit_gps_fix(&current_gps);
+        }
+    }
+    
+    if (current_state == STATE_POINTING && current_target.active) {
+        sleep_manager_note_activity();
+        update_compass_display();
+    }
+    latency_budget_end();
+    TRACE_END(TRACE_APP_GPS_FIX);
+}
+
+static void handle_timer_event(uint32_t timer_id)
+{
+    if (timer_id == APP_TIMER_DIAGNOSTICS) {
+        network_manager_log_diagnostics();
+        wifi_station_log_stats();
+        sleep_manager_log_stats();
+        power_profile_log_stats();
+        radio_scheduler_log_stats();
+        event_bus_log_stats();
+        telemetry_log();
+        latency_budget_log_stats();
+        heap_account_log();
+        energy_account_log();
+    } else if (timer_id == APP_TIMER_SLEEP) {
+        check_idle_sleep();
+        if (current_state == STATE_DIAGNOSTICS) {
+            show_diagnostics_screen();
+        }
+    }
+}
+
+// Runs on the app task. No manual light sleep: it would drop the WiFi and
+// BLE links, so the backlight goes off and automatic light sleep (the idle
+// power profile) does the napping. Deep sleep would need an RTC wake pin,
+// so this board stops there.
+static void check_idle_sleep(void)
+{
+    if (sleep_manager_idle_ms() < SLEEP_LIGHT_IDLE_MS || sleep_manager_screen_is_off()) return;
+    
+    wake_touch_until_ms = UINT32_MAX;
+    sensecap_display_set_backlight(0);
+    sleep_manager_screen_off();
+}
+
+// Runs on the LVGL task with the LVGL lock held
+static void wake_screen(void)
+{
+    screen_wake_requested = false;
+    
+    // The RGB panel may have stopped refreshing while the chip napped; redraw
+    // before the backlight comes on
+    lv_obj_invalidate(lv_scr_act());
+    lv_refr_now(NULL);
+    sensecap_display_set_backlight(255);
+    sleep_manager_screen_on();
+    sleep_manager_frame_shown();
+    wake_touch_until_ms = esp_log_timestamp() + SLEEP_WAKE_TOUCH_GUARD_MS;
+}
+
+static void lvgl_lock(void)
+{
+    xSemaphoreTakeRecursive(lvgl_mutex, portMAX_DELAY);
+}
+
+static void lvgl_unlock(void)
+{
+    xSemaphoreGiveRecursive(lvgl_mutex);
+}
+
 static void lvgl_tick_task(void *pvParameters)
 {
+    heap_account_enter(HEAP_ACCOUNT_DISPLAY);
+    
+    // LVGL is initialized by the display step
+    init_scheduler_wait(INIT_STEP(BOOT_DISPLAY), portMAX_DELAY);
+    
+    uint32_t last_ms = esp_log_timestamp();
     while (1) {
-        lv_tick_inc(10);
-        lv_task_handler();
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Feed LVGL the real elapsed time, then sleep until its next timer
+        // instead of waking every 10 ms
+        uint32_t now_ms = esp_log_timestamp();
+        lv_tick_inc(now_ms - last_ms);
+        last_ms = now_ms;
+        
+        lvgl_lock();
+        if (sleep_manager_screen_is_off() && (screen_wake_requested || sensecap_touch_is_touched())) {
+            wake_screen();
+        }
+        
+        uint32_t delay_ms = lv_task_handler();
+        lvgl_unlock();
+        if (delay_ms < LVGL_MIN_DELAY_MS) delay_ms = LVGL_MIN_DELAY_MS;
+        if (delay_ms > LVGL_MAX_DELAY_MS) delay_ms = LVGL_MAX_DELAY_MS;
+        if (sleep_manager_screen_is_off() && delay_ms > SLEEP_TOUCH_POLL_MS) delay_ms = SLEEP_TOUCH_POLL_MS;
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    }
+}
+
+// Navigating while pointing, menu while someone is using it, idle otherwise
+static void update_power_profile(void)
+{
+    power_profile_t profile = POWER_PROFILE_MENU;
+    if (current_state == STATE_POINTING) {
+        profile = POWER_PROFILE_NAVIGATING;
+    } else if (sleep_manager_idle_ms() >= POWER_IDLE_AFTER_MS) {
+        profile = POWER_PROFILE_IDLE;
     }
+    power_profile_set(profile);
 }
 
-static void wifi_init_sta(void)
-{
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    esp_event_handler_instance_t instance_any_id;
-    esp_event_handler_instance_t instance_got_ip;
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-                                                        ESP_EVENT_ANY_ID,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_any_id));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-                                                        IP_EVENT_STA_GOT_IP,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_got_ip));
-
-    wifi_config_t wifi_config = {};
-    strcpy((char*)wifi_config.sta.ssid, WIFI_SSID);
-    strcpy((char*)wifi_config.sta.password, WIFI_PASS);
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
-
-    ESP_LOGI(TAG, "WiFi initialization finished.");
-}
-
-static void wifi_event_handler(void* arg, esp_event_base_t event_base,
-                              int32_t event_id, void* event_data)
-{
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        esp_wifi_connect();
-        wifi_connected = false;
-        xEventGroupClearBits(app_event_group, WIFI_CONNECTED_BIT);
-        ESP_LOGI(TAG, "WiFi disconnected, trying to reconnect...");
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        wifi_connected = true;
-        xEventGroupSetBits(app_event_group, WIFI_CONNECTED_BIT);
+// Runs on the event loop task; wifi_station handles reconnects and backoff
+static void on_wifi_link(bool up)
+{
+    wifi_connected = up;
+    radio_scheduler_set_link(up);
+    publish_link(BUS_LINK_WIFI, up);
+}
+
+static void publish_link(bus_link_kind_t kind, bool up)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_LINK);
+    if (msg) {
+        msg->data.link.kind = kind;
+        msg->data.link.up = up;
+        event_bus_publish(msg);
+    }
+}
+
+// Runs on the GPS handler's task: hand the fix to the bus and return
+static void on_gps_fix(const gps_data_t *fix)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_GPS_FIX);
+    if (msg) {
+        msg->data.fix = *fix;
+        event_bus_publish(msg);
     }
 }
 
@@ -297,6 +598,11 @@ static void create_ui_screens(void)
     lv_obj_set_size(compass_screen, LV_HOR_RES, LV_VER_RES);
     lv_obj_set_style_bg_color(compass_screen, lv_color_black(), 0);
     lv_obj_add_flag(compass_screen, LV_OBJ_FLAG_HIDDEN);
+    compass_label = lv_label_create(compass_screen);
+    lv_label_set_text(compass_label, "");
+    lv_obj_set_style_text_color(compass_label, lv_color_white(), 0);
+    lv_obj_set_style_text_font(compass_label, &lv_font_montserrat_24, 0);
+    lv_obj_align(compass_label, LV_ALIGN_CENTER, 0, 0);
     
     // Safety screen
     safety_screen = lv_obj_create(main_screen);
@@ -309,6 +615,13 @@ static void create_ui_screens(void)
     lv_obj_set_size(sidequest_screen, LV_HOR_RES, LV_VER_RES);
     lv_obj_set_style_bg_color(sidequest_screen, lv_color_black(), 0);
     lv_obj_add_flag(sidequest_screen, LV_OBJ_FLAG_HIDDEN);
+    
+    // Diagnostics screen (hidden page, long press on the menu title)
+    diagnostics_screen = lv_obj_create(main_screen);
+    lv_obj_set_size(diagnostics_screen, LV_HOR_RES, LV_VER_RES);
+    lv_obj_set_style_bg_color(diagnostics_screen, lv_color_black(), 0);
+    lv_obj_add_flag(diagnostics_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_event_cb(diagnostics_screen, handle_button_events, LV_EVENT_CLICKED, (void*)BUTTON_DIAGNOSTICS);
 }
 
 static void show_menu_screen(void)
@@ -317,6 +630,7 @@ static void show_menu_screen(void)
     lv_obj_add_flag(compass_screen, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(safety_screen, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(sidequest_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(diagnostics_screen, LV_OBJ_FLAG_HIDDEN);
     
     // Show menu screen  
     lv_obj_clear_flag(menu_screen, LV_OBJ_FLAG_HIDDEN);
@@ -330,6 +644,8 @@ static void show_menu_screen(void)
     lv_obj_set_style_text_color(title, lv_color_white(), 0);
     lv_obj_set_style_text_font(title, &lv_font_montserrat_24, 0);
     lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 20);
+    lv_obj_add_flag(title, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(title, handle_button_events, LV_EVENT_LONG_PRESSED, (void*)BUTTON_DIAGNOSTICS);
     
     // GPS Status
     lv_obj_t *gps_status = lv_label_create(menu_screen);
@@ -414,38 +730,160 @@ static void show_sidequest_screen(void)
     ESP_LOGI(TAG, "Showing sidequest screen");
 }
 
+// Runs on the telemetry task
+static void on_console_key(uint8_t key)
+{
+    if (key == TRACE_DUMP_KEY) {
+        trace_dump();
+    }
+}
+
+static void show_diagnostics_screen(void)
+{
+    // App task only
+    static char text[DIAG_MAX_LINES][TELEMETRY_LINE_LEN];
+    
+    lv_obj_add_flag(menu_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(compass_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(safety_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(sidequest_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_clear_flag(diagnostics_screen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_clean(diagnostics_screen);
+    
+    int count = telemetry_format_lines(text, DIAG_MAX_LINES);
+    for (int i = 0; i < count; i++) {
+        lv_obj_t *line = lv_label_create(diagnostics_screen);
+        lv_label_set_text(line, text[i]);
+        lv_obj_set_style_text_color(line, lv_color_white(), 0);
+        lv_obj_align(line, LV_ALIGN_TOP_LEFT, 0, i * 18);
+    }
+}
+
+// Runs in the LVGL task: publish the press and let app_main_task act on it
 static void handle_button_events(lv_event_t *e)
 {
     int button_id = (int)lv_event_get_user_data(e);
     
+    // The touch that woke the device only wakes it
+    if (esp_log_timestamp() < wake_touch_until_ms) return;
+    
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_TOUCH);
+    if (msg) {
+        msg->data.touch.pressed = true;
+        msg->data.touch.button = button_id;
+        event_bus_publish(msg);
+    }
+}
+
+static void handle_button(int button_id)
+{
     ESP_LOGI(TAG, "Button %d pressed", button_id);
+    sleep_manager_note_activity();
+    
+    // The hidden page works offline; a tap on it goes back to the menu
+    if (button_id == BUTTON_DIAGNOSTICS) {
+        if (current_state == STATE_DIAGNOSTICS) {
+            current_state = STATE_MENU;
+            show_menu_screen();
+        } else {
+            current_state = STATE_DIAGNOSTICS;
+            show_diagnostics_screen();
+        }
+        return;
+    }
+    
+    if (!backend_usable()) {
+        ESP_LOGW(TAG, "Backend offline, ignoring button %d", button_id);
+        return;
+    }
     
     switch (button_id) {
-        case 1: // Save Location
+        case BUTTON_SAVE:
             if (current_gps.valid) {
-                network_manager_save_location(&current_gps);
+                request_network(BUS_NET_SAVE_LOCATION);
             }
             break;
             
-        case 2: // Navigate
-            if (network_manager_select_target_location(&current_target)) {
+        case BUTTON_NAVIGATE:
+            // Pointing starts when the target arrives
+            request_network(BUS_NET_TARGET);
+            break;
+            
+        case BUTTON_SAFETY:
+            current_state = STATE_SAFETY_WARNING;
+            request_network(BUS_NET_SAFETY);
+            break;
+            
+        case BUTTON_SIDEQUEST:
+            // Prefetched sidequests are instant, otherwise ask the network task
+            current_state = STATE_SIDEQUEST;
+            if (sidequest_data.active ||
+                network_manager_sidequest_prefetch_take(&current_gps, &sidequest_data)) {
+                show_sidequest_screen();
+            } else {
+                request_network(BUS_NET_SIDEQUEST);
+            }
+            break;
+    }
+}
+
+static void request_network(bus_net_kind_t kind)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_REQUEST);
+    if (msg) {
+        msg->data.request.kind = kind;
+        msg->data.request.fix = current_gps;
+        event_bus_publish(msg);
+    }
+}
+
+// Replies and pushed updates both land here. A reply only changes the
+// screen if the user is still on the one that asked for it.
+static void handle_net_result(const bus_net_result_t *result)
+{
+    switch (result->kind) {
+        case BUS_NET_SAVE_LOCATION:
+            ESP_LOGI(TAG, "Save location %s", result->ok ? "succeeded" : "failed");
+            break;
+            
+        case BUS_NET_TARGET:
+            // A target set from the app takes over the compass
+            if (result->ok && result->target.active && (result->pushed || current_state == STATE_MENU)) {
+                current_target = result->target;
                 current_state = STATE_POINTING;
                 show_compass_screen();
+                update_compass_display();
             }
             break;
             
-        case 3: // Safety Check
-            current_state = STATE_SAFETY_WARNING;
-            network_manager_check_location_safety(&current_gps, &safety_data);
-            show_safety_screen();
+        case BUS_NET_SAFETY:
+            if (!result->ok) {
+                // No report to show: back to the menu rather than a zeroed screen
+                if (current_state == STATE_SAFETY_WARNING) {
+                    ESP_LOGW(TAG, "Safety check failed / offline");
+                    current_state = STATE_MENU;
+                    show_menu_screen();
+                }
+                break;
+            }
+            if (result->pushed) {
+                ESP_LOGW(TAG, "Safety alert: risk=%.1f", result->safety.risk_score);
+            }
+            if (result->pushed || current_state == STATE_SAFETY_WARNING) {
+                safety_data = result->safety;
+            }
+            if (current_state == STATE_SAFETY_WARNING) {
+                show_safety_screen();
+            }
             break;
             
-        case 4: // Sidequest
-            current_state = STATE_SIDEQUEST;
-            if (!sidequest_data.active) {
-                network_manager_generate_sidequest(&current_gps, &sidequest_data);
+        case BUS_NET_SIDEQUEST:
+            if (result->ok) {
+                sidequest_data = result->sidequest;
+            }
+            if (current_state == STATE_SIDEQUEST) {
+                show_sidequest_screen();
             }
-            show_sidequest_screen();
             break;
     }
 }
@@ -455,33 +893,143 @@ static void update_compass_display(void)
     if (!current_gps.valid || !current_target.active) return;
     
     // Calculate bearing and distance
+    TRACE_BEGIN(TRACE_NAV_BEARING, 0);
     compass_data.bearing = navigation_calc_bearing(current_gps.latitude, current_gps.longitude,
                                                   current_target.latitude, current_target.longitude);
     compass_data.distance = navigation_calc_distance(current_gps.latitude, current_gps.longitude,
                                                     current_target.latitude, current_target.longitude);
+    TRACE_END(TRACE_NAV_BEARING);
+    latency_budget_mark(LATENCY_STAGE_BEARING);
+    
+    // Render now rather than on the LVGL task's next pass: the flush copies
+    // the frame into the panel's framebuffer and is done when lv_refr_now returns
+    latency_budget_mark(LATENCY_STAGE_DRAW_ISSUED);
+    lv_label_set_text_fmt(compass_label, "%d°\n%.2f km", (int)(compass_data.bearing + 0.5f), compass_data.distance);
+    lv_refr_now(NULL);
+    latency_budget_mark(LATENCY_STAGE_PIXELS);
+    sleep_manager_frame_shown();
+    BINLOG_I(TAG, "Compass updated: bearing=%d°, distance=%dm", (int)(compass_data.bearing + 0.5f),
+             (int)(compass_data.distance * 1000.0f + 0.5f));
+}
+
+// Runs the blocking backend calls so the state machine never waits on them.
+// The reply is filled in place in a pool message and published as-is.
+static void network_task(void *pvParameters)
+{
+    heap_account_enter(HEAP_ACCOUNT_NETWORK);
+    
+    // Requests made before then wait in the queue
+    init_scheduler_wait(INIT_STEP(BOOT_NETWORK), portMAX_DELAY);
     
-    // Update compass display (would implement LVGL compass here)
-    ESP_LOGI(TAG, "Compass updated: bearing=%.0f°, distance=%.2fkm", 
-             compass_data.bearing, compass_data.distance);
+    while (1) {
+        bus_msg_t *msg = event_bus_receive(network_sub, portMAX_DELAY);
+        if (!msg) continue;
+        
+        bus_net_request_t request = msg->data.request;
+        event_bus_release(msg);
+        
+        bus_msg_t *reply = event_bus_alloc(BUS_EVENT_NET_RESULT);
+        if (!reply) continue;
+        
+        bus_net_result_t *result = &reply->data.result;
+        result->kind = request.kind;
+        switch (request.kind) {
+            case BUS_NET_SAVE_LOCATION:
+                result->ok = network_manager_save_location(&request.fix);
+                break;
+            case BUS_NET_TARGET:
+                result->ok = network_manager_select_target_location(&result->target);
+                break;
+            case BUS_NET_SAFETY:
+                result->ok = network_manager_check_location_safety(&request.fix, &result->safety);
+                break;
+            case BUS_NET_SIDEQUEST:
+                result->ok = network_manager_generate_sidequest(&request.fix, &result->sidequest);
+                break;
+        }
+        event_bus_publish(reply);
+    }
 }
 
 static void backend_connectivity_task(void *pvParameters)
 {
+    heap_account_enter(HEAP_ACCOUNT_NETWORK);
+    
+    init_scheduler_wait(BOOT_ALL_STEPS, portMAX_DELAY);
+    init_scheduler_log();
+    
+    // Boot runs at full speed; frequency scaling starts once everything is up
+    power_profile_init(current_state == STATE_POINTING ? POWER_PROFILE_NAVIGATING : POWER_PROFILE_MENU);
+    
     while (1) {
-        if (wifi_connected) {
-            bool reachable = network_manager_test_connectivity();
-            if (reachable != backend_reachable) {
-                backend_reachable = reachable;
-                if (reachable) {
-                    xEventGroupSetBits(app_event_group, BACKEND_READY_BIT);
-                    ESP_LOGI(TAG, "Backend is reachable");
-                } else {
-                    xEventGroupClearBits(app_event_group, BACKEND_READY_BIT);
-                    ESP_LOGI(TAG, "Backend is not reachable");
-                }
-            }
+        // Health comes from real traffic; this only probes when idle or recovering
+        uint32_t next_poll_ms = network_manager_health_poll(wifi_connected);
+        
+        bool reachable = wifi_connected && network_manager_backend_available();
+        if (reachable != backend_reachable) {
+            backend_reachable = reachable;
+            ESP_LOGI(TAG, "Backend is %s", reachable ? "reachable" : "not reachable");
+            publish_link(BUS_LINK_BACKEND, reachable);
+        }
+        
+        uint32_t refresh_ms = power_profile_get() == POWER_PROFILE_IDLE ? BACKEND_STATE_REFRESH_IDLE_MS
+                                                                         : BACKEND_STATE_REFRESH_MS;
+        if (next_poll_ms > refresh_ms) {
+            next_poll_ms = refresh_ms;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Check every 10 seconds
+        // A link change cuts the wait short so the state follows WiFi at once
+        event_bus_release(event_bus_receive(backend_sub, pdMS_TO_TICKS(next_poll_ms)));
     }
-}
\ No newline at end of file
+}
+
+static void start_push_channel(void)
+{
+    // One connection per unit, named after its MAC address
+    uint8_t mac[6];
+    char device_id[32];
+    esp_efuse_mac_get_default(mac);
+    snprintf(device_id, sizeof(device_id), "compass-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    
+    nm_push_handlers_t handlers = {};
+    handlers.on_target = on_pushed_target;
+    handlers.on_safety = on_pushed_safety;
+    handlers.on_sidequest = on_pushed_sidequest;
+    network_manager_push_start(device_id, &handlers);
+}
+
+// Pushed updates arrive on the WebSocket task and take the same path as replies
+static void publish_pushed(bus_msg_t *msg, bus_net_kind_t kind)
+{
+    msg->data.result.kind = kind;
+    msg->data.result.ok = true;
+    msg->data.result.pushed = true;
+    event_bus_publish(msg);
+}
+
+static void on_pushed_target(const target_data_t *target)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_RESULT);
+    if (msg) {
+        msg->data.result.target = *target;
+        publish_pushed(msg, BUS_NET_TARGET);
+    }
+}
+
+static void on_pushed_safety(const safety_data_t *safety)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_RESULT);
+    if (msg) {
+        msg->data.result.safety = *safety;
+        publish_pushed(msg, BUS_NET_SAFETY);
+    }
+}
+
+static void on_pushed_sidequest(const sidequest_data_t *sidequest)
+{
+    bus_msg_t *msg = event_bus_alloc(BUS_EVENT_NET_RESULT);
+    if (msg) {
+        msg->data.result.sidequest = *sidequest;
+        publish_pushed(msg, BUS_NET_SIDEQUEST);
+    }
+}
@@ -0,0 +1,154 @@
+// Hike generator for the linux-target firmware simulation
+// Writes a GPS replay (timed NMEA GGA sentences, as the BLE GPS would send
+// them) and a touch script for esp-idf-waypoint/sim. The default hike is two
+// hours: a climb with switchbacks, a rest stop at the top, a descent, GPS
+// noise that grows under tree cover and the odd multipath glitch.
+//
+// Usage: node sim-hike.js                       (writes sim-hike/hike.nmea and sim-hike/touches.txt)
+//        DURATION_MIN=30 FIX_INTERVAL_MS=2000 SEED=3 node sim-hike.js out-dir
+// Then run the simulation with SIM_GPS_REPLAY and SIM_TOUCH_SCRIPT pointing
+// at the two files (see esp-idf-waypoint/README.md).
+
+const fs = require('fs');
+const path = require('path');
+
+const OUT_DIR = process.argv[2] || 'sim-hike';
+const DURATION_MIN = parseFloat(process.env.DURATION_MIN) || 120;
+const FIX_INTERVAL_MS = parseInt(process.env.FIX_INTERVAL_MS) || 1000;
+const SEED = parseInt(process.env.SEED) || 1;
+
+// Trailhead matches the mock backend's saved locations
+const START = { latitude: 37.7749, longitude: -122.4194, altitude: 120 };
+const WALK_SPEED_MPS = 1.2;
+const CLIMB_MPS = 0.12;
+const REST_MIN = 15;
+const METERS_PER_DEG_LAT = 111320;
+
+// ---- Deterministic randomness (mulberry32, as in mock-backend.js) ----
+
+let rngState = SEED >>> 0;
+function random() {
+  rngState = (rngState + 0x6D2B79F5) >>> 0;
+  let t = rngState;
+  t = Math.imul(t ^ (t >>> 15), t | 1);
+  t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+  return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+}
+
+function gaussian() {
+  const u = 1 - random();
+  const v = random();
+  return Math.sqrt(-2 * Math.log(u)) * Math.cos(2 * Math.PI * v);
+}
+
+// ---- NMEA ----
+
+function nmeaCoordinate(value, degreeDigits) {
+  const abs = Math.abs(value);
+  const degrees = Math.floor(abs);
+  const minutes = (abs - degrees) * 60;
+  return String(degrees).padStart(degreeDigits, '0') + minutes.toFixed(4).padStart(7, '0');
+}
+
+function nmeaChecksum(body) {
+  let sum = 0;
+  for (const ch of body) sum ^= ch.charCodeAt(0);
+  return sum.toString(16).toUpperCase().padStart(2, '0');
+}
+
+function gga(timeMs, fix) {
+  const t = new Date(Date.UTC(2026, 0, 1) + timeMs);
+  const hhmmss = t.toISOString().slice(11, 19).replace(/:/g, '') + '.00';
+  const body = [
+    'GPGGA',
+    hhmmss,
+    nmeaCoordinate(fix.latitude, 2), fix.latitude >= 0 ? 'N' : 'S',
+    nmeaCoordinate(fix.longitude, 3), fix.longitude >= 0 ? 'E' : 'W',
+    1, '08', fix.hdop.toFixed(1), fix.altitude.toFixed(1), 'M', '0.0', 'M', '', ''
+  ].join(',');
+  return `$${body}*${nmeaChecksum(body)}`;
+}
+
+// ---- Route ----
+
+// Heading (degrees) and climb rate for minute m of the hike
+function legAt(minute, climbMin) {
+  if (minute < climbMin) {
+    // Switchbacks: the heading swings between NE and NW every 6 minutes
+    const leg = Math.floor(minute / 6);
+    return { heading: leg % 2 === 0 ? 30 : 330, climb: CLIMB_MPS, moving: true };
+  }
+  if (minute < climbMin + REST_MIN) {
+    return { heading: 0, climb: 0, moving: false };
+  }
+  // Descent on a straighter trail back toward the trailhead
+  return { heading: 190, climb: -CLIMB_MPS * 1.4, moving: true };
+}
+
+function generate() {
+  const climbMin = (DURATION_MIN - REST_MIN) * 0.55;
+  const totalMs = DURATION_MIN * 60000;
+  const lines = [`# ${DURATION_MIN} min hike, one fix every ${FIX_INTERVAL_MS} ms, seed ${SEED}`];
+  const truth = { ...START };
+  let glitches = 0;
+
+  for (let t = 0; t <= totalMs; t += FIX_INTERVAL_MS) {
+    const minute = t / 60000;
+    const leg = legAt(minute, climbMin);
+    const dt = FIX_INTERVAL_MS / 1000;
+
+    if (leg.moving) {
+      const speed = WALK_SPEED_MPS * (0.85 + random() * 0.3);
+      const rad = leg.heading * Math.PI / 180;
+      truth.latitude += (speed * dt * Math.cos(rad)) / METERS_PER_DEG_LAT;
+      truth.longitude += (speed * dt * Math.sin(rad)) /
+        (METERS_PER_DEG_LAT * Math.cos(truth.latitude * Math.PI / 180));
+      truth.altitude += leg.climb * dt;
+    }
+
+    // Tree cover on the middle of the climb worsens HDOP and scatter
+    const underTrees = minute > climbMin * 0.3 && minute < climbMin * 0.7;
+    const hdop = (underTrees ? 2.5 : 1.0) + random() * 0.6;
+    const scatterM = hdop * 1.5;
+    const fix = {
+      latitude: truth.latitude + (gaussian() * scatterM) / METERS_PER_DEG_LAT,
+      longitude: truth.longitude + (gaussian() * scatterM) / METERS_PER_DEG_LAT,
+      altitude: truth.altitude + gaussian() * hdop * 2,
+      hdop
+    };
+
+    // Multipath glitch: a fix a few hundred meters off, which the governor should reject
+    if (random() < 0.002) {
+      fix.latitude += (300 + random() * 400) / METERS_PER_DEG_LAT;
+      glitches++;
+    }
+
+    lines.push(`${t} ${gga(t, fix)}`);
+  }
+
+  return { lines, glitches, climbMin };
+}
+
+// Taps in menu coordinates (see handle_touch_event in the firmware)
+function touchScript(climbMin) {
+  const at = (minute) => Math.round(minute * 60000);
+  const taps = [
+    [at(0.2), 240, 220, 'navigate to a saved location'],
+    [at(climbMin * 0.5), 240, 160, 'back to menu'],
+    [at(climbMin * 0.5) + 5000, 240, 270, 'safety check'],
+    [at(climbMin * 0.5) + 20000, 240, 160, 'back to menu'],
+    [at(climbMin + 2), 240, 300, 'sidequest'],
+    [at(climbMin + 4), 240, 160, 'back to menu'],
+    [at(climbMin + 5), 240, 170, 'save location'],
+    [at(climbMin + REST_MIN), 240, 220, 'navigate for the descent']
+  ];
+  return ['# <sim_ms> <x> <y>', ...taps.map(([ms, x, y, what]) => `${ms} ${x} ${y}  # ${what}`)];
+}
+
+const { lines, glitches, climbMin } = generate();
+fs.mkdirSync(OUT_DIR, { recursive: true });
+fs.writeFileSync(path.join(OUT_DIR, 'hike.nmea'), lines.join('\n') + '\n');
+fs.writeFileSync(path.join(OUT_DIR, 'touches.txt'), touchScript(climbMin).join('\n') + '\n');
+
+console.log(`🥾 Wrote ${lines.length - 1} fixes (${DURATION_MIN} min, ${glitches} glitches) to ${path.join(OUT_DIR, 'hike.nmea')}`);
+console.log(`👆 Wrote touch script to ${path.join(OUT_DIR, 'touches.txt')}`);
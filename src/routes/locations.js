@@ -5,6 +5,7 @@ const GPSData = require('../models/GPSData');
 const asyncHandler = require('../utils/asyncHandler');
 const LandmarkService = require('../services/landmarkService');
 const SafetyService = require('../services/safetyService');
+const pushService = require('../services/pushService');
 
 const router = express.Router();
 const landmarkService = new LandmarkService();
@@ -190,6 +191,15 @@ router.post('/target/set', [
       });
     }
 
+    // Devices on the push channel switch targets without polling
+    pushService.publish('target', {
+      _id: target._id.toString(),
+      name: target.name,
+      latitude: target.latitude,
+      longitude: target.longitude,
+      type: target.type
+    });
+
     res.json({
       success: true,
       message: `Now pointing to ${target.name}`,
@@ -321,6 +331,7 @@ router.post('/sidequest/start', [
       }
     }
     
+    let sidequestLocation;
     if (!selectedLandmark) {
       // Fallback to random location if no landmarks found
       const mysteryPlaces = ['Hidden Spot', 'Secret Location', 'Mystery Destination'];
@@ -332,7 +343,7 @@ router.post('/sidequest/start', [
       const mysteryLat = lat + radiusKm * Math.cos(angle);
       const mysteryLng = lng + radiusKm * Math.sin(angle);
 
-      const sidequestLocation = new Location({
+      sidequestLocation = new Location({
         name: mysteryName,
         latitude: mysteryLat,
         longitude: mysteryLng,
@@ -345,7 +356,7 @@ router.post('/sidequest/start', [
       console.log('No landmarks found, created random mystery location');
     } else {
       // Create sidequest from discovered (and safety-checked) landmark
-      const sidequestLocation = new Location({
+      sidequestLocation = new Location({
         name: 'Mystery Location', // Keep name secret until completion
         latitude: selectedLandmark.latitude,
         longitude: selectedLandmark.longitude,
@@ -364,10 +375,24 @@ router.post('/sidequest/start', [
       console.log(`Created sidequest for landmark: ${selectedLandmark.name} (${selectedLandmark.distance}m away)`);
     }
 
+    // The shape the firmware parses, name kept secret
+    const sidequest = {
+      title: 'Mystery Adventure',
+      description: 'Destination unknown - follow your compass!',
+      difficulty: sidequestLocation.difficulty || 'moderate',
+      location: {
+        name: 'Mystery Location',
+        latitude: sidequestLocation.latitude,
+        longitude: sidequestLocation.longitude
+      }
+    };
+    pushService.publish('sidequest', sidequest);
+
     res.json({
       success: true,
       message: 'Mystery adventure started! Follow the compass to discover what awaits...',
       data: {
+        ...sidequest,
         type: 'sidequest',
         message: 'Destination unknown - follow your compass!',
         estimatedDistance: '300-800 meters away',
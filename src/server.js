@@ -12,6 +12,7 @@ const locationRoutes = require('./routes/locations');
 const safetyRoutes = require('./routes/safety');
 const ttsRoutes = require('./routes/tts');
 const errorHandler = require('./middleware/errorHandler');
+const pushService = require('./services/pushService');
 
 const app = express();
 const PORT = process.env.PORT || 3000;
@@ -42,7 +43,9 @@ const limiter = rateLimit({
 app.use('/api/', limiter);
 
 // General middleware
-app.use(compression());
+// Compress anything over 256 bytes; devices send Accept-Encoding: gzip and
+// inflate into a 4 KB buffer, so location lists and safety reports benefit
+app.use(compression({ threshold: 256 }));
 app.use(morgan('combined'));
 app.use(express.json({ limit: '10mb' }));
 app.use(express.urlencoded({ extended: true, limit: '10mb' }));
@@ -63,6 +66,14 @@ app.use('/api', locationRoutes);
 app.use('/api/safety', safetyRoutes);
 app.use('/api/tts', ttsRoutes);
 
+// Push channel status
+app.get('/api/push/status', (req, res) => {
+  res.json({
+    success: true,
+    data: pushService.getStats()
+  });
+});
+
 // Root endpoint
 app.get('/', (req, res) => {
   res.json({
@@ -84,6 +95,8 @@ app.get('/', (req, res) => {
       ttsStatus: '/api/tts/status',
       ttsNavStart: '/api/tts/navigation/start',
       ttsNavStop: '/api/tts/navigation/stop',
+      pushStatus: '/api/push/status',
+      pushChannel: 'ws://<host>/ws/device?deviceId=<id>',
       health: '/health'
     }
   });
@@ -133,6 +146,9 @@ const startServer = async () => {
       console.log('✅ Server is ready to accept connections from ESP32');
     });
 
+    // Persistent device connections for target, safety and sidequest pushes
+    pushService.attach(server);
+
     server.on('error', (error) => {
       console.error('💥 Server error:', error);
       process.exit(1);
@@ -0,0 +1,316 @@
+const crypto = require('crypto');
+const GPSData = require('../models/GPSData');
+const navigationTrackingService = require('./navigationTrackingService');
+const SafetyService = require('./safetyService');
+
+const WS_GUID = '258EAFA5-E914-47DA-95CA-C5AB0DC85B11';
+const WS_PATH = '/ws/device';
+const MAX_FRAME_BYTES = 64 * 1024;
+const MAX_MESSAGE_BYTES = 64 * 1024; // all fragments of one message together
+const CLOSE_MESSAGE_TOO_BIG = 1009;
+
+const OPCODE_CONTINUATION = 0x0;
+const OPCODE_TEXT = 0x1;
+const OPCODE_CLOSE = 0x8;
+const OPCODE_PING = 0x9;
+const OPCODE_PONG = 0xA;
+
+// Minimal RFC 6455 server framing, enough for the compass devices: text
+// frames, ping/pong and close. Server frames are never masked or fragmented.
+function encodeFrame(opcode, payload = Buffer.alloc(0), mask = false) {
+  const length = payload.length;
+  let header;
+  if (length < 126) {
+    header = Buffer.alloc(2);
+    header[1] = length;
+  } else if (length < 65536) {
+    header = Buffer.alloc(4);
+    header[1] = 126;
+    header.writeUInt16BE(length, 2);
+  } else {
+    header = Buffer.alloc(10);
+    header[1] = 127;
+    header.writeBigUInt64BE(BigInt(length), 2);
+  }
+  header[0] = 0x80 | opcode;
+
+  if (!mask) {
+    return Buffer.concat([header, payload]);
+  }
+
+  // Client-to-server frames must be masked (used by the test scripts)
+  header[1] |= 0x80;
+  const key = crypto.randomBytes(4);
+  const masked = Buffer.alloc(length);
+  for (let i = 0; i < length; i++) {
+    masked[i] = payload[i] ^ key[i % 4];
+  }
+  return Buffer.concat([header, key, masked]);
+}
+
+// Pulls complete frames off the front of buffer; returns { frames, rest }
+function decodeFrames(buffer) {
+  const frames = [];
+  let offset = 0;
+
+  while (buffer.length - offset >= 2) {
+    const fin = (buffer[offset] & 0x80) !== 0;
+    const opcode = buffer[offset] & 0x0f;
+    const masked = (buffer[offset + 1] & 0x80) !== 0;
+    let length = buffer[offset + 1] & 0x7f;
+    let pos = offset + 2;
+
+    if (length === 126) {
+      if (buffer.length < pos + 2) break;
+      length = buffer.readUInt16BE(pos);
+      pos += 2;
+    } else if (length === 127) {
+      if (buffer.length < pos + 8) break;
+      const longLength = buffer.readBigUInt64BE(pos);
+      if (longLength > BigInt(MAX_FRAME_BYTES)) {
+        throw new Error('Frame too large');
+      }
+      length = Number(longLength);
+      pos += 8;
+    }
+
+    if (length > MAX_FRAME_BYTES) {
+      throw new Error('Frame too large');
+    }
+
+    const maskKey = masked ? buffer.subarray(pos, pos + 4) : null;
+    if (masked) pos += 4;
+    if (buffer.length < pos + length) break;
+
+    const payload = Buffer.from(buffer.subarray(pos, pos + length));
+    if (maskKey) {
+      for (let i = 0; i < payload.length; i++) {
+        payload[i] ^= maskKey[i % 4];
+      }
+    }
+
+    frames.push({ fin, opcode, payload });
+    offset = pos + length;
+  }
+
+  return { frames, rest: buffer.subarray(offset) };
+}
+
+class PushService {
+  constructor() {
+    this.clients = new Set();
+    this.pingInterval = 30000; // 30 seconds
+    this.safetyCheckInterval = 60000; // at most one safety check per device per minute
+    this.safetyCheckDistance = 200; // ...unless it moved this many meters
+    this.safetyAlertRisk = 2.0; // push safety data above this risk score
+    this.safetyService = new SafetyService();
+    this.lastSafetyCheck = new Map(); // deviceId -> { time, latitude, longitude }
+    this.stats = {
+      connections: 0,
+      pushes: 0,
+      framesIn: 0,
+      gpsFrames: 0
+    };
+    this.pingTimer = null;
+  }
+
+  // Accept WebSocket upgrades on /ws/device?deviceId=...
+  attach(server) {
+    server.on('upgrade', (req, socket) => {
+      const url = new URL(req.url, 'http://localhost');
+      const key = req.headers['sec-websocket-key'];
+
+      if (url.pathname !== WS_PATH || !key || req.headers.upgrade.toLowerCase() !== 'websocket') {
+        socket.end('HTTP/1.1 400 Bad Request\r\n\r\n');
+        return;
+      }
+
+      const accept = crypto.createHash('sha1').update(key + WS_GUID).digest('base64');
+      socket.write(
+        'HTTP/1.1 101 Switching Protocols\r\n' +
+        'Upgrade: websocket\r\n' +
+        'Connection: Upgrade\r\n' +
+        `Sec-WebSocket-Accept: ${accept}\r\n\r\n`
+      );
+
+      this.addClient(socket, url.searchParams.get('deviceId') || 'unknown');
+    });
+
+    this.pingTimer = setInterval(() => this.pingClients(), this.pingInterval);
+    this.pingTimer.unref();
+
+    console.log(`📡 Push channel listening on ${WS_PATH}`);
+  }
+
+  addClient(socket, deviceId) {
+    const client = { socket, deviceId, alive: true, closing: false, buffer: Buffer.alloc(0), fragments: [], fragmentBytes: 0 };
+    this.clients.add(client);
+    this.stats.connections++;
+    socket.setNoDelay(true);
+
+    console.log(`📡 Device ${deviceId} connected to push channel (${this.clients.size} connected)`);
+
+    socket.on('data', (chunk) => {
+      client.buffer = Buffer.concat([client.buffer, chunk]);
+      let decoded;
+      try {
+        decoded = decodeFrames(client.buffer);
+      } catch (error) {
+        console.error(`Push channel error from ${deviceId}:`, error.message);
+        socket.destroy();
+        return;
+      }
+      client.buffer = decoded.rest;
+      decoded.frames.forEach(frame => this.handleFrame(client, frame));
+    });
+
+    const remove = () => {
+      if (this.clients.delete(client)) {
+        console.log(`📡 Device ${deviceId} left push channel (${this.clients.size} connected)`);
+      }
+    };
+    socket.on('close', remove);
+    socket.on('error', remove);
+  }
+
+  handleFrame(client, frame) {
+    if (client.closing) return;
+    client.alive = true;
+
+    switch (frame.opcode) {
+      case OPCODE_PING:
+        client.socket.write(encodeFrame(OPCODE_PONG, frame.payload));
+        return;
+      case OPCODE_PONG:
+        return;
+      case OPCODE_CLOSE:
+        client.socket.end(encodeFrame(OPCODE_CLOSE));
+        return;
+      case OPCODE_TEXT:
+      case OPCODE_CONTINUATION:
+        client.fragmentBytes += frame.payload.length;
+        if (client.fragmentBytes > MAX_MESSAGE_BYTES) {
+          console.error(`Push message from ${client.deviceId} over ${MAX_MESSAGE_BYTES} bytes`);
+          client.fragments = [];
+          this.closeClient(client, CLOSE_MESSAGE_TOO_BIG);
+          return;
+        }
+        client.fragments.push(frame.payload);
+        if (!frame.fin) return;
+        break;
+      default:
+        return;
+    }
+
+    const text = Buffer.concat(client.fragments).toString('utf8');
+    client.fragments = [];
+    client.fragmentBytes = 0;
+    this.stats.framesIn++;
+
+    let message;
+    try {
+      message = JSON.parse(text);
+    } catch (error) {
+      console.error(`Invalid push message from ${client.deviceId}`);
+      return;
+    }
+
+    if (message.type === 'gps') {
+      this.handleGps(client, message).catch(error => {
+        console.error('Push GPS update error:', error.message);
+      });
+    }
+  }
+
+  // Close frame with a status code; frames still arriving are ignored
+  closeClient(client, status) {
+    const payload = Buffer.alloc(2);
+    payload.writeUInt16BE(status, 0);
+    client.closing = true;
+    client.socket.end(encodeFrame(OPCODE_CLOSE, payload));
+  }
+
+  // Same handling as POST /api/gps, followed by a throttled safety check
+  async handleGps(client, message) {
+    const latitude = parseFloat(message.latitude);
+    const longitude = parseFloat(message.longitude);
+    if (!(latitude >= -90 && latitude <= 90) || !(longitude >= -180 && longitude <= 180)) {
+      return;
+    }
+
+    const deviceId = message.deviceId || client.deviceId;
+    const altitude = parseFloat(message.altitude) || 0;
+    this.stats.gpsFrames++;
+
+    await GPSData.deleteMany({
+      source: 'ble',
+      timestamp: { $lt: new Date(Date.now() - 60000) }
+    });
+
+    await new GPSData({
+      latitude,
+      longitude,
+      altitude,
+      accuracy: parseFloat(message.accuracy) || 0,
+      source: 'ble',
+      timestamp: new Date()
+    }).save();
+
+    await navigationTrackingService.updateLocation(deviceId, { latitude, longitude, altitude });
+    await this.checkSafety(deviceId, latitude, longitude);
+  }
+
+  async checkSafety(deviceId, latitude, longitude) {
+    const last = this.lastSafetyCheck.get(deviceId);
+    if (last && Date.now() - last.time < this.safetyCheckInterval &&
+        navigationTrackingService.calculateDistance(last, { latitude, longitude }) * 1000 < this.safetyCheckDistance) {
+      return;
+    }
+    this.lastSafetyCheck.set(deviceId, { time: Date.now(), latitude, longitude });
+
+    // A failed analysis comes back as a medium-risk placeholder; never alert on it
+    const safety = await this.safetyService.analyzeSafetyAtLocation(latitude, longitude, 'push_alert');
+    const failed = safety && (safety.warnings || []).some(warning => warning.type === 'analysis_error');
+    if (safety && !failed && safety.riskScore > this.safetyAlertRisk) {
+      this.publish('safety', safety, deviceId);
+    }
+  }
+
+  // Send { type, data, sentAt } to one device, or every device when deviceId is omitted
+  publish(type, data, deviceId = null) {
+    const frame = encodeFrame(OPCODE_TEXT, Buffer.from(JSON.stringify({ type, data, sentAt: Date.now() })));
+    let delivered = 0;
+
+    this.clients.forEach(client => {
+      if (deviceId && client.deviceId !== deviceId) return;
+      client.socket.write(frame);
+      delivered++;
+    });
+
+    this.stats.pushes += delivered;
+    return delivered;
+  }
+
+  pingClients() {
+    this.clients.forEach(client => {
+      if (!client.alive) {
+        client.socket.destroy();
+        return;
+      }
+      client.alive = false;
+      client.socket.write(encodeFrame(OPCODE_PING));
+    });
+  }
+
+  getStats() {
+    return {
+      ...this.stats,
+      connected: this.clients.size,
+      devices: Array.from(this.clients).map(client => client.deviceId)
+    };
+  }
+}
+
+module.exports = new PushService();
+module.exports.encodeFrame = encodeFrame;
+module.exports.decodeFrames = decodeFrames;
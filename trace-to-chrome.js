@@ -0,0 +1,161 @@
+// Firmware trace to Chrome/Perfetto trace JSON
+// Reads a serial log containing a trace dump (press 'd' in the monitor, or
+// run the simulation with SIM_TRACE=1) and writes trace event JSON that
+// chrome://tracing and ui.perfetto.dev open directly. Each task is a thread;
+// spans, counters and the GPS flow (BLE write -> parse -> app -> upload)
+// come out as slices, counter tracks and flow arrows.
+//
+// Usage: idf.py monitor | tee device.log           (then press 'd')
+//        node trace-to-chrome.js device.log > trace.json
+//        node trace-to-chrome.js device.log trace.json
+
+const fs = require('fs');
+
+const EVENT_BYTES = 16;
+const TYPES = ['begin', 'end', 'counter', 'flow_start', 'flow_step', 'flow_end'];
+const PID = 1;
+
+function parseDump(text) {
+  const dump = { points: {}, tasks: {}, cores: {} };
+  let started = false;
+
+  for (const rawLine of text.split(/\r?\n/)) {
+    // Log prefixes and monitor timestamps may precede the marker
+    const at = rawLine.indexOf('TRACE ');
+    if (at < 0) continue;
+    const fields = rawLine.slice(at).trim().split(/\s+/);
+
+    switch (fields[1]) {
+      case 'start':
+        // A later dump in the same log replaces an earlier one
+        Object.assign(dump, { points: {}, tasks: {}, cores: {} });
+        started = true;
+        break;
+      case 'point':
+        dump.points[Number(fields[2])] = fields[3];
+        break;
+      case 'task':
+        dump.tasks[parseInt(fields[2], 16)] = fields.slice(3).join(' ');
+        break;
+      case 'core':
+        dump.cores[Number(fields[2])] = { dropped: Number(fields[4]), events: [] };
+        break;
+      case 'ev': {
+        const core = dump.cores[Number(fields[2])];
+        if (!core) break;
+        const bytes = Buffer.from(fields[3] || '', 'hex');
+        for (let off = 0; off + EVENT_BYTES <= bytes.length; off += EVENT_BYTES) {
+          core.events.push({
+            ts: bytes.readUInt32LE(off),
+            arg: bytes.readUInt32LE(off + 4),
+            task: bytes.readUInt32LE(off + 8),
+            point: bytes.readUInt8(off + 12),
+            type: TYPES[bytes.readUInt8(off + 13)] || 'unknown',
+            core: Number(fields[2]),
+          });
+        }
+        break;
+      }
+    }
+  }
+
+  if (!started) {
+    throw new Error('no "TRACE start" line found');
+  }
+  return dump;
+}
+
+// Timestamps are 32-bit microseconds; only a large backwards step is a wrap,
+// small ones are events claimed just before a preemption
+function unwrap(events) {
+  let offset = 0;
+  let last = null;
+  for (const event of events) {
+    if (last !== null && event.ts < last && last - event.ts > 0x80000000) {
+      offset += 0x100000000;
+    }
+    last = event.ts;
+    event.ts += offset;
+  }
+}
+
+function toChrome(dump) {
+  const events = [];
+  for (const core of Object.values(dump.cores)) {
+    unwrap(core.events);
+    events.push(...core.events);
+  }
+  events.sort((a, b) => a.ts - b.ts);
+  const origin = events.length ? events[0].ts : 0;
+
+  const out = [{ ph: 'M', pid: PID, name: 'process_name', args: { name: 'waypoint-compass' } }];
+  const threads = new Set();
+  const open = new Map();   // tid -> stack of open span names
+  let dropped = 0;
+
+  for (const event of events) {
+    const tid = event.task;
+    const name = dump.points[event.point] || `point_${event.point}`;
+    const ts = event.ts - origin;
+
+    if (!threads.has(tid)) {
+      threads.add(tid);
+      const taskName = dump.tasks[tid] || `task ${tid.toString(16)}`;
+      out.push({ ph: 'M', pid: PID, tid, name: 'thread_name', args: { name: taskName } });
+    }
+    const stack = open.get(tid) || [];
+    open.set(tid, stack);
+
+    switch (event.type) {
+      case 'begin':
+        stack.push(name);
+        out.push({ ph: 'B', pid: PID, tid, ts, name, args: { arg: event.arg, core: event.core } });
+        break;
+      case 'end':
+        // The ring may have overwritten the matching begin
+        if (stack[stack.length - 1] !== name) {
+          dropped++;
+          break;
+        }
+        stack.pop();
+        out.push({ ph: 'E', pid: PID, tid, ts, name });
+        break;
+      case 'counter':
+        out.push({ ph: 'C', pid: PID, tid, ts, name, args: { value: event.arg } });
+        break;
+      case 'flow_start':
+      case 'flow_step':
+      case 'flow_end':
+        if (event.arg === 0) break;
+        out.push({
+          ph: { flow_start: 's', flow_step: 't', flow_end: 'f' }[event.type],
+          bp: 'e', pid: PID, tid, ts, name, cat: 'flow', id: event.arg,
+        });
+        break;
+    }
+  }
+
+  const total = events.length;
+  const overwritten = Object.values(dump.cores).reduce((sum, core) => sum + core.dropped, 0);
+  console.error(`${total} events from ${Object.keys(dump.cores).length} cores, ${threads.size} tasks, ` +
+                `${overwritten} overwritten in the ring, ${dropped} unmatched ends skipped`);
+  return { traceEvents: out, displayTimeUnit: 'ms' };
+}
+
+function main() {
+  const [input, output] = process.argv.slice(2);
+  if (!input) {
+    console.error('Usage: node trace-to-chrome.js <serial log> [trace.json]');
+    process.exit(1);
+  }
+
+  const json = JSON.stringify(toChrome(parseDump(fs.readFileSync(input, 'utf8'))));
+  if (output) {
+    fs.writeFileSync(output, json);
+    console.error(`Wrote ${output}`);
+  } else {
+    process.stdout.write(json + '\n');
+  }
+}
+
+main();